@@ -5,15 +5,103 @@
 
 #include "file.hpp"
 
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
-#include <iterator>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "log.hpp"
+
+using Log = nds::logger::Logger<nds::logger::Category::MariDS>;
+
+/* Opens a file at its end, returns the file size */
+size_t openBinary(std::ifstream &file, const char *path) {
+    file.open(path, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open()) return 0;
+
+    const auto size = (size_t)file.tellg();
+
+    file.seekg(0, std::ios::beg);
+
+    return size;
+}
 
 std::vector<u8> loadBinary(const char *path) {
-    std::ifstream file{path, std::ios::binary};
+    std::ifstream file;
+
+    std::vector<u8> data(openBinary(file, path));
+
+    file.read((char *)data.data(), data.size());
+
+    return data;
+}
+
+bool readBinary(const char *path, u8 *data, size_t size) {
+    std::ifstream file;
+
+    if (openBinary(file, path) != size) return false;
+
+    return (bool)file.read((char *)data, size);
+}
+
+MappedFile mapBinary(const char *path) {
+    MappedFile file;
+
+#ifdef __unix__
+    if (const auto fd = open(path, O_RDONLY | O_CLOEXEC); fd >= 0) {
+        struct stat st;
+
+        if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+            const auto mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mem != MAP_FAILED) {
+                file.data = (const u8 *)mem;
+                file.size = st.st_size;
+
+                file.isMapped = true;
+            }
+        }
+
+        close(fd);
+
+        if (file.isMapped) return file;
+    }
+#endif
+
+    // No mmap, read the whole file instead
+    std::ifstream in;
+
+    const auto size = openBinary(in, path);
+
+    if (!in.is_open()) return file;
+
+    auto data = new u8[size];
+
+    in.read((char *)data, size);
+
+    file.data = data;
+    file.size = size;
+
+    return file;
+}
+
+void unmapBinary(MappedFile &file) {
+    if (file.data == NULL) return;
+
+#ifdef __unix__
+    if (file.isMapped) munmap((void *)file.data, file.size);
+#endif
 
-    file.unsetf(std::ios::skipws);
+    if (!file.isMapped) delete[] file.data;
 
-    return {std::istream_iterator<u8>{file}, {}};
+    file = {};
 }
 
 void saveBinary(const char *path, u8 *data, size_t size) {
@@ -22,7 +110,7 @@ void saveBinary(const char *path, u8 *data, size_t size) {
     file.open(path, std::ios::binary | std::ios::trunc);
 
     if (!file.is_open()) {
-        std::printf("[MariDS    ] Unable to open file \"%s\"\n", path);
+        Log::error("[MariDS    ] Unable to open file \"%s\"\n", path);
 
         exit(0);
     }
@@ -12,5 +12,23 @@
 /* Reads a binary file into a std::vector */
 std::vector<u8> loadBinary(const char *path);
 
+/* Reads a binary file into a buffer, returns false if the file can't be read or isn't exactly size bytes long */
+bool readBinary(const char *path, u8 *data, size_t size);
+
+/* Read-only view of a file */
+struct MappedFile {
+    const u8 *data = NULL;
+
+    size_t size = 0;
+
+    bool isMapped = false; // false = data is a heap copy
+};
+
+/* Maps a binary file read-only, data is NULL if the file can't be opened */
+MappedFile mapBinary(const char *path);
+
+/* Releases a mapped file */
+void unmapBinary(MappedFile &file);
+
 /* Writes binary data into a file */
 void saveBinary(const char *path, u8 *data, size_t size);
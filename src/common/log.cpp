@@ -0,0 +1,172 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nds::logger {
+
+// Log constants
+
+constexpr u64 MESSAGE_SIZE = 512;
+constexpr u64 RING_SIZE    = 4096; // Power of 2
+
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(2);
+
+/* Ring buffer slot, seq tells producers and the consumer whose turn it is */
+struct Slot {
+    std::atomic<u64> seq;
+
+    u32  size;
+    char text[MESSAGE_SIZE];
+};
+
+/* Bounded multi-producer ring buffer, producers never take a lock */
+struct Ring {
+    Ring() : slots(RING_SIZE) {
+        for (u64 i = 0; i < RING_SIZE; i++) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    /* Returns a free slot, or NULL if the ring is full */
+    Slot *acquire() {
+        auto pos = head.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto &slot = slots[pos & (RING_SIZE - 1)];
+
+            const auto diff = (i64)(slot.seq.load(std::memory_order_acquire) - pos);
+
+            if (!diff) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &slot;
+            } else if (diff < 0) {
+                return NULL;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* Hands a filled slot to the consumer */
+    void publish(Slot *slot) {
+        slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /* Appends all published messages to out, single consumer only */
+    void drain(std::vector<char> &out) {
+        while (true) {
+            auto &slot = slots[tail & (RING_SIZE - 1)];
+
+            if (slot.seq.load(std::memory_order_acquire) != (tail + 1)) return;
+
+            out.insert(out.end(), slot.text, slot.text + slot.size);
+
+            slot.seq.store(tail + RING_SIZE, std::memory_order_release);
+
+            tail++;
+        }
+    }
+
+private:
+    std::vector<Slot> slots;
+
+    std::atomic<u64> head = 0;
+
+    u64 tail = 0; // Guarded by the flush mutex
+};
+
+/* Owns the ring buffer and the flush thread, which is started on the first message */
+struct Flusher {
+    ~Flusher() {
+        if (thread.joinable()) {
+            isRunning.store(false, std::memory_order_relaxed);
+
+            thread.join();
+        }
+
+        drain();
+    }
+
+    void start() {
+        std::call_once(started, [this] { thread = std::thread([this] { run(); }); });
+    }
+
+    void drain() {
+        std::lock_guard lock(mtx);
+
+        buf.clear();
+
+        ring.drain(buf);
+
+        if (buf.empty()) return;
+
+        std::fwrite(buf.data(), 1, buf.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    Ring ring;
+
+private:
+    void run() {
+        while (isRunning.load(std::memory_order_relaxed)) {
+            drain();
+
+            std::this_thread::sleep_for(FLUSH_INTERVAL);
+        }
+    }
+
+    std::thread thread;
+    std::once_flag started;
+    std::atomic<bool> isRunning = true;
+
+    std::mutex mtx;
+    std::vector<char> buf;
+};
+
+/* Constructed on first use, the CPUs already log from static constructors */
+Flusher &getFlusher() {
+    static Flusher flusher;
+
+    return flusher;
+}
+
+void write(Level level, const char *fmt, ...) {
+    auto &flusher = getFlusher();
+
+    flusher.start();
+
+    // Wait for the flush thread if the ring is full, dropping messages makes traces useless
+    Slot *slot;
+
+    while ((slot = flusher.ring.acquire()) == NULL) std::this_thread::yield();
+
+    std::va_list args;
+
+    va_start(args, fmt);
+
+    const auto size = std::vsnprintf(slot->text, MESSAGE_SIZE, fmt, args);
+
+    va_end(args);
+
+    slot->size = std::clamp(size, 0, (int)MESSAGE_SIZE - 1);
+
+    flusher.ring.publish(slot);
+
+    // Errors are usually followed by exit(), get them out now
+    if (level == Level::Error) flush();
+}
+
+void flush() {
+    getFlusher().drain();
+}
+
+}
@@ -0,0 +1,79 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+namespace nds::logger {
+
+/* Log categories, one per subsystem */
+enum class Category {
+    MariDS, Bus, Fastmem, CPU, Disasm, CP15, JIT, Cartridge, AuxSPI, DMA, Firmware, INTC, IPC, Math, PPU, SPI, Timer,
+    NumCategories,
+};
+
+/* Log levels, from least to most verbose */
+enum class Level {
+    Error, Warn, Info, Debug, Trace,
+};
+
+// Most verbose level that gets compiled in, per category. Debug = MMIO accesses, Trace = IRQs, DMAs, disassembly etc.
+constexpr Level maxLevel[] = {
+    Level::Info, // MariDS
+    Level::Info, // Bus
+    Level::Info, // Fastmem
+    Level::Info, // CPU
+    Level::Info, // Disasm
+    Level::Info, // CP15
+    Level::Info, // JIT
+    Level::Info, // Cartridge
+    Level::Info, // AuxSPI
+    Level::Info, // DMA
+    Level::Info, // Firmware
+    Level::Info, // INTC
+    Level::Info, // IPC
+    Level::Info, // Math
+    Level::Info, // PPU
+    Level::Info, // SPI
+    Level::Info, // Timer
+};
+
+static_assert((sizeof(maxLevel) / sizeof(Level)) == static_cast<int>(Category::NumCategories));
+
+/* Queues a message for the flush thread, errors are flushed immediately */
+void write(Level level, const char *fmt, ...);
+
+/* Writes out all queued messages */
+void flush();
+
+template<Category category, Level level>
+constexpr bool isEnabled() {
+    return level <= maxLevel[static_cast<int>(category)];
+}
+
+/* Per-category logger, calls to disabled levels compile to nothing */
+template<Category category>
+struct Logger {
+    template<typename... Args> static void error(const char *fmt, Args... args) { log<Level::Error>(fmt, args...); }
+    template<typename... Args> static void warn (const char *fmt, Args... args) { log<Level::Warn >(fmt, args...); }
+    template<typename... Args> static void info (const char *fmt, Args... args) { log<Level::Info >(fmt, args...); }
+    template<typename... Args> static void debug(const char *fmt, Args... args) { log<Level::Debug>(fmt, args...); }
+    template<typename... Args> static void trace(const char *fmt, Args... args) { log<Level::Trace>(fmt, args...); }
+
+private:
+    template<Level level, typename... Args>
+    static void log(const char *fmt, Args... args) {
+        if constexpr (isEnabled<category, level>()) {
+            write(level, fmt, args...);
+        } else {
+            (void)fmt;
+
+            ((void)args, ...);
+        }
+    }
+};
+
+}
@@ -5,19 +5,27 @@
 
 #include "MariDS.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
-#include <vector>
+#include <cstdlib>
+#include <cstring>
 
 #include "bus.hpp"
+#include "dma.hpp"
 #include "firmware.hpp"
+#include "intc.hpp"
 #include "ipc.hpp"
+#include "math.hpp"
 #include "ppu.hpp"
 #include "scheduler.hpp"
+#include "spi.hpp"
 #include "timer.hpp"
 #include "cartridge/cartridge.hpp"
 #include "cpu/cpu.hpp"
 #include "cpu/cpuint.hpp"
+#include "cpu/cpujit.hpp"
+#include "../common/log.hpp"
 
 #include <SDL2/SDL.h>
 
@@ -25,11 +33,30 @@
 
 namespace nds {
 
+using Log = logger::Logger<logger::Category::MariDS>;
+
 // MariDS constants
 
 constexpr auto SCREEN_WIDTH  = 256;
 constexpr auto SCREEN_HEIGHT = 2 * 192;
 
+// CPU backends (false = interpreter)
+constexpr auto useJIT7 = true;
+constexpr auto useJIT9 = true;
+
+// Fast boot constants
+
+constexpr u32 HEADER_SIZE = 0x200;
+
+constexpr u32 MAIN_BASE  = 0x02000000;
+constexpr u32 WRAM_BASE  = 0x037F8000;
+constexpr u32 ARM9_LIMIT = 0x3BFE00;
+constexpr u32 ARM7_LIMIT = 0x3BFE00;
+constexpr u32 WRAM_LIMIT = 0xFE00;
+
+// Longest run slice in ARM9 cycles, lower this for timing-sensitive games
+constexpr i64 maxRunCycles = 1024;
+
 cpu::CP15 cp15;
 
 cpu::CPU arm7(7, NULL), arm9(9, &cp15);
@@ -50,6 +77,16 @@ bool inRange(u64 addr, u64 base, u64 limit) {
     return (addr >= base) && (addr < (base + limit));
 }
 
+/* Returns true if [addr;addr+size] is inside [base;base+limit] */
+bool isInside(u64 addr, u64 size, u64 base, u64 limit) {
+    return (addr >= base) && ((addr + size) <= (base + limit));
+}
+
+/* Returns true if [offset;offset+size] is inside the ROM */
+bool isInROM(const MappedFile &rom, u64 offset, u64 size) {
+    return (offset + size) <= rom.size;
+}
+
 void initSDL() {
     SDL_Init(SDL_INIT_VIDEO);
     SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
@@ -64,40 +101,44 @@ void initSDL() {
 }
 
 void init(const char *bios7Path, const char *bios9Path, const char *firmPath, const char *gamePath, bool doFastBoot) {
-    std::printf("[MariDS    ] BIOS7: \"%s\"\n[MariDS    ] BIOS9: \"%s\"\n[MariDS    ] Firmware: \"%s\"\n[MariDS    ] Game: \"%s\"\n", bios7Path, bios9Path, firmPath, gamePath);
+    Log::info("[MariDS    ] BIOS7: \"%s\"\n[MariDS    ] BIOS9: \"%s\"\n[MariDS    ] Firmware: \"%s\"\n[MariDS    ] Game: \"%s\"\n", bios7Path, bios9Path, firmPath, gamePath);
 
     if (doFastBoot) assert(gamePath); // No fast boot without a game!
 
-    scheduler::init();
+    scheduler::init(maxRunCycles);
 
     bus::init(bios7Path, bios9Path, gamePath);
     firmware::init(firmPath);
 
+    dma::init();
+    intc::init();
     ipc::init();
+    math::init();
     ppu::init();
+    spi::init();
     timer::init();
 
     cpu::interpreter::init();
-
-    scheduler::flush();
+    cpu::jit::init();
 
     if (doFastBoot) {
-        std::printf("[MariDS    ] Fast booting \"%s\"\n", gamePath);
+        Log::info("[MariDS    ] Fast booting \"%s\"\n", gamePath);
+
+        const auto &rom = cartridge::getROM();
+
+        if (rom.size < HEADER_SIZE) {
+            Log::error("[MariDS    ] Cartridge is too small for a header\n");
 
-        const auto cart = cartridge::getCart();
+            exit(0);
+        }
 
-        if (!cart->is_open()) assert(false);
+        const auto header = rom.data;
 
         // Allocate SWRAM to ARM7
         bus::setWRAMCNT(3);
 
         // Copy cartridge header to RAM
-        u8 header[0x200];
-
-        cart->seekg(0, std::ios::beg);
-        cart->read((char *)header, 0x200);
-
-        for (u32 i = 0; i < 0x170; i++) bus::write8ARM7(0x027FFE00 + i, header[i]);
+        bus::writeBlock(7, 0x027FFE00, header, 0x170);
 
         assert(!(header[0x12] & 1)); // Make sure this is not a DSi game
 
@@ -138,61 +179,30 @@ void init(const char *bios7Path, const char *bios9Path, const char *firmPath, co
         std::memcpy(&arm7Addr  , &header[0x38], 4);
         std::memcpy(&arm7Size  , &header[0x3C], 4);
 
-        std::printf("ARM9 offset = 0x%08X, entry point = 0x%08X, address = 0x%08X, size = 0x%08X\n", arm9Offset, arm9Entry, arm9Addr, arm9Size);
-
-        u32 arm9Start = 0;
+        Log::info("ARM9 offset = 0x%08X, entry point = 0x%08X, address = 0x%08X, size = 0x%08X\n", arm9Offset, arm9Entry, arm9Addr, arm9Size);
 
-        // Check for secure area
-        if ((arm9Offset >= 0x4000) && (arm9Offset < 0x8000)) {
-            u8 secureArea[0x800];
+        // Binaries must fit, the main RAM mirrors would wrap them around into the header
+        if (!isInside(arm9Addr, arm9Size, MAIN_BASE, ARM9_LIMIT) || !isInROM(rom, arm9Offset, arm9Size)) {
+            Log::error("[MariDS    ] Invalid ARM9 binary\n");
 
-            cart->seekg(arm9Offset, std::ios::beg);
-            cart->read((char *)secureArea, 0x800);
-
-            for (int i = 0; i < 0x800; i++) {
-                bus::write8ARM9(arm9Addr + i, secureArea[i]);
-            }
-
-            arm9Start += 0x800;
+            exit(0);
         }
 
-        //if (arm9Offset & 0xFFF) arm9Offset = (arm9Offset | 0xFFF) + 1; // Round up ARM9 binary offset
-
-        //assert(inRange(arm9Entry, 0x02000000, 0x3BFE00));
-        //assert(inRange(arm9Addr , 0x02000000, 0x3BFE00));
+        // Copy ARM9 binary, including the secure area
+        bus::writeBlock(9, arm9Addr, &rom.data[arm9Offset], arm9Size);
 
-        arm9Size = std::min(arm9Size, (u32)0x3BFE00);
+        Log::info("ARM7 offset = 0x%08X, entry point = 0x%08X, address = 0x%08X, size = 0x%08X\n", arm7Offset, arm7Entry, arm7Addr, arm7Size);
 
-        std::vector<u8> arm9Binary;
+        const auto isWRAM = arm7Addr >= WRAM_BASE;
 
-        arm9Binary.resize(arm9Size);
+        if (!((isWRAM) ? isInside(arm7Addr, arm7Size, WRAM_BASE, WRAM_LIMIT) : isInside(arm7Addr, arm7Size, MAIN_BASE, ARM7_LIMIT)) || !isInROM(rom, arm7Offset, arm7Size)) {
+            Log::error("[MariDS    ] Invalid ARM7 binary\n");
 
-        cart->seekg(arm9Offset, std::ios::beg);
-        cart->read((char *)arm9Binary.data(), arm9Size);
-
-        // Copy ARM9 binary
-        for (u32 i = arm9Start; i < arm9Size; i++) {
-            bus::write8ARM9(arm9Addr + i, arm9Binary[i]);
+            exit(0);
         }
 
-        std::printf("ARM7 offset = 0x%08X, entry point = 0x%08X, address = 0x%08X, size = 0x%08X\n", arm7Offset, arm7Entry, arm7Addr, arm7Size);
-
-        //assert(inRange(arm7Entry, 0x02000000, 0x3BFE00) || inRange(arm7Entry, 0x037F8000, 0xFE00));
-        //assert(inRange(arm7Addr , 0x02000000, 0x3BFE00) || inRange(arm7Addr , 0x037F8000, 0xFE00));
-
-        arm7Size = (arm7Addr >= 0x037F8000) ? std::min(arm7Size, (u32)0xFE00) : std::min(arm7Size, (u32)0x3BFE00);
-
-        std::vector<u8> arm7Binary;
-
-        arm7Binary.resize(arm7Size);
-
-        cart->seekg(arm7Offset, std::ios::beg);
-        cart->read((char *)arm7Binary.data(), arm7Size);
-
         // Copy ARM7 binary
-        for (u32 i = 0; i < arm7Size; i++) {
-            bus::write8ARM7(arm7Addr + i, arm7Binary[i]);
-        }
+        bus::writeBlock(7, arm7Addr, &rom.data[arm7Offset], arm7Size);
 
         // Set CPU entry points
         arm7.setEntry(arm7Entry);
@@ -245,17 +255,30 @@ u32 getKEYINPUT() {
 }
 
 void run() {
+    i64 cycles7 = 0; // ARM7 runs at half the ARM9's clock, odd slices carry half a cycle over
+
     while (isRunning) {
+        // Skip to the next event if nothing can run until then, halted CPUs get no cycles for the skipped time
+        if (arm7.isHalted && arm9.isHalted) {
+            const auto cyclesUntilEvent = scheduler::getCyclesUntilNextEvent();
+
+            assert(cyclesUntilEvent != INT64_MAX); // The PPU always has an event pending
+
+            scheduler::processEvents(std::clamp<i64>(cyclesUntilEvent, 0, maxRunCycles));
+
+            continue;
+        }
+
         const auto runCycles = scheduler::getRunCycles();
 
         scheduler::processEvents(runCycles);
 
-        cpu::interpreter::run(&arm9, runCycles);      // 2 CPI
-        cpu::interpreter::run(&arm7, runCycles >> 1); // 2 CPI
+        (useJIT9) ? cpu::jit::run(&arm9, runCycles) : cpu::interpreter::run(&arm9, runCycles); // 2 CPI
+        cycles7 += runCycles;
 
-        timer::run(runCycles);
+        (useJIT7) ? cpu::jit::run(&arm7, cycles7 >> 1) : cpu::interpreter::run(&arm7, cycles7 >> 1); // 2 CPI
 
-        scheduler::flush();
+        cycles7 &= 1;
     }
 }
 
@@ -5,21 +5,35 @@
 
 #include "bus.hpp"
 
+#include <algorithm>
 #include <cstdio>
+#include <iterator>
 
-#include "dma.hpp"
+#include "fastmem.hpp"
 #include "intc.hpp"
 #include "ipc.hpp"
 #include "MariDS.hpp"
-#include "math.hpp"
 #include "ppu.hpp"
-#include "spi.hpp"
-#include "timer.hpp"
 #include "cartridge/cartridge.hpp"
+#include "cpu/cpuint.hpp"
 #include "../common/file.hpp"
+#include "../common/log.hpp"
+
+namespace nds::cpu {
+
+// Tightly coupled memory, the ARM9 page tables map it over the bus
+extern u8 *itcm;
+extern u8 *dtcm;
+
+extern u32 itcmBase , dtcmBase;
+extern u32 itcmLimit, dtcmLimit;
+
+}
 
 namespace nds::bus {
 
+using Log = logger::Logger<logger::Category::Bus>;
+
 // NDS memory regions
 
 /* ARM7 base addresses */
@@ -81,19 +95,19 @@ enum class Memory9Limit : u32 {
 
 // NDS ARM7 memory
 
-std::vector<u8> bios7;
-std::vector<u8> wram;
+u8 *bios7;
+u8 *wram;
 
-u8 wifi[static_cast<int>(Memory7Limit::WiFi)];
+u8 *wifi;
 
 // NDS ARM9 memory
 
-std::vector<u8> bios9;
+u8 *bios9;
 
 // NDS shared memory
 
-std::vector<u8> mainMem;
-std::vector<u8> swram;
+u8 *mainMem;
+u8 *swram;
 
 // Registers
 
@@ -106,34 +120,269 @@ u16 exmem7, exmem9;
 u8  *swram7, *swram9;
 u32 swramLimit7, swramLimit9;
 
+// Page tables, NULL if a page isn't plain memory
+u8 *readPages7[PAGE_NUM], *writePages7[PAGE_NUM];
+u8 *readPages9[PAGE_NUM], *writePages9[PAGE_NUM];
+
+/* MMIO handler tables, indexed by (addr - MMIO_BASE) / access width */
+struct MMIOTable {
+    Read8Func  read8 [MMIO_SIZE];
+    Read16Func read16[MMIO_SIZE / 2];
+    Read32Func read32[MMIO_SIZE / 4];
+
+    Write8Func  write8 [MMIO_SIZE];
+    Write16Func write16[MMIO_SIZE / 2];
+    Write32Func write32[MMIO_SIZE / 4];
+};
+
+MMIOTable mmio7, mmio9;
+
 /* Returns true if address is in range [base;limit] */
 bool inRange(u64 addr, u64 base, u64 limit) {
     return (addr >= base) && (addr < (base + limit));
 }
 
+/* Returns the handler registered for an MMIO address, NULL if there is none */
+template<typename Func, u32 N>
+Func getHandler(Func (&table)[N], u32 addr) {
+    const auto offset = addr - MMIO_BASE; // Wraps around for addresses below MMIO
+
+    return (offset < MMIO_SIZE) ? table[offset / (MMIO_SIZE / N)] : NULL;
+}
+
+/* Registers an MMIO handler for [addr;addr+size], later registrations override earlier ones */
+template<typename Func, u32 N>
+void setHandler(Func (&table)[N], u32 addr, u32 size, Func func) {
+    constexpr auto width = MMIO_SIZE / N;
+
+    assert((addr >= MMIO_BASE) && ((addr + size) <= (MMIO_BASE + MMIO_SIZE)) && !(addr & (width - 1)));
+
+    for (u32 offset = addr - MMIO_BASE; offset < (addr - MMIO_BASE + size); offset += width) table[offset / width] = func;
+}
+
+MMIOTable &getMMIOTable(int cpuID) {
+    assert((cpuID == 7) || (cpuID == 9));
+
+    return (cpuID == 7) ? mmio7 : mmio9;
+}
+
+void registerRead8(int cpuID, u32 addr, u32 size, Read8Func func) {
+    setHandler(getMMIOTable(cpuID).read8, addr, size, func);
+}
+
+void registerRead16(int cpuID, u32 addr, u32 size, Read16Func func) {
+    setHandler(getMMIOTable(cpuID).read16, addr, size, func);
+}
+
+void registerRead32(int cpuID, u32 addr, u32 size, Read32Func func) {
+    setHandler(getMMIOTable(cpuID).read32, addr, size, func);
+}
+
+void registerWrite8(int cpuID, u32 addr, u32 size, Write8Func func) {
+    setHandler(getMMIOTable(cpuID).write8, addr, size, func);
+}
+
+void registerWrite16(int cpuID, u32 addr, u32 size, Write16Func func) {
+    setHandler(getMMIOTable(cpuID).write16, addr, size, func);
+}
+
+void registerWrite32(int cpuID, u32 addr, u32 size, Write32Func func) {
+    setHandler(getMMIOTable(cpuID).write32, addr, size, func);
+}
+
+/* Registers the registers that don't belong to a subsystem */
+void registerMMIO() {
+    // ARM7
+    registerRead8(7, MMIO_BASE + 0x138, 1, [](u32) -> u8 {
+        Log::debug("[Bus:ARM7  ] Read8 @ RTC\n");
+        return 0;
+    });
+    registerRead8(7, MMIO_BASE + 0x300, 1, [](u32) -> u8 {
+        Log::debug("[Bus:ARM7  ] Read8 @ POSTFLG\n");
+        return postflg7;
+    });
+    registerRead8(7, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound), [](u32 addr) -> u8 {
+        Log::debug("[Bus:ARM7  ] Unhandled read8 @ 0x%08X (Sound)\n", addr);
+        return 0;
+    });
+
+    registerRead16(7, MMIO_BASE + 0x130, 2, [](u32) -> u16 {
+        return (u16)getKEYINPUT();
+    });
+    registerRead16(7, MMIO_BASE + 0x134, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM7  ] Read16 @ RCNT\n");
+        return 0x8000;
+    });
+    registerRead16(7, MMIO_BASE + 0x136, 2, [](u32) -> u16 {
+        return getKEYINPUT() >> 16;
+    });
+    registerRead16(7, MMIO_BASE + 0x138, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM7  ] Read16 @ RTC\n");
+        return 0;
+    });
+    registerRead16(7, MMIO_BASE + 0x204, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM7  ] Read16 @ EXMEMSTAT\n");
+        return exmem7;
+    });
+    registerRead16(7, MMIO_BASE + 0x300, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM7  ] Read16 @ POSTFLG\n");
+        return postflg7;
+    });
+    registerRead16(7, MMIO_BASE + 0x304, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM7  ] Read16 @ POWCNT2\n");
+        return 0;
+    });
+    registerRead16(7, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound), [](u32 addr) -> u16 {
+        Log::debug("[Bus:ARM7  ] Unhandled read16 @ 0x%08X (Sound)\n", addr);
+        return 0;
+    });
+
+    registerRead32(7, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound), [](u32 addr) -> u32 {
+        Log::debug("[Bus:ARM7  ] Unhandled read32 @ 0x%08X (Sound)\n", addr);
+        return 0;
+    });
+
+    registerWrite8(7, MMIO_BASE + 0x138, 1, [](u32, u8 data) {
+        Log::debug("[Bus:ARM7  ] Write8 @ RTC = 0x%02X\n", data);
+    });
+    registerWrite8(7, MMIO_BASE + 0x301, 1, [](u32, u8 data) {
+        Log::debug("[Bus:ARM7  ] Write8 @ HALTCNT = 0x%02X\n", data);
+
+        if (data & (1 << 7)) haltCPU(7);
+    });
+    registerWrite8(7, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound), [](u32 addr, u8 data) {
+        Log::debug("[Bus:ARM7  ] Unhandled write8 @ 0x%08X (Sound) = 0x%02X\n", addr, data);
+    });
+
+    registerWrite16(7, MMIO_BASE + 0x134, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM7  ] Write16 @ RCNT = 0x%04X\n", data);
+    });
+    registerWrite16(7, MMIO_BASE + 0x138, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM7  ] Write16 @ RTC = 0x%04X\n", data);
+    });
+    registerWrite16(7, MMIO_BASE + 0x204, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM7  ] Write16 @ EXMEMCNT = 0x%04X\n", data);
+
+        exmem7 = (exmem7 & 0xFF80) | (data & 0x7F);
+    });
+    registerWrite16(7, MMIO_BASE + 0x206, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM7  ] Write16 @ WIFIWAITCNT = 0x%04X\n", data);
+    });
+    registerWrite16(7, MMIO_BASE + 0x304, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM7  ] Write16 @ POWCNT2 = 0x%04X\n", data);
+    });
+    registerWrite16(7, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound), [](u32 addr, u16 data) {
+        Log::debug("[Bus:ARM7  ] Unhandled write16 @ 0x%08X (Sound) = 0x%04X\n", addr, data);
+    });
+
+    registerWrite32(7, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound), [](u32 addr, u32 data) {
+        Log::debug("[Bus:ARM7  ] Unhandled write32 @ 0x%08X (Sound) = 0x%08X\n", addr, data);
+    });
+
+    // ARM9
+    registerRead8(9, MMIO_BASE + 0x300, 1, [](u32) -> u8 {
+        Log::debug("[Bus:ARM9  ] Read8 @ POSTFLG\n");
+        return postflg9;
+    });
+
+    registerRead16(9, MMIO_BASE + 0x130, 2, [](u32) -> u16 {
+        return (u16)getKEYINPUT();
+    });
+    registerRead16(9, MMIO_BASE + 0x204, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM9  ] Read16 @ EXMEMCNT\n");
+        return exmem9;
+    });
+    registerRead16(9, MMIO_BASE + 0x300, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM9  ] Read16 @ POSTFLG\n");
+        return postflg9;
+    });
+    registerRead16(9, MMIO_BASE + 0x304, 2, [](u32) -> u16 {
+        Log::debug("[Bus:ARM9  ] Read16 @ POWCNT1\n");
+        return 0;
+    });
+
+    registerRead32(9, static_cast<u32>(Memory9Base::DISP3D), 0x384, [](u32 addr) -> u32 {
+        Log::debug("[Bus:ARM9  ] Unhandled read32 @ 0x%08X (3D Display Engine)\n", addr);
+        return std::rand();
+    });
+
+    registerWrite8(9, MMIO_BASE + 0x247, 1, [](u32, u8 data) {
+        Log::debug("[Bus:ARM9  ] Write8 @ WRAMCNT = 0x%02X\n", data);
+
+        setWRAMCNT(data & 3);
+    });
+
+    registerWrite16(9, MMIO_BASE + 0x204, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM9  ] Write16 @ EXMEMCNT = 0x%04X\n", data);
+
+        exmem7 = (data & 0xFF80) | (exmem7 & 0x7F);
+        exmem9 = data;
+
+        if (data & (1 << 11)) {
+            cartridge::setARM7Access();
+        } else {
+            cartridge::setARM9Access();
+        }
+    });
+    registerWrite16(9, MMIO_BASE + 0x304, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM9  ] Write16 @ POWCNT1 = 0x%04X\n", data);
+    });
+    registerWrite16(9, static_cast<u32>(Memory9Base::DISP3D), 0x384, [](u32 addr, u16 data) {
+        Log::debug("[Bus:ARM9  ] Unhandled write16 @ 0x%08X (3D Display Engine) = 0x%08X\n", addr, data);
+    });
+
+    registerWrite32(9, MMIO_BASE + 0x304, 4, [](u32, u32 data) {
+        Log::debug("[Bus:ARM9  ] Write32 @ POWCNT1 = 0x%08X\n", data);
+    });
+    registerWrite32(9, static_cast<u32>(Memory9Base::DISP3D), 0x384, [](u32 addr, u32 data) {
+        Log::debug("[Bus:ARM9  ] Unhandled write32 @ 0x%08X (3D Display Engine) = 0x%08X\n", addr, data);
+
+        intc::sendInterrupt9(intc::IntSource::GXFIFO);
+    });
+}
+
 void init(const char *bios7Path, const char *bios9Path, const char *gamePath) {
-    bios7 = loadBinary(bios7Path);
-    bios9 = loadBinary(bios9Path);
+    fastmem::init();
+
+    bios7   = fastmem::getMemory(fastmem::Region::BIOS7);
+    bios9   = fastmem::getMemory(fastmem::Region::BIOS9);
+    mainMem = fastmem::getMemory(fastmem::Region::Main);
+    swram   = fastmem::getMemory(fastmem::Region::SWRAM);
+    wram    = fastmem::getMemory(fastmem::Region::WRAM);
+    wifi    = fastmem::getMemory(fastmem::Region::WiFi);
 
-    assert(bios7.size() == 0x4000); // 16KB
-    assert(bios9.size() == 0x1000); // 4KB
+    cpu::itcm = fastmem::getMemory(fastmem::Region::ITCM);
+    cpu::dtcm = fastmem::getMemory(fastmem::Region::DTCM);
 
-    cartridge::init(gamePath, bios7.data());
+    // Read BIOS images straight into guest memory
+    if (!readBinary(bios7Path, bios7, 0x4000)) { // 16KB
+        Log::error("[Bus       ] Unable to load BIOS7 \"%s\"\n", bios7Path);
+
+        exit(0);
+    }
+
+    if (!readBinary(bios9Path, bios9, 0x1000)) { // 4KB
+        Log::error("[Bus       ] Unable to load BIOS9 \"%s\"\n", bios9Path);
+
+        exit(0);
+    }
 
-    mainMem.resize(static_cast<u32>(Memory9Limit::Main));
-    swram.resize(static_cast<u32>(Memory7Limit::SWRAM));
-    wram.resize(static_cast<u32>(Memory7Limit::WRAM));
+    registerMMIO();
+
+    cartridge::init(gamePath, bios7);
 
     setWRAMCNT(0);
 
+    remapARM9();
+
     postflg7 = postflg9 = 0;
 
-    std::printf("[Bus       ] OK!\n");
+    Log::info("[Bus       ] OK!\n");
 }
 
 // Sets both POSTFLG registers
 void setPOSTFLG(u8 data) {
-    std::printf("POSTFLG = %u\n", data);
+    Log::debug("POSTFLG = %u\n", data);
     
     postflg7 = postflg9 = data;
 }
@@ -141,36 +390,122 @@ void setPOSTFLG(u8 data) {
 void setWRAMCNT(u8 data) {
     wramcnt = data & 3;
 
-    std::printf("WRAMCNT = %u\n", wramcnt);
+    Log::debug("WRAMCNT = %u\n", wramcnt);
 
     switch (wramcnt) {
         case 0: // Full allocation to ARM9 (ARM7 SWRAM is mapped to ARM7 WRAM)
-            swram7 = wram.data();
-            swram9 = swram.data();
+            swram7 = wram;
+            swram9 = swram;
 
             swramLimit7 = 0xFFFF;
             swramLimit9 = 0x7FFF;
             break;
         case 1: // Second half to ARM9, first half to ARM7
-            swram7 = swram.data();
-            swram9 = swram.data() + 0x4000;
+            swram7 = swram;
+            swram9 = swram + 0x4000;
 
             swramLimit7 = swramLimit9 = 0x3FFF;
             break;
         case 2: // First half to ARM9, second half to ARM7
-            swram7 = swram.data() + 0x4000;
-            swram9 = swram.data();
+            swram7 = swram + 0x4000;
+            swram9 = swram;
 
             swramLimit7 = swramLimit9 = 0x3FFF;
             break;
         case 3: // Full allocation to ARM7 (ARM9 SWRAM is unmapped)
-            swram7 = swram.data();
+            swram7 = swram;
             swram9 = NULL;
 
             swramLimit7 = 0x7FFF;
             swramLimit9 = 0;
             break;
     }
+
+    remapARM7();
+
+    fastmem::remapARM7(swram7, swramLimit7);
+
+    cpu::interpreter::flushBlocks();
+}
+
+/* Maps [base;base+size] to the mirrors of a host memory region */
+void mapPages(u8 **pages, u32 base, u32 size, u8 *mem, u32 mask) {
+    assert(mask >= PAGE_MASK);
+
+    assert(((u64)base + size) <= PAGE_LIMIT);
+
+    for (u64 addr = base; addr < ((u64)base + size); addr += PAGE_SIZE) pages[addr >> PAGE_SHIFT] = &mem[addr & mask];
+}
+
+/* Maps TCM over the ARM9 page tables. Pages that are only partially covered by TCM go through the slow path */
+void mapTCM(u8 *mem, u32 base, u32 limit, u32 mask) {
+    const u64 end = std::min((u64)base + limit, (u64)PAGE_LIMIT);
+
+    for (u64 addr = base & ~PAGE_MASK; addr < end; addr += PAGE_SIZE) {
+        const auto isFullPage = (addr >= base) && ((addr + PAGE_SIZE) <= end) && (mask >= PAGE_MASK);
+
+        readPages9[addr >> PAGE_SHIFT] = writePages9[addr >> PAGE_SHIFT] = (isFullPage) ? &mem[addr & mask] : NULL;
+    }
+}
+
+/* Rebuilds the ARM7 page tables, required if the memory map changes */
+void remapARM7() {
+    std::fill(std::begin(readPages7) , std::end(readPages7) , nullptr);
+    std::fill(std::begin(writePages7), std::end(writePages7), nullptr);
+
+    mapPages(readPages7, static_cast<u32>(Memory7Base::BIOS), static_cast<u32>(Memory7Limit::BIOS), bios7, static_cast<u32>(Memory7Limit::BIOS) - 1);
+
+    for (auto pages : {readPages7, writePages7}) {
+        mapPages(pages, static_cast<u32>(Memory7Base::Main ), 4 * static_cast<u32>(Memory7Limit::Main), mainMem, static_cast<u32>(Memory7Limit::Main) - 1);
+        mapPages(pages, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM), swram7, swramLimit7);
+        mapPages(pages, static_cast<u32>(Memory7Base::WRAM ), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM), wram, static_cast<u32>(Memory7Limit::WRAM) - 1);
+    }
+}
+
+/* Maps LCDC VRAM into the ARM9 page tables */
+void mapLCDC() {
+    for (auto pages : {readPages9, writePages9}) {
+        for (u32 addr = static_cast<u32>(Memory9Base::LCDC); addr < (static_cast<u32>(Memory9Base::LCDC) + static_cast<u32>(Memory9Limit::LCDC)); addr += PAGE_SIZE) {
+            pages[addr >> PAGE_SHIFT] = ppu::getLCDCPointer(addr);
+        }
+    }
+}
+
+/* Maps TCM over the ARM9 page tables, ITCM has priority over DTCM */
+void mapTCMs() {
+    mapTCM(cpu::dtcm, cpu::dtcmBase, cpu::dtcmLimit, 0x3FFF);
+    mapTCM(cpu::itcm, cpu::itcmBase, cpu::itcmLimit, 0x7FFF);
+}
+
+/* Rebuilds the ARM9 page tables, required if the memory map or TCM change */
+void remapARM9() {
+    std::fill(std::begin(readPages9) , std::end(readPages9) , nullptr);
+    std::fill(std::begin(writePages9), std::end(writePages9), nullptr);
+
+    for (auto pages : {readPages9, writePages9}) {
+        mapPages(pages, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main), mainMem, static_cast<u32>(Memory9Limit::Main) - 1);
+    }
+
+    mapLCDC();
+    mapTCMs();
+
+    fastmem::remapARM9();
+}
+
+/* Rebuilds the LCDC VRAM pages only, required if VRAMCNT changes. LCDC VRAM isn't in the fastmem arena */
+void remapLCDC() {
+    mapLCDC();
+
+    // TCM mapped over LCDC VRAM keeps priority
+    mapTCMs();
+}
+
+u8 **getReadPages(int cpuID) {
+    return (cpuID == 7) ? readPages7 : readPages9;
+}
+
+u8 **getWritePages(int cpuID) {
+    return (cpuID == 7) ? writePages7 : writePages9;
 }
 
 u8 read8ARM7(u32 addr) {
@@ -182,32 +517,15 @@ u8 read8ARM7(u32 addr) {
         return swram7[addr & swramLimit7];
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
         return wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)];
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound))) {
-        std::printf("[Bus:ARM7  ] Unhandled read8 @ 0x%08X (Sound)\n", addr);
-
-        return 0;
+    } else if (const auto func = getHandler(mmio7.read8, addr); func != NULL) {
+        return func(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::GBA0), static_cast<u32>(Memory9Limit::GBA0))) {
         return 0;
-    } else {
-        switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x138:
-                std::printf("[Bus:ARM7  ] Read8 @ RTC\n");
-                return 0;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C2:
-                std::printf("[SPI       ] Read8 @ SPIDATA\n");
-                return spi::readSPIDATA();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x240:
-                std::printf("[Bus:ARM7  ] Read8 @ VRAMSTAT\n");
-                return ppu::readVRAMSTAT();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x300:
-                std::printf("[Bus:ARM7  ] Read8 @ POSTFLG\n");
-                return postflg7;
-            default:
-                std::printf("[Bus:ARM7  ] Unhandled read8 @ 0x%08X\n", addr);
-
-                exit(0);
-        }
     }
+
+    Log::error("[Bus:ARM7  ] Unhandled read8 @ 0x%08X\n", addr);
+
+    exit(0);
 }
 
 u16 read16ARM7(u32 addr) {
@@ -220,65 +538,20 @@ u16 read16ARM7(u32 addr) {
     } else if (inRange(addr, static_cast<u32>(Memory7Base::Main), 4 * static_cast<u32>(Memory7Limit::Main))) {
         std::memcpy(&data, &mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)], sizeof(u16));
     } else if (inRange(addr, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM))) {
-        std::memcpy(&data, &swram[addr & swramLimit7], sizeof(u16));
+        std::memcpy(&data, &swram7[addr & swramLimit7], sizeof(u16));
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
         std::memcpy(&data, &wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)], sizeof(u16));
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::DMA), 0x30)) {
-        return dma::read16ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Timer), 0x10)) {
-        return timer::read16ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::IPC), 0x10)) {
-        return ipc::read16ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::read16ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::INTC), 0x10)) {
-        return intc::read16ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound))) {
-        std::printf("[Bus:ARM7  ] Unhandled read16 @ 0x%08X (Sound)\n", addr);
-
-        return 0;
+    } else if (const auto func = getHandler(mmio7.read16, addr); func != NULL) {
+        return func(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::GBA0), static_cast<u32>(Memory9Limit::GBA0))) {
         return 0;
     } else {
         switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 4:
-                //std::printf("[Bus:ARM7  ] Read16 @ DISPSTAT\n");
-                return ppu::readDISPSTAT7();
-            case static_cast<u32>(Memory9Base::MMIO) + 6:
-                //std::printf("[Bus:ARM7  ] Read16 @ VCOUNT\n");
-                return ppu::readVCOUNT();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x130:
-                //std::printf("[Bus:ARM7  ] Read16 @ KEYINPUT\n");
-                return (u16)getKEYINPUT();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x134:
-                std::printf("[Bus:ARM7  ] Read16 @ RCNT\n");
-                return 0x8000;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x136:
-                //std::printf("[Bus:ARM7  ] Read16 @ EXTKEYIN\n");
-                return getKEYINPUT() >> 16;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x138:
-                std::printf("[Bus:ARM7  ] Read16 @ RTC\n");
-                return 0;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C0:
-                std::printf("[SPI       ] Read16 @ SPICNT\n");
-                return spi::readSPICNT();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C2:
-                std::printf("[SPI       ] Read16 @ SPIDATA\n");
-                return spi::readSPIDATA();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x204:
-                std::printf("[Bus:ARM7  ] Read16 @ EXMEMSTAT\n");
-                return exmem7;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x300:
-                std::printf("[Bus:ARM7  ] Read16 @ POSTFLG\n");
-                return postflg7;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x304:
-                std::printf("[Bus:ARM7  ] Read16 @ POWCNT2\n");
-                return 0;
             case static_cast<u32>(Memory9Base::MMIO) + 0x4700:
-                std::printf("[Bus:ARM7  ] Read32 @ SNDEXCNT\n");
+                Log::debug("[Bus:ARM7  ] Read32 @ SNDEXCNT\n");
                 return 0;
             default:
-                std::printf("[Bus:ARM7  ] Unhandled read16 @ 0x%08X\n", addr);
+                Log::error("[Bus:ARM7  ] Unhandled read16 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -297,39 +570,27 @@ u32 read32ARM7(u32 addr) {
     } else if (inRange(addr, static_cast<u32>(Memory7Base::Main), 4 * static_cast<u32>(Memory7Limit::Main))) {
         std::memcpy(&data, &mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)], sizeof(u32));
     } else if (inRange(addr, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM))) {
-        std::memcpy(&data, &swram[addr & swramLimit7], sizeof(u32));
+        std::memcpy(&data, &swram7[addr & swramLimit7], sizeof(u32));
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
         std::memcpy(&data, &wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)], sizeof(u32));
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::DMA), 0x30)) {
-        return dma::read32ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::read32ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::INTC), 0x10)) {
-        return intc::read32ARM7(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound))) {
-        std::printf("[Bus:ARM7  ] Unhandled read32 @ 0x%08X (Sound)\n", addr);
-
-        return 0;
+    } else if (const auto func = getHandler(mmio7.read32, addr); func != NULL) {
+        return func(addr);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::VRAM), static_cast<u32>(Memory7Limit::VRAM))) {
         return ppu::readWRAM32(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::GBA0), static_cast<u32>(Memory9Limit::GBA0))) {
         return 0;
     } else {
         switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C0:
-                std::printf("[SPI       ] Read32 @ SPICNT\n"); // And SPIDATA??
-                //return (u32)spi::readSPICNT() | ((u32)spi::readSPIDATA() << 16);
-                return spi::readSPICNT();
             case static_cast<u32>(Memory9Base::MMIO) + 0x4008:
-                std::printf("[Bus:ARM7  ] Read32 @ SCFG_EXT7\n");
+                Log::debug("[Bus:ARM7  ] Read32 @ SCFG_EXT7\n");
                 return 0;
             case static_cast<u32>(Memory9Base::MMIO) + 0x100000:
-                std::printf("[Bus:ARM7  ] Read32 @ IPCFIFORECV\n");
+                Log::debug("[Bus:ARM7  ] Read32 @ IPCFIFORECV\n");
                 return ipc::readRECV7();
             case static_cast<u32>(Memory9Base::MMIO) + 0x100010:
                 return cartridge::readROMDATA();
             default:
-                std::printf("[Bus:ARM7  ] Unhandled read32 @ 0x%08X\n", addr);
+                Log::error("[Bus:ARM7  ] Unhandled read32 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -341,8 +602,8 @@ u32 read32ARM7(u32 addr) {
 u8 read8ARM9(u32 addr) {
     if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
         return mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)];
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::INTC), 0x10)) {
-        return intc::read32ARM9(addr);
+    } else if (const auto func = getHandler(mmio9.read8, addr); func != NULL) {
+        return func(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
         return ppu::readVRAM8(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::LCDC), static_cast<u32>(Memory9Limit::LCDC))) {
@@ -351,14 +612,11 @@ u8 read8ARM9(u32 addr) {
         return 0;
     } else {
         switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x300:
-                std::printf("[Bus:ARM9  ] Read8 @ POSTFLG\n");
-                return postflg9;
             case static_cast<u32>(Memory9Base::MMIO) + 0x4000:
-                std::printf("[Bus:ARM7  ] Read32 @ SCFG_A9ROM\n");
+                Log::debug("[Bus:ARM7  ] Read32 @ SCFG_A9ROM\n");
                 return 0;
             default:
-                std::printf("[Bus:ARM9  ] Unhandled read8 @ 0x%08X\n", addr);
+                Log::error("[Bus:ARM9  ] Unhandled read8 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -374,22 +632,8 @@ u16 read16ARM9(u32 addr) {
 
     if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
         std::memcpy(&data, &mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)], sizeof(u16));
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPA), 0x70)) {
-        return ppu::read16(0, addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DMA), 0x40)) {
-        return dma::read16ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Timer), 0x10)) {
-        return timer::read16ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::IPC), 0x10)) { // Same memory base as ARM7
-        return ipc::read16ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Cart), 0x1C)) {
-        return cartridge::read16ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Math), 0x40)) {
-        return math::read16(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::INTC), 0x10)) {
-        return intc::read16ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPB), 0x70)) {
-        return ppu::read16(1, addr);
+    } else if (const auto func = getHandler(mmio9.read16, addr); func != NULL) {
+        return func(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
         return ppu::readVRAM16(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::LCDC), static_cast<u32>(Memory9Limit::LCDC))) {
@@ -400,23 +644,11 @@ u16 read16ARM9(u32 addr) {
         std::memcpy(&data, &bios9[addr & 0xFFE], sizeof(u16));
     } else {
         switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x130:
-                //std::printf("[Bus:ARM9  ] Read16 @ KEYINPUT\n");
-                return (u16)getKEYINPUT();
-            case static_cast<u32>(Memory9Base::MMIO) + 0x204:
-                std::printf("[Bus:ARM9  ] Read16 @ EXMEMCNT\n");
-                return exmem9;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x300:
-                std::printf("[Bus:ARM9  ] Read16 @ POSTFLG\n");
-                return postflg9;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x304:
-                std::printf("[Bus:ARM9  ] Read16 @ POWCNT1\n");
-                return 0;
             case static_cast<u32>(Memory9Base::MMIO) + 0x4010:
-                std::printf("[Bus:ARM9  ] Read16 @ SCFG_MC\n");
+                Log::debug("[Bus:ARM9  ] Read16 @ SCFG_MC\n");
                 return 0;
             default:
-                std::printf("[Bus:ARM9  ] Unhandled read16 @ 0x%08X\n", addr);
+                Log::error("[Bus:ARM9  ] Unhandled read16 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -432,22 +664,8 @@ u32 read32ARM9(u32 addr) {
 
     if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
         std::memcpy(&data, &mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)], sizeof(u32));
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPA), 0x70)) {
-        return ppu::read32(0, addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DMA), 0x40)) {
-        return dma::read32ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Cart), 0x1C)) {
-        return cartridge::read32ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::INTC), 0x10)) {
-        return intc::read32ARM9(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Math), 0x40)) {
-        return math::read32(addr);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISP3D), 0x384)) {
-        std::printf("[Bus:ARM9  ] Unhandled read32 @ 0x%08X (3D Display Engine)\n", addr);
-
-        return std::rand();
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPB), 0x70)) {
-        return ppu::read32(1, addr);
+    } else if (const auto func = getHandler(mmio9.read32, addr); func != NULL) {
+        return func(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
         return ppu::readVRAM32(addr);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::LCDC), static_cast<u32>(Memory9Limit::LCDC))) {
@@ -458,27 +676,19 @@ u32 read32ARM9(u32 addr) {
         std::memcpy(&data, &bios9[addr & 0xFFC], sizeof(u32));
     } else {
         switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x240:
-                std::printf("[Bus:ARM9  ] Read32 @ VRAMCNT_A/B/C/D\n");
-
-                data  = (u32)ppu::readVRAMCNT(0);
-                data |= (u32)ppu::readVRAMCNT(1) <<  8;
-                data |= (u32)ppu::readVRAMCNT(2) << 16;
-                data |= (u32)ppu::readVRAMCNT(3) << 24;
-                break;
             case static_cast<u32>(Memory9Base::MMIO) + 0x4000:
-                std::printf("[Bus:ARM9  ] Read32 @ SCFG_A9ROM\n");
+                Log::debug("[Bus:ARM9  ] Read32 @ SCFG_A9ROM\n");
                 return 0;
             case static_cast<u32>(Memory9Base::MMIO) + 0x4008:
-                std::printf("[Bus:ARM9  ] Read32 @ SCFG_EXT9\n");
+                Log::debug("[Bus:ARM9  ] Read32 @ SCFG_EXT9\n");
                 return 0;
             case static_cast<u32>(Memory9Base::MMIO) + 0x100000:
-                std::printf("[Bus:ARM9  ] Read32 @ IPCFIFORECV\n");
+                Log::debug("[Bus:ARM9  ] Read32 @ IPCFIFORECV\n");
                 return ipc::readRECV9();
             case static_cast<u32>(Memory9Base::MMIO) + 0x100010:
                 return cartridge::readROMDATA();
             default:
-                std::printf("[Bus:ARM9  ] Unhandled read32 @ 0x%08X\n", addr);
+                Log::error("[Bus:ARM9  ] Unhandled read32 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -489,39 +699,25 @@ u32 read32ARM9(u32 addr) {
 
 void write8ARM7(u32 addr, u8 data) {
     if (inRange(addr, static_cast<u32>(Memory7Base::BIOS), static_cast<u32>(Memory7Limit::BIOS))) {
-        std::printf("[Bus:ARM7  ] Bad write8 @ BIOS (0x%08X) = 0x%02X\n", addr, data);
+        Log::warn("[Bus:ARM7  ] Bad write8 @ BIOS (0x%08X) = 0x%02X\n", addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::Main), 4 * static_cast<u32>(Memory7Limit::Main))) {
         mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)] = data;
+
+        cpu::interpreter::invalidateBlocks(&mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)]);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM))) {
         swram7[addr & swramLimit7] = data;
+
+        cpu::interpreter::invalidateBlocks(&swram7[addr & swramLimit7]);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
         wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)] = data;
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::write8ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::INTC), 0x10)) {
-        return intc::write8ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound))) {
-        std::printf("[Bus:ARM7  ] Unhandled write8 @ 0x%08X (Sound) = 0x%02X\n", addr, data);
-
-        return;
+
+        cpu::interpreter::invalidateBlocks(&wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)]);
+    } else if (const auto func = getHandler(mmio7.write8, addr); func != NULL) {
+        return func(addr, data);
     } else {
-        switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x138:
-                std::printf("[Bus:ARM7  ] Write8 @ RTC = 0x%02X\n", data);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C2:
-                std::printf("[SPI       ] Write8 @ SPIDATA = 0x%02X\n", data);
-                return spi::writeSPIDATA(data);
-            case static_cast<u32>(Memory7Base::MMIO) + 0x301:
-                std::printf("[Bus:ARM7  ] Write8 @ HALTCNT = 0x%02X\n", data);
-
-                if (data & (1 << 7)) haltCPU(7);
-                break;
-            default:
-                std::printf("[Bus:ARM7  ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
+        Log::error("[Bus:ARM7  ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
 
-                exit(0);
-        }
+        exit(0);
     }
 }
 
@@ -532,60 +728,25 @@ void write16ARM7(u32 addr, u16 data) {
 
     if (inRange(addr, static_cast<u32>(Memory7Base::Main), 4 * static_cast<u32>(Memory7Limit::Main))) {
         std::memcpy(&mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)], &data, sizeof(u16));
+
+        cpu::interpreter::invalidateBlocks(&mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)]);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM))) {
         std::memcpy(&swram7[addr & swramLimit7], &data, sizeof(u16));
+
+        cpu::interpreter::invalidateBlocks(&swram7[addr & swramLimit7]);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
         std::memcpy(&wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)], &data, sizeof(u16));
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::DMA), 0x30)) {
-        return dma::write16ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Timer), 0x10)) {
-        return timer::write16ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::write16ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::IPC), 0x10)) {
-        return ipc::write16ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::INTC), 0x10)) {
-        return intc::write16ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound))) {
-        std::printf("[Bus:ARM7  ] Unhandled write16 @ 0x%08X (Sound) = 0x%04X\n", addr, data);
-
-        return;
+
+        cpu::interpreter::invalidateBlocks(&wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)]);
+    } else if (const auto func = getHandler(mmio7.write16, addr); func != NULL) {
+        return func(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WiFi), static_cast<u32>(Memory7Limit::WiFi))) {
         std::memcpy(&wifi[addr & 0xFFF], &data, sizeof(u16));
-        //std::printf("[Bus:ARM7  ] Unhandled write16 @ 0x%08X (Wi-Fi) = 0x%04X\n", addr, data);
+        Log::debug("[Bus:ARM7  ] Unhandled write16 @ 0x%08X (Wi-Fi) = 0x%04X\n", addr, data);
     } else {
-        switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 4:
-                std::printf("[Bus:ARM7  ] Write16 @ DISPSTAT = 0x%04X\n", data);
-                return ppu::writeDISPSTAT7(data);
-            case static_cast<u32>(Memory9Base::MMIO) + 0x134:
-                std::printf("[Bus:ARM7  ] Write16 @ RCNT = 0x%04X\n", data);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x138:
-                std::printf("[Bus:ARM7  ] Write16 @ RTC = 0x%04X\n", data);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C0:
-                std::printf("[SPI       ] Write16 @ SPICNT = 0x%04X\n", data);
-                return spi::writeSPICNT(data);
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1C2:
-                std::printf("[SPI       ] Write16 @ SPIDATA = 0x%04X\n", data);
-                return spi::writeSPIDATA(data);
-            case static_cast<u32>(Memory9Base::MMIO) + 0x204:
-                std::printf("[Bus:ARM7  ] Write16 @ EXMEMCNT = 0x%04X\n", data);
-
-                exmem7 = (exmem7 & 0xFF80) | (data & 0x7F);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x206:
-                std::printf("[Bus:ARM7  ] Write16 @ WIFIWAITCNT = 0x%04X\n", data);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x304:
-                std::printf("[Bus:ARM7  ] Write16 @ POWCNT2 = 0x%04X\n", data);
-                break;
-            default:
-                std::printf("[Bus:ARM7  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+        Log::error("[Bus:ARM7  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
-                exit(0);
-        }
+        exit(0);
     }
 }
 
@@ -593,34 +754,28 @@ void write32ARM7(u32 addr, u32 data) {
     assert(!(addr & 3));
     
     if (inRange(addr, static_cast<u32>(Memory7Base::BIOS), static_cast<u32>(Memory7Limit::BIOS))) {
-        std::printf("[Bus:ARM7  ] Bad write32 @ BIOS (0x%08X) = 0x%08X\n", addr, data);
+        Log::warn("[Bus:ARM7  ] Bad write32 @ BIOS (0x%08X) = 0x%08X\n", addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::Main), 4 * static_cast<u32>(Memory7Limit::Main))) {
         std::memcpy(&mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)], &data, sizeof(u32));
+
+        cpu::interpreter::invalidateBlocks(&mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)]);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM))) {
         std::memcpy(&swram7[addr & swramLimit7], &data, sizeof(u32));
+
+        cpu::interpreter::invalidateBlocks(&swram7[addr & swramLimit7]);
     } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
         std::memcpy(&wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)], &data, sizeof(u32));
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::DMA), 0x30)) {
-        return dma::write32ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Timer), 0x10)) {
-        return timer::write32ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::write32ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::IPC), 0x10)) {
-        return ipc::write32ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::INTC), 0x10)) {
-        return intc::write32ARM7(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Sound), static_cast<u32>(Memory7Limit::Sound))) {
-        std::printf("[Bus:ARM7  ] Unhandled write32 @ 0x%08X (Sound) = 0x%08X\n", addr, data);
-
-        return;
+
+        cpu::interpreter::invalidateBlocks(&wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)]);
+    } else if (const auto func = getHandler(mmio7.write32, addr); func != NULL) {
+        return func(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
         return ppu::writeVRAM32(addr, data);
     } else {
         switch (addr) {
             case 0x08005500: break; // For rockwrestler
             default:
-                std::printf("[Bus:ARM7  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+                Log::error("[Bus:ARM7  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
                 exit(0);
         }
@@ -630,53 +785,16 @@ void write32ARM7(u32 addr, u32 data) {
 void write8ARM9(u32 addr, u8 data) {
     if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
         mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)] = data;
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPA), 0x70)) {
-        return ppu::write8(0, addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::write8ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::INTC), 0x10)) {
-        return intc::write8ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPB), 0x70)) {
-        return ppu::write8(1, addr, data);
+
+        cpu::interpreter::invalidateBlocks(&mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)]);
+    } else if (const auto func = getHandler(mmio9.write8, addr); func != NULL) {
+        return func(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
         // Unsupported
     } else {
-        switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x240:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x241:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x242:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x243:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x244:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x245:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x246:
-                {
-                    const auto idx = addr - (static_cast<u32>(Memory9Base::MMIO) + 0x240);
-
-                    std::printf("[Bus:ARM9  ] Write8 @ VRAMCNT_%c = 0x%02X\n", 'A' + idx, data);
-
-                    ppu::writeVRAMCNT(idx, data);
-                }
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x247:
-                std::printf("[Bus:ARM9  ] Write8 @ WRAMCNT = 0x%02X\n", data);
-
-                setWRAMCNT(data & 3);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x248:
-            case static_cast<u32>(Memory9Base::MMIO) + 0x249:
-                {
-                    const auto idx = 7 + (addr - (static_cast<u32>(Memory9Base::MMIO) + 0x248));
-
-                    std::printf("[Bus:ARM9  ] Write8 @ VRAMCNT_%c = 0x%02X\n", 'A' + idx, data);
-                    
-                    ppu::writeVRAMCNT(idx, data);
-                }
-                break;
-            default:
-                std::printf("[Bus:ARM9  ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
+        Log::error("[Bus:ARM9  ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
 
-                exit(0);
-        }
+        exit(0);
     }
 }
 
@@ -687,26 +805,10 @@ void write16ARM9(u32 addr, u16 data) {
 
     if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
         std::memcpy(&mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)], &data, sizeof(u16));
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPA), 0x70)) {
-        return ppu::write16(0, addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::DMA), 0x30)) {
-        return dma::write16ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Timer), 0x10)) {
-        return timer::write16ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::IPC), 0x10)) { // Same memory base as ARM7
-        return ipc::write16ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::write16ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::INTC), 0x10)) {
-        return intc::write16ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Math), 0x40)) {
-        return math::write16(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISP3D), 0x384)) {
-        std::printf("[Bus:ARM9  ] Unhandled write16 @ 0x%08X (3D Display Engine) = 0x%08X\n", addr, data);
-
-        return;
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPB), 0x70)) {
-        return ppu::write16(1, addr, data);
+
+        cpu::interpreter::invalidateBlocks(&mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)]);
+    } else if (const auto func = getHandler(mmio9.write16, addr); func != NULL) {
+        return func(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::Pal), static_cast<u32>(Memory9Limit::Pal))) {
         ppu::writePal16(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
@@ -716,61 +818,23 @@ void write16ARM9(u32 addr, u16 data) {
     } else if (inRange(addr, static_cast<u32>(Memory9Base::OAM), static_cast<u32>(Memory9Limit::Pal))) {
         // TODO: implement object attribute memory writes
     } else {
-        switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x204:
-                std::printf("[Bus:ARM9  ] Write16 @ EXMEMCNT = 0x%04X\n", data);
-
-                exmem7 = (data & 0xFF80) | (exmem7 & 0x7F);
-                exmem9 = data;
+        Log::error("[Bus:ARM9  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
-                if (data & (1 << 11)) {
-                    cartridge::setARM7Access();
-                } else {
-                    cartridge::setARM9Access();
-                }
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x248:
-                std::printf("[Bus:ARM9  ] Write16 @ VRAMCNT_H/I = 0x%04X\n", data);
-                ppu::writeVRAMCNT(7, data);
-                ppu::writeVRAMCNT(8, data >> 8);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x304:
-                std::printf("[Bus:ARM9  ] Write16 @ POWCNT1 = 0x%04X\n", data);
-                break;
-            default:
-                std::printf("[Bus:ARM9  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
-
-                exit(0);
-        }
+        exit(0);
     }
 }
 
 void write32ARM9(u32 addr, u32 data) {
     assert(!(addr & 3));
 
-    //if (addr == 0x00000158) saveBinary("main_mem.bin", mainMem.data(), 0x400000);
+    //if (addr == 0x00000158) saveBinary("main_mem.bin", mainMem, 0x400000);
 
     if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) { // Same as ARM9 Main Mem
         std::memcpy(&mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)], &data, sizeof(u32));
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPA), 0x70)) {
-        ppu::write32(0, addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DMA), 0x40)) {
-        return dma::write32ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::IPC), 0x10)) {
-        return ipc::write32ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory7Base::Cart), 0x1C)) {
-        return cartridge::write32ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::INTC), 0x10)) {
-        return intc::write32ARM9(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::Math), 0x40)) {
-        return math::write32(addr, data);
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISP3D), 0x384)) {
-        std::printf("[Bus:ARM9  ] Unhandled write32 @ 0x%08X (3D Display Engine) = 0x%08X\n", addr, data);
 
-        intc::sendInterrupt9(intc::IntSource::GXFIFO);
-        return;
-    } else if (inRange(addr, static_cast<u32>(Memory9Base::DISPB), 0x70)) {
-        ppu::write32(1, addr, data);
+        cpu::interpreter::invalidateBlocks(&mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)]);
+    } else if (const auto func = getHandler(mmio9.write32, addr); func != NULL) {
+        return func(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::Pal), static_cast<u32>(Memory9Limit::Pal))) {
         ppu::writePal32(addr, data);
     } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
@@ -781,30 +845,193 @@ void write32ARM9(u32 addr, u32 data) {
         // TODO: implement object attribute memory writes
     } else {
         switch (addr) {
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1A0:
-                std::printf("[Bus:ARM9  ] Write32 @ AUXSPICNT/AUXSPIDATA = 0x%08X\n", data);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x1A4:
-                std::printf("[Bus:ARM9  ] Write32 @ ROMCNT = 0x%08X\n", data);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x240:
-                std::printf("[Bus:ARM9  ] Write32 @ VRAMCNT_A/B/C/D = 0x%08X\n", data);
-
-                ppu::writeVRAMCNT(0, data);
-                ppu::writeVRAMCNT(1, data >>  8);
-                ppu::writeVRAMCNT(2, data >> 16);
-                ppu::writeVRAMCNT(3, data >> 24);
-                break;
-            case static_cast<u32>(Memory9Base::MMIO) + 0x304:
-                std::printf("[Bus:ARM9  ] Write32 @ POWCNT1 = 0x%08X\n", data);
-                break;
             case 0x08005500: break; // For rockwrestler
             default:
-                std::printf("[Bus:ARM9  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+                Log::error("[Bus:ARM9  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
                 exit(0);
         }
     }
 }
 
+/* Returns a host pointer to ARM7 code memory, NULL if the page can't be cached */
+u8 *getCodePointerARM7(u32 addr) {
+    if (inRange(addr, static_cast<u32>(Memory7Base::BIOS), static_cast<u32>(Memory7Limit::BIOS))) {
+        return &bios7[addr & (static_cast<u32>(Memory7Limit::BIOS) - 1)];
+    } else if (inRange(addr, static_cast<u32>(Memory7Base::Main), 4 * static_cast<u32>(Memory7Limit::Main))) {
+        return &mainMem[addr & (static_cast<u32>(Memory7Limit::Main) - 1)];
+    } else if (inRange(addr, static_cast<u32>(Memory7Base::SWRAM), 16 * 16 * static_cast<u32>(Memory7Limit::SWRAM))) {
+        return &swram7[addr & swramLimit7];
+    } else if (inRange(addr, static_cast<u32>(Memory7Base::WRAM), 16 * 8 * static_cast<u32>(Memory7Limit::WRAM))) {
+        return &wram[addr & (static_cast<u32>(Memory7Limit::WRAM) - 1)];
+    }
+
+    return NULL;
+}
+
+/* Returns a host pointer to ARM9 code memory, NULL if the page can't be cached */
+u8 *getCodePointerARM9(u32 addr) {
+    if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
+        return &mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)];
+    } else if (addr >= static_cast<u32>(Memory9Base::BIOS)) {
+        return &bios9[addr & 0xFFF];
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns a host pointer to plain memory as seen by the bus (no TCM), NULL if addr needs handlers.
+ * size is set to the bytes left in the page. Callers mark the written span dirty (invalidateRange)
+ */
+u8 *getBlockPointer(int cpuID, u32 addr, bool isWrite, u32 &size) {
+    size = PAGE_SIZE - (addr & PAGE_MASK);
+
+    if (cpuID == 7) {
+        const auto page = getPage((isWrite) ? writePages7 : readPages7, addr);
+
+        return (page != NULL) ? &page[addr & PAGE_MASK] : NULL;
+    }
+
+    if (inRange(addr, static_cast<u32>(Memory9Base::Main), 4 * static_cast<u32>(Memory9Limit::Main))) {
+        return &mainMem[addr & (static_cast<u32>(Memory9Limit::Main) - 1)];
+    } else if (inRange(addr, static_cast<u32>(Memory9Base::LCDC), static_cast<u32>(Memory9Limit::LCDC))) {
+        return ppu::getLCDCPointer(addr);
+    } else if (inRange(addr, static_cast<u32>(Memory9Base::VRAM), static_cast<u32>(Memory9Limit::VRAM))) {
+        return ppu::getVRAMPointer(addr); // VRAM pages are as large as mapping slices, overlapping banks go through the handlers
+    } else if (isWrite && inRange(addr, static_cast<u32>(Memory9Base::Pal), static_cast<u32>(Memory9Limit::Pal))) {
+        size = static_cast<u32>(Memory9Limit::Pal) - (addr & (static_cast<u32>(Memory9Limit::Pal) - 1));
+
+        return ppu::getPalettePointer(addr);
+    }
+
+    return NULL;
+}
+
+u32 readUnit(int cpuID, u32 addr, u32 unit) {
+    if (cpuID == 7) return (unit == 4) ? read32ARM7(addr) : read16ARM7(addr);
+
+    return (unit == 4) ? read32ARM9(addr) : read16ARM9(addr);
+}
+
+void writeUnit(int cpuID, u32 addr, u32 data, u32 unit) {
+    if (cpuID == 7) return (unit == 4) ? write32ARM7(addr, data) : write16ARM7(addr, data);
+
+    return (unit == 4) ? write32ARM9(addr, data) : write16ARM9(addr, data);
+}
+
+/* Fills a host span with a repeating unit, doubling the filled part on every step */
+void fillSpan(u8 *mem, u32 size, u32 data, u32 unit) {
+    std::memcpy(mem, &data, unit);
+
+    for (u32 filled = unit; filled < size; filled *= 2) std::memcpy(&mem[filled], mem, std::min(filled, size - filled));
+}
+
+/* Copies count units (2 or 4 bytes) like a DMA does. Plain memory is copied in bulk, everything else one unit at a time */
+void copyBlock(int cpuID, u32 dst, u32 src, u32 count, u32 unit, i32 dstStep, i32 srcStep) {
+    assert(((unit == 2) || (unit == 4)) && !(dst & (unit - 1)) && !(src & (unit - 1)));
+
+    // Only incrementing destinations are done in bulk, fixed sources turn into fills
+    const auto isBulk = dstStep == (i32)unit;
+    const auto isFill = !srcStep;
+
+    while (count) {
+        u32 dstSize, srcSize;
+
+        const auto dstMem = (isBulk) ? getBlockPointer(cpuID, dst, true, dstSize) : NULL;
+        const auto srcMem = (isBulk && (isFill || (srcStep == (i32)unit))) ? getBlockPointer(cpuID, src, false, srcSize) : NULL;
+
+        if ((dstMem != NULL) && (srcMem != NULL)) {
+            const auto n = std::min(count, ((isFill) ? dstSize : std::min(dstSize, srcSize)) / unit);
+
+            const auto size = n * unit;
+
+            // Forward copies into an overlapping range repeat the source, memmove doesn't
+            if (n && (isFill || (dstMem <= srcMem) || (dstMem >= (srcMem + size)))) {
+                if (isFill) {
+                    u32 data;
+
+                    std::memcpy(&data, srcMem, unit);
+
+                    fillSpan(dstMem, size, data, unit);
+                } else {
+                    std::memmove(dstMem, srcMem, size);
+
+                    src += size;
+                }
+
+                cpu::interpreter::invalidateRange(dstMem, size);
+
+                dst   += size;
+                count -= n;
+
+                continue;
+            }
+        }
+
+        writeUnit(cpuID, dst, readUnit(cpuID, src, unit), unit);
+
+        dst += dstStep;
+        src += srcStep;
+
+        count--;
+    }
+}
+
+/* Fills count units (2 or 4 bytes) with data */
+void fillBlock(int cpuID, u32 dst, u32 data, u32 count, u32 unit) {
+    assert(((unit == 2) || (unit == 4)) && !(dst & (unit - 1)));
+
+    while (count) {
+        u32 dstSize;
+
+        if (const auto dstMem = getBlockPointer(cpuID, dst, true, dstSize); (dstMem != NULL) && (dstSize >= unit)) {
+            const auto n = std::min(count, dstSize / unit);
+
+            fillSpan(dstMem, n * unit, data, unit);
+
+            cpu::interpreter::invalidateRange(dstMem, n * unit);
+
+            dst   += n * unit;
+            count -= n;
+
+            continue;
+        }
+
+        writeUnit(cpuID, dst, data, unit);
+
+        dst += unit;
+
+        count--;
+    }
+}
+
+/* Copies host data to guest memory, used by loaders */
+void writeBlock(int cpuID, u32 dst, const u8 *data, u32 size) {
+    while (size) {
+        u32 dstSize;
+
+        if (const auto dstMem = getBlockPointer(cpuID, dst, true, dstSize); dstMem != NULL) {
+            const auto n = std::min(size, dstSize);
+
+            std::memcpy(dstMem, data, n);
+
+            cpu::interpreter::invalidateRange(dstMem, n);
+
+            dst  += n;
+            data += n;
+            size -= n;
+
+            continue;
+        }
+
+        (cpuID == 7) ? write8ARM7(dst, *data) : write8ARM9(dst, *data);
+
+        dst++;
+        data++;
+
+        size--;
+    }
+}
+
 }
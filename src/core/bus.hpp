@@ -9,11 +9,52 @@
 
 namespace nds::bus {
 
+// Page table constants
+
+constexpr u32 PAGE_SHIFT = 14; // 16KB pages
+constexpr u32 PAGE_SIZE  = 1 << PAGE_SHIFT;
+constexpr u32 PAGE_MASK  = PAGE_SIZE - 1;
+constexpr u32 PAGE_LIMIT = 0x10000000; // Nothing above is plain memory, except for TCM which goes through the slow path
+constexpr u32 PAGE_NUM   = PAGE_LIMIT >> PAGE_SHIFT;
+
+// MMIO constants
+
+constexpr u32 MMIO_BASE = 0x04000000;
+constexpr u32 MMIO_SIZE = 0x2000; // Covers both display engines
+
+/* MMIO handlers */
+using Read8Func   = u8   (*)(u32 addr);
+using Read16Func  = u16  (*)(u32 addr);
+using Read32Func  = u32  (*)(u32 addr);
+using Write8Func  = void (*)(u32 addr, u8  data);
+using Write16Func = void (*)(u32 addr, u16 data);
+using Write32Func = void (*)(u32 addr, u32 data);
+
 void init(const char *bios7Path, const char *bios9Path, const char *gamePath);
 
 void setPOSTFLG(u8 data);
 void setWRAMCNT(u8 data);
 
+void remapARM7();
+void remapARM9();
+void remapLCDC();
+
+u8 **getReadPages (int cpuID);
+u8 **getWritePages(int cpuID);
+
+/* Returns the page table entry of an address, NULL above the page tables */
+inline u8 *getPage(u8 **pages, u32 addr) {
+    return (addr < PAGE_LIMIT) ? pages[addr >> PAGE_SHIFT] : NULL;
+}
+
+void registerRead8 (int cpuID, u32 addr, u32 size, Read8Func  func);
+void registerRead16(int cpuID, u32 addr, u32 size, Read16Func func);
+void registerRead32(int cpuID, u32 addr, u32 size, Read32Func func);
+
+void registerWrite8 (int cpuID, u32 addr, u32 size, Write8Func  func);
+void registerWrite16(int cpuID, u32 addr, u32 size, Write16Func func);
+void registerWrite32(int cpuID, u32 addr, u32 size, Write32Func func);
+
 u8  read8ARM7 (u32 addr);
 u16 read16ARM7(u32 addr);
 u32 read32ARM7(u32 addr);
@@ -30,4 +71,11 @@ void write8ARM9 (u32 addr, u8  data);
 void write16ARM9(u32 addr, u16 data);
 void write32ARM9(u32 addr, u32 data);
 
+u8 *getCodePointerARM7(u32 addr);
+u8 *getCodePointerARM9(u32 addr);
+
+void copyBlock (int cpuID, u32 dst, u32 src, u32 count, u32 unit, i32 dstStep, i32 srcStep);
+void fillBlock (int cpuID, u32 dst, u32 data, u32 count, u32 unit);
+void writeBlock(int cpuID, u32 dst, const u8 *data, u32 size);
+
 }
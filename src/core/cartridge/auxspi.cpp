@@ -8,8 +8,12 @@
 #include <cassert>
 #include <cstdio>
 
+#include "../../common/log.hpp"
+
 namespace nds::cartridge::auxspi {
 
+using Log = logger::Logger<logger::Category::AuxSPI>;
+
 struct AUXSPICNT {
     u8   baud;
     bool hold;
@@ -24,7 +28,7 @@ AUXSPICNT auxspicnt;
 u16 readAUXSPICNT16() {
     u16 data;
 
-    std::printf("[AUXSPI    ] Read16 @ AUXSPICNT\n");
+    Log::debug("[AUXSPI    ] Read16 @ AUXSPICNT\n");
 
     data  = (u16)auxspicnt.baud;
     data |= (u16)auxspicnt.hold   <<  6;
@@ -37,13 +41,13 @@ u16 readAUXSPICNT16() {
 }
 
 u16 readAUXSPIDATA16() {
-    std::printf("[AUXSPI    ] Read16 @ AUXSPIDATA\n");
+    Log::debug("[AUXSPI    ] Read16 @ AUXSPIDATA\n");
 
     return 0;
 }
 
 void writeAUXSPICNT8(bool isHi, u8 data) {
-    std::printf("[AUXSPI    ] Write8 @ AUXSPICNT_%s = 0x%02X\n", (isHi) ? "H" : "L", data);
+    Log::debug("[AUXSPI    ] Write8 @ AUXSPICNT_%s = 0x%02X\n", (isHi) ? "H" : "L", data);
 
     if (isHi) {
         auxspicnt.mode   = data & (1 << 5);
@@ -56,7 +60,7 @@ void writeAUXSPICNT8(bool isHi, u8 data) {
 }
 
 void writeAUXSPICNT16(u16 data) {
-    std::printf("[AUXSPI    ] Write16 @ AUXSPICNT = 0x%04X\n", data);
+    Log::debug("[AUXSPI    ] Write16 @ AUXSPICNT = 0x%04X\n", data);
 
     auxspicnt.baud   = data & 3;
     auxspicnt.hold   = data & (1 <<  6);
@@ -66,7 +70,7 @@ void writeAUXSPICNT16(u16 data) {
 }
 
 void writeAUXSPIDATA16(u16 data) {
-    std::printf("[AUXSPI    ] Write16 @ AUXSPIDATA = 0x%04X\n", data);
+    Log::debug("[AUXSPI    ] Write16 @ AUXSPIDATA = 0x%04X\n", data);
 }
 
 }
@@ -5,18 +5,22 @@
 
 #include "cartridge.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstring>
 
 #include "auxspi.hpp"
+#include "../bus.hpp"
 #include "../dma.hpp"
 #include "../intc.hpp"
 #include "../scheduler.hpp"
+#include "../../common/log.hpp"
 
 namespace nds::cartridge {
 
 using IntSource = intc::IntSource;
+using Log = logger::Logger<logger::Category::Cartridge>;
 
 // Cartridge constants
 
@@ -53,7 +57,7 @@ struct CartStream {
 
 // Cartridge and buffer
 
-std::ifstream cart;
+MappedFile rom;
 
 CartStream stream;
 
@@ -95,10 +99,16 @@ void receiveEvent(i64 c) {
 }
 
 void init(const char *gamePath, u8 *const bios7) {
-    // Open cartridge file
-    cart.open(gamePath, std::ios::in | std::ios::binary);
+    // Map cartridge file, an empty slot reads as open bus
+    unmapBinary(rom);
 
-    cart.unsetf(std::ios::skipws);
+    if (gamePath != NULL) rom = mapBinary(gamePath);
+
+    if ((gamePath != NULL) && (rom.data == NULL)) {
+        Log::error("[Cartridge ] Unable to open \"%s\"\n", gamePath);
+
+        exit(0);
+    }
 
     // Get KEY1 key table
     std::memcpy(key1Table, bios7 + 0x30, 0x1048);
@@ -106,7 +116,22 @@ void init(const char *gamePath, u8 *const bios7) {
     keyMode = KEYMode::None;
 
     // Register scheduler event
-    idReceive = scheduler::registerEvent([](int, i64 c) { receiveEvent(c); });
+    idReceive = scheduler::registerEvent([](void *, int, i64 c) { receiveEvent(c); }, NULL);
+
+    // Register MMIO handlers
+    bus::registerRead16(7, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &read16ARM7);
+    bus::registerRead32(7, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &read32ARM7);
+
+    bus::registerWrite8 (7, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &write8ARM7);
+    bus::registerWrite16(7, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &write16ARM7);
+    bus::registerWrite32(7, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &write32ARM7);
+
+    bus::registerRead16(9, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &read16ARM9);
+    bus::registerRead32(9, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &read32ARM9);
+
+    bus::registerWrite8 (9, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &write8ARM9);
+    bus::registerWrite16(9, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &write16ARM9);
+    bus::registerWrite32(9, static_cast<u32>(CartReg::AUXSPICNT), 0x1C, &write32ARM9);
 }
 
 void setKEY2() {
@@ -121,8 +146,8 @@ void setARM9Access() {
     isARM9Access = true;
 }
 
-std::ifstream *getCart() {
-    return &cart;
+const MappedFile &getROM() {
+    return rom;
 }
 
 // Algorithm taken from GBATEK
@@ -167,7 +192,7 @@ void doCmd() {
         case KEYMode::None:
             switch (romcmd >> 56) { // Unencrypted commands
                 default:
-                    std::printf("[Cartridge ] Unhandled command 0x%016llX\n", romcmd);
+                    Log::error("[Cartridge ] Unhandled command 0x%016llX\n", romcmd);
                     
                     exit(0);
             }
@@ -178,7 +203,7 @@ void doCmd() {
                 
                 switch (romcmd >> 60) {
                     default:
-                        std::printf("[Cartridge ] Unhandled KEY1 command 0x%016llX\n", romcmd);
+                        Log::error("[Cartridge ] Unhandled KEY1 command 0x%016llX\n", romcmd);
 
                         exit(0);
                 }
@@ -190,24 +215,26 @@ void doCmd() {
                     {
                         const u32 addr = romcmd >> 24;
 
-                        std::printf("[Cartridge ] Get Data; Address = 0x%08X, Size = 0x%04X\n", addr, (u32)argLen);
+                        Log::trace("[Cartridge ] Get Data; Address = 0x%08X, Size = 0x%04X\n", addr, (u32)argLen);
 
                         assert(!(addr & 0x1FF));
 
-                        // Read cartridge data into buffer
-                        cart.seekg(addr, std::ios::beg);
-                        cart.read((char *)stream.buf, argLen);
+                        // Read cartridge data into buffer, open bus past the end of the ROM
+                        const auto size = (addr < rom.size) ? std::min((size_t)argLen, rom.size - addr) : 0;
+
+                        if (size) std::memcpy(stream.buf, &rom.data[addr], size);
+                        std::memset(&stream.buf[size], 0xFF, argLen - size);
                     }
                     break;
                 case 0xB8:
-                    std::printf("[Cartridge ] Get Chip ID; Size = 0x%04X\n", (u32)argLen);
+                    Log::trace("[Cartridge ] Get Chip ID; Size = 0x%04X\n", (u32)argLen);
 
                     for (int i = 0; i < argLen; i++) { // Load chip ID into buffer
                         std::memcpy(stream.buf, &CHIP_ID, sizeof(u32));
                     }
                     break;
                 default:
-                    std::printf("[Cartridge ] Unhandled KEY2 command 0x%016llX\n", romcmd);
+                    Log::error("[Cartridge ] Unhandled KEY2 command 0x%016llX\n", romcmd);
 
                     exit(0);
             }
@@ -229,7 +256,7 @@ u16 read16ARM7(u32 addr) {
         case static_cast<u32>(CartReg::AUXSPIDATA):
             return auxspi::readAUXSPIDATA16();
         default:
-            std::printf("[Cart:ARM7 ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[Cart:ARM7 ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -242,7 +269,7 @@ u32 read32ARM7(u32 addr) {
 
     switch (addr) {
         case static_cast<u32>(CartReg::ROMCTRL):
-            //std::printf("[Cart:ARM7 ] Read32 @ ROMCTRL\n");
+            Log::debug("[Cart:ARM7 ] Read32 @ ROMCTRL\n");
 
             data  = (u32)romctrl.drq   << 23;
             data |= (u32)romctrl.bsize << 24;
@@ -251,7 +278,7 @@ u32 read32ARM7(u32 addr) {
             data |= (u32)romctrl.busy  << 31;
             break;
         default:
-            std::printf("[Cart:ARM7 ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[Cart:ARM7 ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -268,7 +295,7 @@ u16 read16ARM9(u32 addr) {
         case static_cast<u32>(CartReg::AUXSPIDATA):
             return auxspi::readAUXSPIDATA16();
         default:
-            std::printf("[Cart:ARM9 ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[Cart:ARM9 ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -281,7 +308,7 @@ u32 read32ARM9(u32 addr) {
 
     switch (addr) {
         case static_cast<u32>(CartReg::ROMCTRL):
-            //std::printf("[Cart:ARM9 ] Read32 @ ROMCTRL\n");
+            Log::debug("[Cart:ARM9 ] Read32 @ ROMCTRL\n");
 
             data  = (u32)romctrl.drq   << 23;
             data |= (u32)romctrl.bsize << 24;
@@ -290,7 +317,7 @@ u32 read32ARM9(u32 addr) {
             data |= (u32)romctrl.busy  << 31;
             break;
         default:
-            std::printf("[Cart:ARM9 ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[Cart:ARM9 ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -314,14 +341,14 @@ void write8ARM7(u32 addr, u8 data) {
             {
                 const auto i = addr & 7;
 
-                std::printf("[Cart:ARM7 ] Write8 @ ROMCMD[%u] = 0x%02X\n", i, data);
+                Log::debug("[Cart:ARM7 ] Write8 @ ROMCMD[%u] = 0x%02X\n", i, data);
 
                 romcmd &= ~(0xFFull << (56 - (8 * i)));
                 romcmd |= (u64)data << (56 - (8 * i));
             }
             break;
         default:
-            std::printf("[Cart:ARM7 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
+            Log::error("[Cart:ARM7 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
 
             exit(0);
     }
@@ -334,13 +361,13 @@ void write16ARM7(u32 addr, u16 data) {
         case static_cast<u32>(CartReg::AUXSPIDATA):
             return auxspi::writeAUXSPIDATA16(data);
         case static_cast<u32>(CartReg::ROMSEED0_H):
-            std::printf("[Cart:ARM7 ] Write16 @ ROMSEED0_HI = 0x%04X\n", data);
+            Log::debug("[Cart:ARM7 ] Write16 @ ROMSEED0_HI = 0x%04X\n", data);
             break;
         case static_cast<u32>(CartReg::ROMSEED1_H):
-            std::printf("[Cart:ARM7 ] Write16 @ ROMSEED1_HI = 0x%04X\n", data);
+            Log::debug("[Cart:ARM7 ] Write16 @ ROMSEED1_HI = 0x%04X\n", data);
             break;
         default:
-            std::printf("[Cart:ARM7 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[Cart:ARM7 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
@@ -349,7 +376,7 @@ void write16ARM7(u32 addr, u16 data) {
 void write32ARM7(u32 addr, u32 data) {
     switch (addr) {
         case static_cast<u32>(CartReg::ROMCTRL):
-            std::printf("[Cart:ARM7 ] Write32 @ ROMCTRL = 0x%08X\n", data);
+            Log::debug("[Cart:ARM7 ] Write32 @ ROMCTRL = 0x%08X\n", data);
 
             romctrl.bsize = (data >> 24) & 7;
             romctrl.clk   = data & (1 << 27);
@@ -359,13 +386,13 @@ void write32ARM7(u32 addr, u32 data) {
             if (romctrl.busy) doCmd();
             break;
         case static_cast<u32>(CartReg::ROMSEED0_L):
-            std::printf("[Cart:ARM7 ] Write32 @ ROMSEED0_LO = 0x%08X\n", data);
+            Log::debug("[Cart:ARM7 ] Write32 @ ROMSEED0_LO = 0x%08X\n", data);
             break;
         case static_cast<u32>(CartReg::ROMSEED1_L):
-            std::printf("[Cart:ARM7 ] Write32 @ ROMSEED1_LO = 0x%08X\n", data);
+            Log::debug("[Cart:ARM7 ] Write32 @ ROMSEED1_LO = 0x%08X\n", data);
             break;
         default:
-            std::printf("[Cart:ARM7 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[Cart:ARM7 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
@@ -387,14 +414,14 @@ void write8ARM9(u32 addr, u8 data) {
             {
                 const auto i = addr & 7;
 
-                std::printf("[Cart:ARM9 ] Write8 @ ROMCMD[%u] = 0x%02X\n", i, data);
+                Log::debug("[Cart:ARM9 ] Write8 @ ROMCMD[%u] = 0x%02X\n", i, data);
 
                 romcmd &= ~(0xFFull << (56 - (8 * i)));
                 romcmd |= (u64)data << (56 - (8 * i));
             }
             break;
         default:
-            std::printf("[Cart:ARM9 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
+            Log::error("[Cart:ARM9 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
 
             exit(0);
     }
@@ -407,13 +434,13 @@ void write16ARM9(u32 addr, u16 data) {
         case static_cast<u32>(CartReg::AUXSPIDATA):
             return auxspi::writeAUXSPIDATA16(data);
         case static_cast<u32>(CartReg::ROMSEED0_H):
-            std::printf("[Cart:ARM9 ] Write16 @ ROMSEED0_HI = 0x%04X\n", data);
+            Log::debug("[Cart:ARM9 ] Write16 @ ROMSEED0_HI = 0x%04X\n", data);
             break;
         case static_cast<u32>(CartReg::ROMSEED1_H):
-            std::printf("[Cart:ARM9 ] Write16 @ ROMSEED1_HI = 0x%04X\n", data);
+            Log::debug("[Cart:ARM9 ] Write16 @ ROMSEED1_HI = 0x%04X\n", data);
             break;
         default:
-            std::printf("[Cart:ARM9 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[Cart:ARM9 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
@@ -422,7 +449,7 @@ void write16ARM9(u32 addr, u16 data) {
 void write32ARM9(u32 addr, u32 data) {
     switch (addr) {
         case static_cast<u32>(CartReg::ROMCTRL):
-            std::printf("[Cart:ARM9 ] Write32 @ ROMCTRL = 0x%08X\n", data);
+            Log::debug("[Cart:ARM9 ] Write32 @ ROMCTRL = 0x%08X\n", data);
 
             romctrl.bsize = (data >> 24) & 7;
             romctrl.clk   = data & (1 << 27);
@@ -436,7 +463,7 @@ void write32ARM9(u32 addr, u32 data) {
             {
                 const auto i = addr & 4;
 
-                std::printf("[Cart:ARM9 ] Write32 @ ROMCMD[%u..%u] = 0x%08X\n", i + 3, i, data);
+                Log::debug("[Cart:ARM9 ] Write32 @ ROMCMD[%u..%u] = 0x%08X\n", i + 3, i, data);
 
                 if (!i) {
                     romcmd &= 0xFFFFFFFFull;
@@ -450,20 +477,20 @@ void write32ARM9(u32 addr, u32 data) {
             }
             break;
         case static_cast<u32>(CartReg::ROMSEED0_L):
-            std::printf("[Cart:ARM9 ] Write32 @ ROMSEED0_LO = 0x%08X\n", data);
+            Log::debug("[Cart:ARM9 ] Write32 @ ROMSEED0_LO = 0x%08X\n", data);
             break;
         case static_cast<u32>(CartReg::ROMSEED1_L):
-            std::printf("[Cart:ARM9 ] Write32 @ ROMSEED1_LO = 0x%08X\n", data);
+            Log::debug("[Cart:ARM9 ] Write32 @ ROMSEED1_LO = 0x%08X\n", data);
             break;
         default:
-            std::printf("[Cart:ARM9 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[Cart:ARM9 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
 }
 
 u32 readROMDATA() {
-    //std::printf("[Cart:ARM7 ] Read32 @ ROMDATA\n");
+    Log::debug("[Cart:ARM7 ] Read32 @ ROMDATA\n");
 
     assert(argLen);
 
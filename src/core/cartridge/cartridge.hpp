@@ -5,8 +5,7 @@
 
 #pragma once
 
-#include <fstream>
-
+#include "../../common/file.hpp"
 #include "../../common/types.hpp"
 
 namespace nds::cartridge {
@@ -18,7 +17,7 @@ void setKEY2();
 void setARM7Access();
 void setARM9Access();
 
-std::ifstream *getCart();
+const MappedFile &getROM();
 
 u16 read16ARM7(u32 addr);
 u32 read32ARM7(u32 addr);
@@ -0,0 +1,301 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#include "bios.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cpuint.hpp"
+
+namespace nds::cpu {
+
+extern u32 itcmBase , dtcmBase;
+extern u32 itcmLimit, dtcmLimit;
+
+}
+
+namespace nds::cpu::bios {
+
+// HLE BIOS (false = run all SWIs through the BIOS image)
+constexpr auto doHLE = true;
+
+/* BIOS functions */
+enum SWI {
+    IntrWait       = 0x04,
+    VBlankIntrWait = 0x05,
+    Halt           = 0x06,
+    SoundBias      = 0x08,
+    Div            = 0x09,
+    CpuSet         = 0x0B,
+    CpuFastSet     = 0x0C,
+    Sqrt           = 0x0D,
+    GetCRC16       = 0x0E,
+    LZ77UnCompWram = 0x11,
+    RLUnCompWram   = 0x14,
+};
+
+enum IORegs {
+    SOUNDBIAS = 0x04000504,
+    IME       = 0x04000208,
+    IE        = 0x04000210,
+    IF        = 0x04000214,
+};
+
+// Main memory constants
+constexpr u32 MAIN_BASE = 0x02000000;
+constexpr u32 MAIN_SIZE = 0x00400000;
+constexpr u32 MAIN_END  = 0x03000000; // End of main memory mirrors
+
+// IRQ check flags written by the game's IRQ handler
+constexpr u32 IRQ_FLAGS_ARM7 = 0x0380FFF8;
+constexpr u32 IRQ_FLAGS_ARM9 = 0x3FF8; // DTCM offset
+
+// IntrWait state, SWIs are re-executed until the wait is over
+bool isWaiting[2];
+u32  waitAddr[2];
+
+/* Returns true if [addr;addr+size] overlaps [base;base+limit] */
+bool overlaps(u64 addr, u64 size, u64 base, u64 limit) {
+    return (addr < (base + limit)) && (base < (addr + size));
+}
+
+/* Returns a host pointer to main memory if the range doesn't cross a mirror and isn't mapped to TCM, NULL otherwise */
+u8 *getMainPointer(CPU *cpu, u32 addr, u32 size) {
+    if ((addr < MAIN_BASE) || (addr >= MAIN_END) || (((addr & (MAIN_SIZE - 1)) + size) > MAIN_SIZE)) return NULL;
+
+    if ((cpu->cpuID == 9) && (overlaps(addr, size, itcmBase, itcmLimit) || overlaps(addr, size, dtcmBase, dtcmLimit))) return NULL;
+
+    return cpu->getCodePointer(addr);
+}
+
+/* Copies or fills guest memory, in bulk if both ranges are in main memory */
+void copyMemory(CPU *cpu, u32 src, u32 dst, u32 size, u32 unit, bool isFill) {
+    const auto srcMem = getMainPointer(cpu, src, (isFill) ? unit : size);
+    const auto dstMem = getMainPointer(cpu, dst, size);
+
+    // Forward copies into an overlapping range repeat the source, memmove doesn't
+    if ((srcMem != NULL) && (dstMem != NULL) && (isFill || (dstMem <= srcMem) || (dstMem >= (srcMem + size)))) {
+        if (isFill) {
+            for (u32 i = 0; i < size; i += unit) std::memcpy(&dstMem[i], srcMem, unit);
+        } else {
+            std::memmove(dstMem, srcMem, size);
+        }
+
+        return interpreter::invalidateRange(dstMem, size);
+    }
+
+    for (u32 i = 0; i < size; i += unit) {
+        const auto addr = (isFill) ? src : src + i;
+
+        if (unit == 4) {
+            cpu->write32(dst + i, cpu->read32(addr));
+        } else {
+            cpu->write16(dst + i, cpu->read16(addr));
+        }
+    }
+}
+
+/* Writes decompressed data to guest memory, in bulk if the destination is main memory */
+void writeData(CPU *cpu, u32 dst, const std::vector<u8> &data) {
+    if (const auto dstMem = getMainPointer(cpu, dst, data.size()); dstMem != NULL) {
+        std::memcpy(dstMem, data.data(), data.size());
+
+        return interpreter::invalidateRange(dstMem, data.size());
+    }
+
+    for (u32 i = 0; i < data.size(); i++) cpu->write8(dst + i, data[i]);
+}
+
+/* Decompresses LZ77 data */
+std::vector<u8> decompressLZ77(CPU *cpu, u32 src, u32 dst) {
+    const auto size = cpu->read32(src & ~3) >> 8;
+
+    src = (src & ~3) + 4;
+
+    std::vector<u8> data;
+
+    data.reserve(size);
+
+    while (data.size() < size) {
+        const auto flags = cpu->read8(src++);
+
+        for (int i = 7; (i >= 0) && (data.size() < size); i--) {
+            if (!(flags & (1 << i))) {
+                data.push_back(cpu->read8(src++));
+
+                continue;
+            }
+
+            const auto hi = cpu->read8(src++);
+            const auto lo = cpu->read8(src++);
+
+            const u32 disp = (((hi & 0xF) << 8) | lo) + 1;
+
+            const auto len = std::min((u32)(hi >> 4) + 3, size - (u32)data.size());
+
+            for (u32 j = 0; j < len; j++) {
+                // Bad streams can reference data that was in memory before decompression started
+                const auto pos = data.size() - disp;
+
+                data.push_back((disp <= data.size()) ? data[pos] : cpu->read8(dst + pos));
+            }
+        }
+    }
+
+    return data;
+}
+
+/* Decompresses run-length encoded data */
+std::vector<u8> decompressRLE(CPU *cpu, u32 src) {
+    const auto size = cpu->read32(src & ~3) >> 8;
+
+    src = (src & ~3) + 4;
+
+    std::vector<u8> data;
+
+    data.reserve(size);
+
+    while (data.size() < size) {
+        const auto flag = cpu->read8(src++);
+
+        if (flag & (1 << 7)) {
+            const auto len = std::min((u32)(flag & 0x7F) + 3, size - (u32)data.size());
+
+            data.insert(data.end(), len, cpu->read8(src++));
+        } else {
+            const auto len = std::min((u32)(flag & 0x7F) + 1, size - (u32)data.size());
+
+            for (u32 i = 0; i < len; i++) data.push_back(cpu->read8(src++));
+        }
+    }
+
+    return data;
+}
+
+/* Returns true if an enabled interrupt is requested */
+bool isIRQRequested(CPU *cpu) {
+    return cpu->read32(IORegs::IE) & cpu->read32(IORegs::IF);
+}
+
+/* Halts the CPU, unless it would wake up immediately */
+void halt(CPU *cpu) {
+    if (!isIRQRequested(cpu)) cpu->halt();
+}
+
+/* Waits for an interrupt in mask. The IRQ handler returns to the SWI, which then checks the IRQ flags again */
+void intrWait(CPU *cpu, bool discard, u32 mask) {
+    const auto idx = cpu->cpuID == 9;
+
+    const auto flagAddr = (cpu->cpuID == 7) ? IRQ_FLAGS_ARM7 : dtcmBase + IRQ_FLAGS_ARM9;
+
+    cpu->write32(IORegs::IME, 1);
+
+    // Old flags are only discarded on the first call
+    if (discard && !(isWaiting[idx] && (waitAddr[idx] == cpu->cpc))) cpu->write32(flagAddr, cpu->read32(flagAddr) & ~mask);
+
+    if (const auto flags = cpu->read32(flagAddr); flags & mask) {
+        cpu->write32(flagAddr, flags & ~mask);
+
+        isWaiting[idx] = false;
+
+        return;
+    }
+
+    isWaiting[idx] = true;
+    waitAddr [idx] = cpu->cpc;
+
+    cpu->r[CPUReg::PC] = cpu->cpc;
+
+    halt(cpu);
+}
+
+/* Services a BIOS call natively, returns false if the SWI has to go through the BIOS image */
+bool handleSWI(CPU *cpu, u8 swi) {
+    if (!doHLE) return false;
+
+    switch (swi) {
+        case SWI::IntrWait:
+            intrWait(cpu, cpu->r[CPUReg::R0], cpu->r[CPUReg::R1]);
+            break;
+        case SWI::VBlankIntrWait:
+            intrWait(cpu, true, 1 << 0);
+            break;
+        case SWI::Halt:
+            halt(cpu);
+            break;
+        case SWI::SoundBias:
+            if (cpu->cpuID != 7) return false;
+
+            // Skip the bias ramp
+            cpu->write16(IORegs::SOUNDBIAS, (cpu->r[CPUReg::R0]) ? 0x200 : 0);
+            break;
+        case SWI::Div:
+            {
+                const auto n = (i32)cpu->r[CPUReg::R0];
+                const auto d = (i32)cpu->r[CPUReg::R1];
+
+                // Let the BIOS deal with undefined results
+                if (!d || ((n == INT32_MIN) && (d == -1))) return false;
+
+                cpu->r[CPUReg::R0] = n / d;
+                cpu->r[CPUReg::R1] = n % d;
+                cpu->r[CPUReg::R3] = std::abs((i64)(n / d));
+            }
+            break;
+        case SWI::CpuSet:
+            {
+                const auto cnt = cpu->r[CPUReg::R2];
+
+                const u32 unit = (cnt & (1 << 26)) ? 4 : 2;
+
+                copyMemory(cpu, cpu->r[CPUReg::R0] & ~(unit - 1), cpu->r[CPUReg::R1] & ~(unit - 1), unit * (cnt & 0x1FFFFF), unit, cnt & (1 << 24));
+            }
+            break;
+        case SWI::CpuFastSet:
+            {
+                const auto cnt = cpu->r[CPUReg::R2];
+
+                // Always copies blocks of 8 words
+                copyMemory(cpu, cpu->r[CPUReg::R0] & ~3, cpu->r[CPUReg::R1] & ~3, 4 * (((cnt & 0x1FFFFF) + 7) & ~7), 4, cnt & (1 << 24));
+            }
+            break;
+        case SWI::Sqrt:
+            cpu->r[CPUReg::R0] = std::sqrt((double)cpu->r[CPUReg::R0]);
+            break;
+        case SWI::GetCRC16:
+            {
+                auto crc = (u16)cpu->r[CPUReg::R0];
+
+                const auto addr = cpu->r[CPUReg::R1] & ~1;
+
+                for (u32 i = 0; i < (cpu->r[CPUReg::R2] & ~1); i += 2) {
+                    crc ^= cpu->read16(addr + i);
+
+                    for (int j = 0; j < 16; j++) crc = (crc >> 1) ^ ((crc & 1) ? 0xA001 : 0);
+                }
+
+                cpu->r[CPUReg::R0] = crc;
+            }
+            break;
+        case SWI::LZ77UnCompWram:
+            writeData(cpu, cpu->r[CPUReg::R1], decompressLZ77(cpu, cpu->r[CPUReg::R0], cpu->r[CPUReg::R1]));
+            break;
+        case SWI::RLUnCompWram:
+            writeData(cpu, cpu->r[CPUReg::R1], decompressRLE(cpu, cpu->r[CPUReg::R0]));
+            break;
+        default:
+            // Callback decompressors, sound tables etc.
+            return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,15 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#pragma once
+
+#include "cpu.hpp"
+#include "../../common/types.hpp"
+
+namespace nds::cpu::bios {
+
+bool handleSWI(CPU *cpu, u8 swi);
+
+}
@@ -8,13 +8,18 @@
 #include <algorithm>
 #include <cstring>
 
+#include "cpuint.hpp"
 #include "../bus.hpp"
+#include "../fastmem.hpp"
+#include "../../common/log.hpp"
 
 namespace nds::cpu {
 
+using Log = logger::Logger<logger::Category::CPU>;
+
 // A little hacky but eh
-u8 itcm[0x8000];
-u8 dtcm[0x4000];
+u8 *itcm; // 32KB
+u8 *dtcm; // 16KB
 
 u32 itcmBase , dtcmBase;
 u32 itcmLimit, dtcmLimit;
@@ -65,8 +70,12 @@ u32 read32ARM9(u32 addr) {
 void write8ARM9(u32 addr, u8 data) {
     if (inRange(addr, itcmBase, itcmLimit)) {
         itcm[addr & 0x7FFF] = data;
+
+        interpreter::invalidateBlocks(&itcm[addr & 0x7FFF]);
     } else if (inRange(addr, dtcmBase, dtcmLimit)) {
         dtcm[addr & 0x3FFF] = data;
+
+        interpreter::invalidateBlocks(&dtcm[addr & 0x3FFF]);
     } else {
         return bus::write8ARM9(addr, data);
     }
@@ -75,8 +84,12 @@ void write8ARM9(u32 addr, u8 data) {
 void write16ARM9(u32 addr, u16 data) {
     if (inRange(addr, itcmBase, itcmLimit)) {
         std::memcpy(&itcm[addr & 0x7FFF], &data, sizeof(u16));
+
+        interpreter::invalidateBlocks(&itcm[addr & 0x7FFF]);
     } else if (inRange(addr, dtcmBase, dtcmLimit)) {
         std::memcpy(&dtcm[addr & 0x3FFF], &data, sizeof(u16));
+
+        interpreter::invalidateBlocks(&dtcm[addr & 0x3FFF]);
     } else {
         return bus::write16ARM9(addr, data);
     }
@@ -85,13 +98,29 @@ void write16ARM9(u32 addr, u16 data) {
 void write32ARM9(u32 addr, u32 data) {
     if (inRange(addr, itcmBase, itcmLimit)) {
         std::memcpy(&itcm[addr & 0x7FFF], &data, sizeof(u32));
+
+        interpreter::invalidateBlocks(&itcm[addr & 0x7FFF]);
     } else if (inRange(addr, dtcmBase, dtcmLimit)) {
         std::memcpy(&dtcm[addr & 0x3FFF], &data, sizeof(u32));
+
+        interpreter::invalidateBlocks(&dtcm[addr & 0x3FFF]);
     } else {
         return bus::write32ARM9(addr, data);
     }
 }
 
+/* Returns a host pointer to ARM9 code memory, NULL if the page can't be cached */
+u8 *getCodePointerARM9(u32 addr) {
+    // TCM pages smaller than 4KB can't hold a full block
+    if (inRange(addr, itcmBase, itcmLimit)) {
+        return (itcmLimit >= 0x1000) ? &itcm[addr & 0x7FFF] : NULL;
+    } else if (inRange(addr, dtcmBase, dtcmLimit)) {
+        return (dtcmLimit >= 0x1000) ? &dtcm[addr & 0x3FFF] : NULL;
+    }
+
+    return bus::getCodePointerARM9(addr);
+}
+
 /* Exception vector base addresses */
 enum class VectorBase : u32 {
     ARM7 = 0,
@@ -110,25 +139,38 @@ CPU::CPU(int cpuID, CP15 *cp15) {
     if (cpuID == 7) {
         r[CPUReg::PC] = static_cast<u32>(VectorBase::ARM7);
 
-        read8  = &bus::read8ARM7;
-        read16 = &bus::read16ARM7;
-        read32 = &bus::read32ARM7;
+        busRead8  = &bus::read8ARM7;
+        busRead16 = &bus::read16ARM7;
+        busRead32 = &bus::read32ARM7;
+
+        busWrite8  = &bus::write8ARM7;
+        busWrite16 = &bus::write16ARM7;
+        busWrite32 = &bus::write32ARM7;
 
-        write8  = &bus::write8ARM7;
-        write16 = &bus::write16ARM7;
-        write32 = &bus::write32ARM7;
+        getCodePointer = &bus::getCodePointerARM7;
     } else {
         r[CPUReg::PC] = static_cast<u32>(VectorBase::ARM9);
 
-        read8  = &read8ARM9;
-        read16 = &read16ARM9;
-        read32 = &read32ARM9;
+        busRead8  = &read8ARM9;
+        busRead16 = &read16ARM9;
+        busRead32 = &read32ARM9;
 
-        write8  = &write8ARM9;
-        write16 = &write16ARM9;
-        write32 = &write32ARM9;
+        busWrite8  = &write8ARM9;
+        busWrite16 = &write16ARM9;
+        busWrite32 = &write32ARM9;
+
+        getCodePointer = &getCodePointerARM9;
     }
 
+    fastmem::registerCPU(this);
+
+    readPages  = bus::getReadPages (cpuID);
+    writePages = bus::getWritePages(cpuID);
+
+    fetchPage = NULL;
+    fetchBase = 1; // Never page-aligned, forces a refresh on the first fetch
+    fetchGen  = 0;
+
     // Set initial CPSR
 
     cpsr.mode = CPUMode::USR; // Required to make initial mode change work
@@ -139,13 +181,13 @@ CPU::CPU(int cpuID, CP15 *cp15) {
 
     changeMode(CPUMode::SVC);
 
-    std::printf("[ARM%d      ] OK!\n", cpuID);
+    Log::info("[ARM%d      ] OK!\n", cpuID);
 }
 
 CPU::~CPU() {}
 
 void CPU::setEntry(u32 addr) {
-    std::printf("[ARM%d      ] Entry point = 0x%08X\n", cpuID, addr);
+    Log::info("[ARM%d      ] Entry point = 0x%08X\n", cpuID, addr);
 
     r[CPUReg::PC] = addr;
 
@@ -259,13 +301,13 @@ void CPU::changeMode(CPUMode newMode) {
 }
 
 void CPU::halt() {
-    std::printf("[ARM%d      ] Halted\n", cpuID);
+    Log::trace("[ARM%d      ] Halted\n", cpuID);
     
     isHalted = true;
 }
 
 void CPU::unhalt() {
-    std::printf("[ARM%d      ] Unhalted\n", cpuID);
+    Log::trace("[ARM%d      ] Unhalted\n", cpuID);
 
     isHalted = false;
 }
@@ -273,7 +315,7 @@ void CPU::unhalt() {
 void CPU::raiseIRQException() {
     const auto lr = get(CPUReg::PC) + 2 * cpsr.t;
 
-    std::printf("[ARM%d%s    ] IRQ exception @ 0x%08X\n", cpuID, (cpsr.t) ? ":T" : "  ", r[CPUReg::PC]);
+    Log::trace("[ARM%d%s    ] IRQ exception @ 0x%08X\n", cpuID, (cpsr.t) ? ":T" : "  ", r[CPUReg::PC]);
 
     spsrIRQ.set(0xF, cpsr.get());
 
@@ -292,7 +334,7 @@ void CPU::raiseIRQException() {
 void CPU::raiseSVCException() {
     const auto lr = r[CPUReg::PC];
 
-    std::printf("[ARM%d%s    ] SVC exception @ 0x%08X\n", cpuID, (cpsr.t) ? ":T" : "  ", r[CPUReg::PC] - ((cpsr.t) ? 2 : 4));
+    Log::trace("[ARM%d%s    ] SVC exception @ 0x%08X\n", cpuID, (cpsr.t) ? ":T" : "  ", r[CPUReg::PC] - ((cpsr.t) ? 2 : 4));
 
     spsrSVC.set(0xF, cpsr.get());
 
@@ -321,11 +363,19 @@ void CPU::checkInterrupt() {
 void setDTCM(u32 size) {
     dtcmBase  = size & ~0xFFF;
     dtcmLimit = 512 << ((size >> 1) & 0x1F);
+
+    bus::remapARM9();
+
+    interpreter::flushBlocks();
 }
 
 void setITCM(u32 size) {
     itcmBase  = size & ~0xFFF;
     itcmLimit = 512 << ((size >> 1) & 0x1F);
+
+    bus::remapARM9();
+
+    interpreter::flushBlocks();
 }
 
 }
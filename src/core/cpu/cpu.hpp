@@ -7,12 +7,19 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 
 #include "cp15.hpp"
+#include "../bus.hpp"
+#include "../../common/log.hpp"
 #include "../../common/types.hpp"
 
 namespace nds::cpu {
 
+namespace interpreter {
+    void invalidateBlocks(const u8 *codePtr);
+}
+
 using CP15 = cp15::CP15;
 
 // PSR
@@ -28,6 +35,11 @@ enum CPUMode {
     SYS = 0xF,
 };
 
+/* Last flag-setting operation, NZCV are only evaluated when needed */
+enum class FlagOp : u8 {
+    None, Add, Sub,
+};
+
 /* Processor status register */
 struct PSR {
     CPUMode mode;
@@ -36,7 +48,35 @@ struct PSR {
 
     bool q, v, c, z, n; // Sticky overflow, overflow, carry, zero, negative
 
+    // NZCV are only valid if flagOp is None
+    FlagOp flagOp;
+
+    u32 flagA, flagB, flagRes; // Operands and result of the last flag-setting operation
+
+    /* Evaluates NZCV of the last flag-setting operation */
+    void resolveFlags() {
+        switch (flagOp) {
+            case FlagOp::None:
+                return;
+            case FlagOp::Add:
+                c = ((u32)-1 - flagA) < flagB;
+                v = !((flagA ^ flagB) & (1 << 31)) && ((flagA ^ flagRes) & (1 << 31)); // Signed overflow if a & b have the same sign sign, and a & c have different signs
+                break;
+            case FlagOp::Sub:
+                c = flagA >= flagB;
+                v = ((flagA ^ flagB) & (1 << 31)) && ((flagA ^ flagRes) & (1 << 31)); // Signed overflow if a & b have different signs, and a & c have different signs
+                break;
+        }
+
+        n = flagRes & (1 << 31);
+        z = !flagRes;
+
+        flagOp = FlagOp::None;
+    }
+
     u32 get() {
+        resolveFlags();
+
         u32 data = 0x10; // Bit 4 is always high!
 
         data |= (u32)mode;
@@ -67,7 +107,7 @@ struct PSR {
                 case CPUMode::UND: mode = CPUMode::UND; break;
                 case CPUMode::SYS: mode = CPUMode::SYS; break;
                 default:
-                    std::printf("Invalid CPU mode %u\n", data & 0xF);
+                    logger::Logger<logger::Category::CPU>::error("Invalid CPU mode %u\n", data & 0xF);
 
                     exit(0);
             }
@@ -78,6 +118,8 @@ struct PSR {
         }
 
         if (mask & (1 << 3)) {
+            flagOp = FlagOp::None;
+
             q = data & (1 << 27);
             v = data & (1 << 28);
             c = data & (1 << 29);
@@ -109,19 +151,97 @@ struct CPU {
     PSR cpsr;
     PSR *cspsr;
 
-    bool cout; // Carry out
+    bool cout, isCoutValid; // Carry out, isCoutValid is false if the barrel shifter leaves C unchanged
 
     bool isHalted, irqPending;
 
+    // Cached code page for instruction fetches
+    u8 *fetchPage;
+    u32 fetchBase, fetchGen;
+
+    // Page tables, unmapped pages go through the bus handlers
+    u8 **readPages, **writePages;
+
     void setEntry(u32 addr);
 
-    u8  (*read8 )(u32);
-    u16 (*read16)(u32);
-    u32 (*read32)(u32);
+    u8  (*busRead8 )(u32);
+    u16 (*busRead16)(u32);
+    u32 (*busRead32)(u32);
+
+    void (*busWrite8 )(u32, u8);
+    void (*busWrite16)(u32, u16);
+    void (*busWrite32)(u32, u32);
+
+    u8 read8(u32 addr) {
+        if (const auto mem = bus::getPage(readPages, addr); mem != NULL) return mem[addr & bus::PAGE_MASK];
+
+        return busRead8(addr);
+    }
+
+    u16 read16(u32 addr) {
+        assert(!(addr & 1));
+
+        if (const auto mem = bus::getPage(readPages, addr); mem != NULL) {
+            u16 data;
+
+            std::memcpy(&data, &mem[addr & bus::PAGE_MASK], sizeof(u16));
+
+            return data;
+        }
+
+        return busRead16(addr);
+    }
+
+    u32 read32(u32 addr) {
+        assert(!(addr & 3));
+
+        if (const auto mem = bus::getPage(readPages, addr); mem != NULL) {
+            u32 data;
+
+            std::memcpy(&data, &mem[addr & bus::PAGE_MASK], sizeof(u32));
+
+            return data;
+        }
+
+        return busRead32(addr);
+    }
+
+    void write8(u32 addr, u8 data) {
+        // 8-bit VRAM writes are ignored
+        if (const auto mem = bus::getPage(writePages, addr); (mem != NULL) && ((addr >> 24) != 6)) {
+            mem[addr & bus::PAGE_MASK] = data;
+
+            return interpreter::invalidateBlocks(&mem[addr & bus::PAGE_MASK]);
+        }
+
+        busWrite8(addr, data);
+    }
+
+    void write16(u32 addr, u16 data) {
+        assert(!(addr & 1));
+
+        if (const auto mem = bus::getPage(writePages, addr); mem != NULL) {
+            std::memcpy(&mem[addr & bus::PAGE_MASK], &data, sizeof(u16));
+
+            return interpreter::invalidateBlocks(&mem[addr & bus::PAGE_MASK]);
+        }
+
+        busWrite16(addr, data);
+    }
+
+    void write32(u32 addr, u32 data) {
+        assert(!(addr & 3));
+
+        if (const auto mem = bus::getPage(writePages, addr); mem != NULL) {
+            std::memcpy(&mem[addr & bus::PAGE_MASK], &data, sizeof(u32));
+
+            return interpreter::invalidateBlocks(&mem[addr & bus::PAGE_MASK]);
+        }
+
+        busWrite32(addr, data);
+    }
 
-    void (*write8 )(u32, u8);
-    void (*write16)(u32, u16);
-    void (*write32)(u32, u32);
+    u8 *(*getCodePointer)(u32);
 
     u32 get(u32 idx);
 
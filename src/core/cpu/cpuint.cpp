@@ -5,16 +5,42 @@
 
 #include "cpuint.hpp"
 
+#include <algorithm>
 #include <array>
 #include <bit>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bios.hpp"
+#include "../fastmem.hpp"
+#include "../../common/log.hpp"
+
+#if defined(__clang__)
+#define MUSTTAIL [[clang::musttail]]
+#else
+#define MUSTTAIL // GCC turns these into sibling calls at -O2
+#endif
 
 namespace nds::cpu::interpreter {
 
+using Log = logger::Logger<logger::Category::CPU>;
+using Disasm = logger::Logger<logger::Category::Disasm>;
+
 // Interpreter constants
 
 auto doDisasm = false;
 
+constexpr auto doThreadedDispatch = false; // Use tail-calling block handlers instead of the dispatch loop in runBlock()
+
+constexpr auto MAX_BLOCK_SIZE = 32;     // In instructions
+constexpr auto CODE_PAGE_NUM  = 0x10000; // Number of tracked host code pages
+
+constexpr auto MAX_IDLE_LOOP_SIZE = 8;   // In instructions
+constexpr u32  IDLE_LOOP_FLAGS    = 1 << 16; // NZCV in idle loop access masks
+
 constexpr const char *condNames[] = {
     "EQ", "NE", "HS", "LO", "MI", "PL", "VS", "VC",
     "HI", "LS", "GE", "LT", "GT", "LE", ""  , "NV",
@@ -47,12 +73,6 @@ constexpr const char *thumbLoadNames[] = {
     "STR", "STRH", "STRB", "LDRSB", "LDR", "LDRH", "LDRB", "LDRSH",
 };
 
-/* Condition codes */
-enum Condition {
-    EQ, NE, HS, LO, MI, PL, VS, VC,
-    HI, LS, GE, LT, GT, LE, AL, NV,
-};
-
 /* Data Processing opcodes */
 enum class DPOpcode {
     AND, EOR, SUB, RSB, ADD, ADC, SBC, RSC,
@@ -94,6 +114,10 @@ enum class ShiftType {
 std::array<void (*)(CPU *, u32), 4096> instrTableARM;
 std::array<void (*)(CPU *, u16), 1024> instrTableTHUMB;
 
+// Threaded dispatch handlers (see runThreadedARM/runThreadedTHUMB)
+std::array<i64 (*)(CPU *, const BlockInstr *, i64), 4096> threadedTableARM;
+std::array<i64 (*)(CPU *, const BlockInstr *, i64), 1024> threadedTableTHUMB;
+
 std::string getReglist(u32 reglist) {
     assert(reglist);
 
@@ -114,10 +138,21 @@ std::string getReglist(u32 reglist) {
 
 // Flag handlers
 
+/* Returns the carry flag */
+bool getCarry(CPU *cpu) {
+    cpu->cpsr.resolveFlags();
+
+    return cpu->cpsr.c;
+}
+
 /* Returns true if the instruction passes the condition code test */
 bool testCond(CPU *cpu, Condition cond) {
+    if (cond >= Condition::AL) return true; // Don't evaluate flags for AL/NV
+
     auto &cpsr = cpu->cpsr;
 
+    cpsr.resolveFlags();
+
     switch (cond) {
         case Condition::EQ: return cpsr.z;
         case Condition::NE: return !cpsr.z;
@@ -138,16 +173,33 @@ bool testCond(CPU *cpu, Condition cond) {
     }
 }
 
+/* Sets the carry out of the barrel shifter */
+void setCarryOut(CPU *cpu, bool c) {
+    cpu->cout = c;
+
+    cpu->isCoutValid = true;
+}
+
+/* Leaves C unchanged, bit ops don't have to evaluate lazy flags until they set them */
+void keepCarry(CPU *cpu) {
+    cpu->isCoutValid = false;
+}
+
 /* Sets bit op flags */
 void setBitFlags(CPU *cpu, u32 c) {
+    cpu->cpsr.resolveFlags();
+
     cpu->cpsr.n = c & (1 << 31);
     cpu->cpsr.z = !c;
-    cpu->cpsr.c = cpu->cout; // Carry out of barrel shifter
+
+    if (cpu->isCoutValid) cpu->cpsr.c = cpu->cout; // Carry out of barrel shifter
     // V is left untouched
 }
 
 /* Sets UMULL/SMULL/UMLAL/SMLAL flags */
 void setMULLFlags(CPU *cpu, u64 c) {
+    cpu->cpsr.resolveFlags();
+
     cpu->cpsr.n = c & (1ull << 63);
     cpu->cpsr.z = !c;
     // C is left untouched
@@ -156,7 +208,7 @@ void setMULLFlags(CPU *cpu, u64 c) {
 
 /* Sets ADC flags */
 void setADCFlags(CPU *cpu, u32 a, u32 b, u64 c) {
-    const auto cin = (u64)cpu->cpsr.c;
+    const auto cin = (u64)getCarry(cpu);
     const auto c32 = (u32)c;
 
     cpu->cpsr.n = c32 & (1 << 31);
@@ -165,17 +217,17 @@ void setADCFlags(CPU *cpu, u32 a, u32 b, u64 c) {
     cpu->cpsr.v = ((~(a ^ b) & ((a + b) ^ b)) ^ (~((a + b) ^ cin) & (c32 ^ cin))) >> 31; // ???
 }
 
-/* Sets ADD/CMN flags */
+/* Records ADD/CMN flags */
 void setAddFlags(CPU *cpu, u32 a, u32 b, u32 c) {
-    cpu->cpsr.n = c & (1 << 31);
-    cpu->cpsr.z = !c;
-    cpu->cpsr.c = ((u32)-1 - a) < b;
-    cpu->cpsr.v = !((a ^ b) & (1 << 31)) && ((a ^ c) & (1 << 31)); // Signed overflow if a & b have the same sign sign, and a & c have different signs
+    cpu->cpsr.flagOp  = FlagOp::Add;
+    cpu->cpsr.flagA   = a;
+    cpu->cpsr.flagB   = b;
+    cpu->cpsr.flagRes = c;
 }
 
 /* Sets SBC/RSC flags */
 void setSBCFlags(CPU *cpu, u32 a, u32 b, u32 c) {
-    const auto cin = (u64)!cpu->cpsr.c;
+    const auto cin = (u64)!getCarry(cpu);
 
     const auto tmp1 = a    - b;
     const auto tmp2 = tmp1 - cin;
@@ -186,12 +238,12 @@ void setSBCFlags(CPU *cpu, u32 a, u32 b, u32 c) {
     cpu->cpsr.v = ((((a ^ b) & ~(tmp1 ^ b)) ^ (tmp1 & ~tmp2)) >> 31) & 1; // ??
 }
 
-/* Sets SUB/RSB/CMP flags */
+/* Records SUB/RSB/CMP flags */
 void setSubFlags(CPU *cpu, u32 a, u32 b, u32 c) {
-    cpu->cpsr.n = c & (1 << 31);
-    cpu->cpsr.z = !c;
-    cpu->cpsr.c = a >= b;
-    cpu->cpsr.v = ((a ^ b) & (1 << 31)) && ((a ^ c) & (1 << 31)); // Signed overflow if a & b have different signs, and a & c have different signs
+    cpu->cpsr.flagOp  = FlagOp::Sub;
+    cpu->cpsr.flagA   = a;
+    cpu->cpsr.flagB   = b;
+    cpu->cpsr.flagRes = c;
 }
 
 /* Sets SMLAxy/SMLAWy flags */
@@ -208,7 +260,7 @@ template<bool isImm>
 u32 doASR(CPU *cpu, u32 data, u32 amt) {
     if (!amt) {
         if constexpr (!isImm) { // Don't set any flags
-            cpu->cout = cpu->cpsr.c;
+            keepCarry(cpu);
         
             return data;
         }
@@ -219,12 +271,12 @@ u32 doASR(CPU *cpu, u32 data, u32 amt) {
     if (amt >= 32) {
         const auto sign = data >> 31;
 
-        cpu->cout = sign;
+        setCarryOut(cpu, sign);
 
         return 0 - sign;
     }
 
-    cpu->cout = (data >> (amt - 1)) & 1;
+    setCarryOut(cpu, (data >> (amt - 1)) & 1);
 
     return (i32)data >> amt;
 }
@@ -232,18 +284,18 @@ u32 doASR(CPU *cpu, u32 data, u32 amt) {
 /* Performs a left shift */
 u32 doLSL(CPU *cpu, u32 data, u32 amt) {
     if (!amt) { // Don't set any flags
-        cpu->cout = cpu->cpsr.c;
+        keepCarry(cpu);
         
         return data;
     }
 
     if (amt >= 32) {
-        cpu->cout = (amt > 32) ? false : data & 1;
+        setCarryOut(cpu, (amt > 32) ? false : data & 1);
 
         return 0;
     }
 
-    cpu->cout = ((data << (amt - 1)) >> 31) & 1;
+    setCarryOut(cpu, ((data << (amt - 1)) >> 31) & 1);
 
     return data << amt;
 }
@@ -253,7 +305,7 @@ template<bool isImm>
 u32 doLSR(CPU *cpu, u32 data, u32 amt) {
     if (!amt) {
         if constexpr (!isImm) { // Don't set any flags
-            cpu->cout = cpu->cpsr.c;
+            keepCarry(cpu);
         
             return data;
         }
@@ -262,12 +314,12 @@ u32 doLSR(CPU *cpu, u32 data, u32 amt) {
     }
 
     if (amt >= 32) {
-        cpu->cout = (amt > 32) ? false : data >> 31;
+        setCarryOut(cpu, (amt > 32) ? false : data >> 31);
 
         return 0;
     }
 
-    cpu->cout = (data >> (amt - 1)) & 1;
+    setCarryOut(cpu, (data >> (amt - 1)) & 1);
 
     return data >> amt;
 }
@@ -277,7 +329,7 @@ template<bool isImm>
 u32 doROR(CPU *cpu, u32 data, u32 amt) {
     if (!isImm || amt) {
         if (!amt) {
-            cpu->cout = cpu->cpsr.c;
+            keepCarry(cpu);
 
             return data;
         }
@@ -286,13 +338,13 @@ u32 doROR(CPU *cpu, u32 data, u32 amt) {
 
         data = std::__rotr(data, amt - 1);
 
-        cpu->cout = data & 1;
+        setCarryOut(cpu, data & 1);
 
         return std::__rotr(data, 1);
     } else { // RRX
-        cpu->cout = data & 1;
+        setCarryOut(cpu, data & 1);
 
-        return (data >> 1) | ((u32)cpu->cpsr.c << 31);
+        return (data >> 1) | ((u32)getCarry(cpu) << 31);
     }
 }
 
@@ -310,14 +362,14 @@ u32 shift(CPU *cpu, u32 data, u32 amt) {
 /* Rotates an 8-bit immediate by 2 * amt, sets carry out */
 u32 rotateImm(CPU *cpu, u32 imm, u32 amt) {
     if (!amt) { // Don't set any flags
-        cpu->cout = cpu->cpsr.c;
+        keepCarry(cpu);
 
         return imm;
     }
 
     amt <<= 1;
 
-    cpu->cout = imm & (1 << (amt - 1));
+    setCarryOut(cpu, imm & (1 << (amt - 1)));
 
     return std::__rotr(imm, amt);
 }
@@ -337,7 +389,7 @@ u32 rotateRead32(u32 data, u32 addr) {
 void aUnhandledInstruction(CPU *cpu, u32 instr) {
     const auto opcode = ((instr >> 4) & 0xF) | ((instr >> 16) & 0xFF0);
 
-    std::printf("[ARM%d      ] Unhandled instruction 0x%03X (0x%08X) @ 0x%08X\n", cpu->cpuID, opcode, instr, cpu->cpc);
+    Log::error("[ARM%d      ] Unhandled instruction 0x%03X (0x%08X) @ 0x%08X\n", cpu->cpuID, opcode, instr, cpu->cpc);
 
     exit(0);
 }
@@ -373,9 +425,9 @@ void aBLX(CPU *cpu, u32 instr) {
 
     if (doDisasm) {
         if constexpr (isImm) {
-            std::printf("[ARM%d      ] [0x%08X] BLX 0x%08X; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
+            Disasm::trace("[ARM%d      ] [0x%08X] BLX 0x%08X; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
         } else {
-            std::printf("[ARM%d      ] [0x%08X] BLX %s; PC = 0x%08X, LR = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rm], cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
+            Disasm::trace("[ARM%d      ] [0x%08X] BLX %s; PC = 0x%08X, LR = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rm], cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
         }
     }
 }
@@ -396,9 +448,9 @@ void aBranch(CPU *cpu, u32 instr) {
         const auto cond = condNames[instr >> 28];
 
         if constexpr (isLink) {
-            std::printf("[ARM%d      ] [0x%08X] BL%s 0x%08X; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
+            Disasm::trace("[ARM%d      ] [0x%08X] BL%s 0x%08X; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
         } else {
-            std::printf("[ARM%d      ] [0x%08X] B%s 0x%08X\n", cpu->cpuID, cpu->cpc, cond, cpu->r[CPUReg::PC]);
+            Disasm::trace("[ARM%d      ] [0x%08X] B%s 0x%08X\n", cpu->cpuID, cpu->cpc, cond, cpu->r[CPUReg::PC]);
         }
     }
 }
@@ -421,7 +473,7 @@ void aBX(CPU *cpu, u32 instr) {
     if (doDisasm) {
         const auto cond = condNames[instr >> 28];
 
-        std::printf("[ARM%d      ] [0x%08X] BX%s %s; PC = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, regNames[rm], cpu->r[CPUReg::PC]);
+        Disasm::trace("[ARM%d      ] [0x%08X] BX%s %s; PC = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, regNames[rm], cpu->r[CPUReg::PC]);
     }
 }
 
@@ -438,7 +490,7 @@ void aCLZ(CPU *cpu, u32 instr) {
     if (doDisasm) {
         const auto cond = condNames[instr >> 28];
 
-        std::printf("[ARM%d      ] [0x%08X] CLZ%s %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, regNames[rd], regNames[rm], regNames[rd], cpu->r[rd]);
+        Disasm::trace("[ARM%d      ] [0x%08X] CLZ%s %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, regNames[rd], regNames[rm], regNames[rd], cpu->r[rd]);
     }
 }
 
@@ -477,9 +529,9 @@ void aCoprocessorRegisterTransfer(CPU *cpu, u32 instr) {
         const auto cond = condNames[instr >> 28];
 
         if constexpr (isL) {
-            std::printf("[ARM%d      ] [0x%08X] MRC%s P%u, %u, %s, C%s, C%s, %u\n", cpu->cpuID, cpu->cpc, cond, cpNum, opcode1, regNames[rd], regNames[rn], regNames[rm], opcode2);
+            Disasm::trace("[ARM%d      ] [0x%08X] MRC%s P%u, %u, %s, C%s, C%s, %u\n", cpu->cpuID, cpu->cpc, cond, cpNum, opcode1, regNames[rd], regNames[rn], regNames[rm], opcode2);
         } else {
-            std::printf("[ARM%d      ] [0x%08X] MCR%s P%u, %u, %s, C%s, C%s, %u\n", cpu->cpuID, cpu->cpc, cond, cpNum, opcode1, regNames[rd], regNames[rn], regNames[rm], opcode2);
+            Disasm::trace("[ARM%d      ] [0x%08X] MCR%s P%u, %u, %s, C%s, C%s, %u\n", cpu->cpuID, cpu->cpc, cond, cpNum, opcode1, regNames[rd], regNames[rn], regNames[rm], opcode2);
         }
     }
 }
@@ -582,7 +634,7 @@ void aDataProcessing(CPU *cpu, u32 instr) {
             break;
         case DPOpcode::ADC:
             {
-                const auto res = (u64)op1 + (u64)op2 + (u64)cpu->cpsr.c;
+                const auto res = (u64)op1 + (u64)op2 + (u64)getCarry(cpu);
 
                 setADCFlags(cpu, op1, op2, res);
 
@@ -591,7 +643,7 @@ void aDataProcessing(CPU *cpu, u32 instr) {
             break;
         case DPOpcode::SBC:
             {
-                const auto res = op1 - op2 - (u32)!cpu->cpsr.c;
+                const auto res = op1 - op2 - (u32)!getCarry(cpu);
 
                 if (S) setSBCFlags(cpu, op1, op2, res);
 
@@ -600,7 +652,7 @@ void aDataProcessing(CPU *cpu, u32 instr) {
             break;
         case DPOpcode::RSC:
             {
-                const auto res = op2 - op1 - (u32)!cpu->cpsr.c;
+                const auto res = op2 - op1 - (u32)!getCarry(cpu);
 
                 if (S) setSBCFlags(cpu, op2, op1, res);
 
@@ -656,7 +708,7 @@ void aDataProcessing(CPU *cpu, u32 instr) {
             cpu->r[rd] = ~op2;
             break;
         default:
-            std::printf("[ARM%d      ] Unhandled Data Processing opcode %s\n", cpu->cpuID, dpNames[static_cast<int>(opcode)]);
+            Log::error("[ARM%d      ] Unhandled Data Processing opcode %s\n", cpu->cpuID, dpNames[static_cast<int>(opcode)]);
 
             exit(0);
     }
@@ -681,38 +733,38 @@ void aDataProcessing(CPU *cpu, u32 instr) {
         if constexpr (isImm) {
             switch (opcode) {
                 case DPOpcode::TST: case DPOpcode::TEQ: case DPOpcode::CMP: case DPOpcode::CMN:
-                    std::printf("[ARM%d      ] [0x%08X] %s%s %s, 0x%08X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, regNames[rn], op2, regNames[rn], op1);
+                    Disasm::trace("[ARM%d      ] [0x%08X] %s%s %s, 0x%08X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, regNames[rn], op2, regNames[rn], op1);
                     break;
                 case DPOpcode::MOV: case DPOpcode::MVN:
-                    std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, 0x%08X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], op2, regNames[rd], cpu->r[rd]);
+                    Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, 0x%08X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], op2, regNames[rd], cpu->r[rd]);
                     break;
                 default:
-                    std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, %s, 0x%08X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rn], op2, regNames[rd], cpu->r[rd]);
+                    Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, %s, 0x%08X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rn], op2, regNames[rd], cpu->r[rd]);
                     break;
             }
         } else {
             if constexpr (isImmShift) {
                 switch (opcode) {
                     case DPOpcode::TST: case DPOpcode::TEQ: case DPOpcode::CMP: case DPOpcode::CMN:
-                        std::printf("[ARM%d      ] [0x%08X] %s%s %s, %s %s %u; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], amt, regNames[rn], op1, regNames[rm], op2);
+                        Disasm::trace("[ARM%d      ] [0x%08X] %s%s %s, %s %s %u; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], amt, regNames[rn], op1, regNames[rm], op2);
                         break;
                     case DPOpcode::MOV: case DPOpcode::MVN:
-                        std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, %s %s %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rm], shiftNames[static_cast<int>(stype)], amt, regNames[rd], cpu->r[rd]);
+                        Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, %s %s %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rm], shiftNames[static_cast<int>(stype)], amt, regNames[rd], cpu->r[rd]);
                         break;
                     default:
-                        std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, %s, %s %s %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], amt, regNames[rd], cpu->r[rd]);
+                        Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, %s, %s %s %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], amt, regNames[rd], cpu->r[rd]);
                         break;
                 }
             } else {
                 switch (opcode) {
                     case DPOpcode::TST: case DPOpcode::TEQ: case DPOpcode::CMP: case DPOpcode::CMN:
-                        std::printf("[ARM%d      ] [0x%08X] %s%s %s, %s %s %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], regNames[rs], regNames[rn], op1, regNames[rm], op2);
+                        Disasm::trace("[ARM%d      ] [0x%08X] %s%s %s, %s %s %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], regNames[rs], regNames[rn], op1, regNames[rm], op2);
                         break;
                     case DPOpcode::MOV: case DPOpcode::MVN:
-                        std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, %s %s %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rm], shiftNames[static_cast<int>(stype)], regNames[rs], regNames[rd], cpu->r[rd]);
+                        Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, %s %s %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rm], shiftNames[static_cast<int>(stype)], regNames[rs], regNames[rd], cpu->r[rd]);
                         break;
                     default:
-                        std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, %s, %s %s %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], regNames[rs], regNames[rd], cpu->r[rd]);
+                        Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, %s, %s %s %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], cond, (isS) ? "S" : "", regNames[rd], regNames[rn], regNames[rm], shiftNames[static_cast<int>(stype)], regNames[rs], regNames[rd], cpu->r[rd]);
                         break;
                 }
             }
@@ -780,7 +832,7 @@ void aExtraLoad(CPU *cpu, u32 instr) {
             cpu->r[rd] = (i16)cpu->read16(addr);
             break;
         default:
-            std::printf("[ARM%d      ] Unhandled Extra Load opcode %s\n", cpu->cpuID, extraLoadNames[static_cast<int>(opcode)]);
+            Log::error("[ARM%d      ] Unhandled Extra Load opcode %s\n", cpu->cpuID, extraLoadNames[static_cast<int>(opcode)]);
 
             exit(0);
     }
@@ -811,17 +863,17 @@ void aExtraLoad(CPU *cpu, u32 instr) {
 
         if constexpr (isI) {
             if constexpr ((opcode == ExtraLoadOpcode::LDRH) || (opcode == ExtraLoadOpcode::LDRSB) || (opcode == ExtraLoadOpcode::LDRSH)) {
-                std::printf("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s0x%02X%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", regNames[rd], addr, cpu->get(rd));
+                Disasm::trace("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s0x%02X%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", regNames[rd], addr, cpu->get(rd));
             } else if constexpr (opcode == ExtraLoadOpcode::STRH) {
-                std::printf("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s0x%02X%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", addr, regNames[rd], data);
+                Disasm::trace("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s0x%02X%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", addr, regNames[rd], data);
             } else {
                 assert(false); // TODO: LDRD/STRD
             }
         } else {
             if constexpr ((opcode == ExtraLoadOpcode::LDRH) || (opcode == ExtraLoadOpcode::LDRSB) || (opcode == ExtraLoadOpcode::LDRSH)) {
-                std::printf("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s%s%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], (isP) ? "]" : "", regNames[rd], addr, cpu->get(rd));
+                Disasm::trace("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s%s%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], (isP) ? "]" : "", regNames[rd], addr, cpu->get(rd));
             } else if constexpr (opcode == ExtraLoadOpcode::STRH) {
-                std::printf("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s%s%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], (isP) ? "]" : "", addr, regNames[rd], data);
+                Disasm::trace("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s%s%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, elNames[static_cast<int>(opcode)], regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], (isP) ? "]" : "", addr, regNames[rd], data);
             } else {
                 assert(false); // TODO: LDRD/STRD
             }
@@ -888,7 +940,7 @@ void aLoadMultiple(CPU *cpu, u32 instr) {
         if constexpr (isL) {
             cpu->r[i] = cpu->read32(addr & ~3);
 
-            if (doDisasm) std::printf("%s = [0x%08X] = 0x%08X\n", regNames[i], addr, cpu->r[i]);
+            if (doDisasm) Disasm::trace("%s = [0x%08X] = 0x%08X\n", regNames[i], addr, cpu->r[i]);
 
             if (i == CPUReg::PC) {
                 if (cpu->cpuID == 9) {
@@ -919,7 +971,7 @@ void aLoadMultiple(CPU *cpu, u32 instr) {
 
             if (i == CPUReg::PC) data += 4;
 
-            if (doDisasm) std::printf("[0x%08X] = %s = 0x%08X\n", addr, regNames[i], data);
+            if (doDisasm) Disasm::trace("[0x%08X] = %s = 0x%08X\n", addr, regNames[i], data);
 
             cpu->write32(addr & ~3, data);
         }
@@ -955,9 +1007,9 @@ void aLoadMultiple(CPU *cpu, u32 instr) {
         const auto list = getReglist(reglist);
 
         if constexpr (isW) {
-            std::printf("[ARM%d      ] [0x%08X] %s%s%s %s%s, {%s}%s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isL) ? "LDM" : "STM", (isU) ? "I" : "D", (isP) ? "B" : "A", regNames[rn], (isW) ? "!" : "", list.c_str(), (isS) ? "^" : "", regNames[rn], cpu->r[rn]);
+            Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s%s, {%s}%s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isL) ? "LDM" : "STM", (isU) ? "I" : "D", (isP) ? "B" : "A", regNames[rn], (isW) ? "!" : "", list.c_str(), (isS) ? "^" : "", regNames[rn], cpu->r[rn]);
         } else {
-            std::printf("[ARM%d      ] [0x%08X] %s%s%s %s%s, {%s}%s\n", cpu->cpuID, cpu->cpc, (isL) ? "LDM" : "STM", (isU) ? "I" : "D", (isP) ? "B" : "A", regNames[rn], (isW) ? "!" : "", list.c_str(), (isS) ? "^" : "");
+            Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s%s, {%s}%s\n", cpu->cpuID, cpu->cpc, (isL) ? "LDM" : "STM", (isU) ? "I" : "D", (isP) ? "B" : "A", regNames[rn], (isW) ? "!" : "", list.c_str(), (isS) ? "^" : "");
         }
     }
 }
@@ -977,7 +1029,7 @@ void aMRS(CPU *cpu, u32 instr) {
         cpu->r[rd] = cpu->cpsr.get();
     }
 
-    if (doDisasm) std::printf("[ARM%d      ] [0x%08X] MRS %s, %sPSR; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], (isR) ? "S" : "C", regNames[rd], cpu->r[rd]);
+    if (doDisasm) Disasm::trace("[ARM%d      ] [0x%08X] MRS %s, %sPSR; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], (isR) ? "S" : "C", regNames[rd], cpu->r[rd]);
 }
 
 /* Move to Status from Register */
@@ -1029,9 +1081,9 @@ void aMSR(CPU *cpu, u32 instr) {
         const auto cond = condNames[instr >> 28];
 
         if constexpr (isImm) {
-            std::printf("[ARM%d      ] [0x%08X] MSR%s %sPSR_%s, 0x%08X; %sPSR = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isR) ? "S" : "C", maskNames[mask], op, (isR) ? "S" : "C", op);
+            Disasm::trace("[ARM%d      ] [0x%08X] MSR%s %sPSR_%s, 0x%08X; %sPSR = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isR) ? "S" : "C", maskNames[mask], op, (isR) ? "S" : "C", op);
         } else {
-            std::printf("[ARM%d      ] [0x%08X] MSR%s %sPSR_%s, %s; %sPSR = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isR) ? "S" : "C", maskNames[mask], regNames[rm], (isR) ? "S" : "C", op);
+            Disasm::trace("[ARM%d      ] [0x%08X] MSR%s %sPSR_%s, %s; %sPSR = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isR) ? "S" : "C", maskNames[mask], regNames[rm], (isR) ? "S" : "C", op);
         }
     }
 }
@@ -1056,16 +1108,16 @@ void aMultiply(CPU *cpu, u32 instr) {
     cpu->r[rd] = res;
 
     if constexpr (isS) {
-        cpu->cout = cpu->cpsr.c; // ARMv5 keeps C untouched
+        keepCarry(cpu); // ARMv5 keeps C untouched
 
         setBitFlags(cpu, cpu->r[rd]);
     }
 
     if (doDisasm) {
         if constexpr (isA) {
-            std::printf("[ARM%d      ] [0x%08X] MLA%s %s, %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isS) ? "S" : "", regNames[rd], regNames[rm], regNames[rs], regNames[rn], regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d      ] [0x%08X] MLA%s %s, %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isS) ? "S" : "", regNames[rd], regNames[rm], regNames[rs], regNames[rn], regNames[rd], cpu->r[rd]);
         } else {
-            std::printf("[ARM%d      ] [0x%08X] MUL%s %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isS) ? "S" : "", regNames[rd], regNames[rm], regNames[rs], regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d      ] [0x%08X] MUL%s %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isS) ? "S" : "", regNames[rd], regNames[rm], regNames[rs], regNames[rd], cpu->r[rd]);
         }
     }
 }
@@ -1105,7 +1157,7 @@ void aSMLAxy(CPU *cpu, u32 instr) {
     if (doDisasm) {
         const auto cond = condNames[instr >> 28];
 
-        std::printf("[ARM%d      ] [0x%08X] SMLA%s%s%s %s, %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isX) ? "T" : "B", (isY) ? "T" : "B", cond, regNames[rd], regNames[rm], regNames[rs], regNames[rn], regNames[rd], cpu->r[rd]);
+        Disasm::trace("[ARM%d      ] [0x%08X] SMLA%s%s%s %s, %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isX) ? "T" : "B", (isY) ? "T" : "B", cond, regNames[rd], regNames[rm], regNames[rs], regNames[rn], regNames[rd], cpu->r[rd]);
     }
 }
 
@@ -1138,7 +1190,7 @@ void aSMULxy(CPU *cpu, u32 instr) {
     if (doDisasm) {
         const auto cond = condNames[instr >> 28];
 
-        std::printf("[ARM%d      ] [0x%08X] SMUL%s%s%s %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isX) ? "T" : "B", (isY) ? "T" : "B", cond, regNames[rd], regNames[rm], regNames[rs], regNames[rd], cpu->r[rd]);
+        Disasm::trace("[ARM%d      ] [0x%08X] SMUL%s%s%s %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isX) ? "T" : "B", (isY) ? "T" : "B", cond, regNames[rd], regNames[rm], regNames[rs], regNames[rd], cpu->r[rd]);
     }
 }
 
@@ -1172,7 +1224,7 @@ void aMultiplyLong(CPU *cpu, u32 instr) {
     cpu->r[rdlo] = res;
     cpu->r[rdhi] = res >> 32;
 
-    if (doDisasm) std::printf("[ARM%d      ] [0x%08X] %s%s%s %s, %s, %s, %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isSigned) ? "S" : "U", (isA) ? "MLAL" : "MULL", (isS) ? "S" : "", regNames[rdlo], regNames[rdhi], regNames[rm], regNames[rs], regNames[rdlo], cpu->r[rdlo], regNames[rdhi], cpu->r[rdhi]);
+    if (doDisasm) Disasm::trace("[ARM%d      ] [0x%08X] %s%s%s %s, %s, %s, %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isSigned) ? "S" : "U", (isA) ? "MLAL" : "MULL", (isS) ? "S" : "", regNames[rdlo], regNames[rdhi], regNames[rm], regNames[rs], regNames[rdlo], cpu->r[rdlo], regNames[rdhi], cpu->r[rdhi]);
 }
 
 /* ARM state Single Data Transfer */
@@ -1271,15 +1323,15 @@ void aSingleDataTransfer(CPU *cpu, u32 instr) {
 
         if constexpr (isL) {
             if constexpr (isImm) {
-                std::printf("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s0x%03X%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", regNames[rd], addr, cpu->get(rd));
+                Disasm::trace("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s0x%03X%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", regNames[rd], addr, cpu->get(rd));
             } else {
-                std::printf("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s%s, %s %u%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], shiftNames[static_cast<int>(stype)], amt, (isP) ? "]" : "", regNames[rd], addr, data);
+                Disasm::trace("[ARM%d      ] [0x%08X] LDR%s%s %s, %s[%s%s, %s%s, %s %u%s; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], shiftNames[static_cast<int>(stype)], amt, (isP) ? "]" : "", regNames[rd], addr, data);
             }
         } else {
             if constexpr (isImm) {
-                std::printf("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s0x%03X%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", addr, regNames[rd], data);
+                Disasm::trace("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s0x%03X%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", offset, (isP) ? "]" : "", addr, regNames[rd], data);
             } else {
-                std::printf("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s%s, %s %u%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], shiftNames[static_cast<int>(stype)], amt, (isP) ? "]" : "", addr, regNames[rd], data);
+                Disasm::trace("[ARM%d      ] [0x%08X] STR%s%s %s, %s[%s%s, %s%s, %s %u%s; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], (isW) ? "!" : "", regNames[rn], (!isP) ? "]" : "", (!isU) ? "-" : "", regNames[rm], shiftNames[static_cast<int>(stype)], amt, (isP) ? "]" : "", addr, regNames[rd], data);
             }
         }
     }
@@ -1315,7 +1367,7 @@ void aSwap(CPU *cpu, u32 instr) {
     if (doDisasm) {
         const auto cond = condNames[instr >> 28];
 
-        std::printf("[ARM%d      ] [0x%08X] SWP%s%s %s, %s, [%s]; %s = [0x%08X] = 0x%08X, [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], regNames[rm], regNames[rn], regNames[rd], addr, cpu->r[rd], addr, regNames[rm], data);
+        Disasm::trace("[ARM%d      ] [0x%08X] SWP%s%s %s, %s, [%s]; %s = [0x%08X] = 0x%08X, [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, cond, (isB) ? "B" : "", regNames[rd], regNames[rm], regNames[rn], regNames[rd], addr, cpu->r[rd], addr, regNames[rm], data);
     }
 }
 
@@ -1324,10 +1376,10 @@ void aSWI(CPU *cpu, u32 instr) {
     if (doDisasm) {
         const auto cond = condNames[instr >> 28];
 
-        std::printf("[ARM%d      ] [0x%08X] SWI%s 0x%06X\n", cpu->cpuID, cpu->cpc, cond, instr & 0xFFFFFF);
+        Disasm::trace("[ARM%d      ] [0x%08X] SWI%s 0x%06X\n", cpu->cpuID, cpu->cpc, cond, instr & 0xFFFFFF);
     }
 
-    cpu->raiseSVCException();
+    if (!bios::handleSWI(cpu, instr >> 16)) cpu->raiseSVCException();
 }
 
 // Instruction handlers (THUMB)
@@ -1336,7 +1388,7 @@ void aSWI(CPU *cpu, u32 instr) {
 void tUnhandledInstruction(CPU *cpu, u16 instr) {
     const auto opcode = (instr >> 6) & 0x3FF;
 
-    std::printf("[ARM%d:T    ] Unhandled instruction 0x%03X (0x%04X) @ 0x%08X\n", cpu->cpuID, opcode, instr, cpu->cpc);
+    Log::error("[ARM%d:T    ] Unhandled instruction 0x%03X (0x%04X) @ 0x%08X\n", cpu->cpuID, opcode, instr, cpu->cpc);
 
     exit(0);
 }
@@ -1363,9 +1415,9 @@ void tAddShort(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (isImm) {
-            std::printf("[ARM%d:T    ] [0x%08X] %sS %s, %s, %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (opc) ? "SUB" : "ADD", regNames[rd], regNames[rn], rm, regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %sS %s, %s, %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (opc) ? "SUB" : "ADD", regNames[rd], regNames[rn], rm, regNames[rd], cpu->r[rd]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] %sS %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (opc) ? "SUB" : "ADD", regNames[rd], regNames[rn], regNames[rm], regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %sS %s, %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (opc) ? "SUB" : "ADD", regNames[rd], regNames[rn], regNames[rm], regNames[rd], cpu->r[rd]);
         }
     }
 }
@@ -1382,7 +1434,7 @@ void tAdjustSP(CPU *cpu, u16 instr) {
         cpu->r[CPUReg::SP] += offset;
     }
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] %s SP, 0x%03X; SP = 0x%08X\n", cpu->cpuID, cpu->cpc, (opc) ? "SUB" : "ADD", offset, cpu->r[CPUReg::SP]);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] %s SP, 0x%03X; SP = 0x%08X\n", cpu->cpuID, cpu->cpc, (opc) ? "SUB" : "ADD", offset, cpu->r[CPUReg::SP]);
 }
 
 /* THUMB unconditional branch */
@@ -1392,7 +1444,7 @@ void tBranch(CPU *cpu, u16 instr) {
 
     cpu->r[CPUReg::PC] = cpu->get(CPUReg::PC) + offset;
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] B 0x%08X\n", cpu->cpuID, cpu->cpc, cpu->r[CPUReg::PC]);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] B 0x%08X\n", cpu->cpuID, cpu->cpc, cpu->r[CPUReg::PC]);
 }
 
 /* THUMB Branch and Link */
@@ -1424,9 +1476,9 @@ void tBranchLink(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (H == 2) {
-            std::printf("[ARM%d:T    ] [0x%08X] BL; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, cpu->r[CPUReg::LR]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] BL; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, cpu->r[CPUReg::LR]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] BL%s 0x%08X; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, (H == 1) ? "X" : "", cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] BL%s 0x%08X; LR = 0x%08X\n", cpu->cpuID, cpu->cpc, (H == 1) ? "X" : "", cpu->r[CPUReg::PC], cpu->r[CPUReg::LR]);
         }
     }
 }
@@ -1451,9 +1503,9 @@ void tBranchExchange(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (isLink) {
-            std::printf("[ARM%d:T    ] [0x%08X] BLX %s; PC = 0x%08X, LR = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rm], addr, cpu->r[CPUReg::LR]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] BLX %s; PC = 0x%08X, LR = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rm], addr, cpu->r[CPUReg::LR]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] BX %s; PC = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rm], addr);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] BX %s; PC = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rm], addr);
         }
     }
 }
@@ -1468,7 +1520,7 @@ void tConditionalBranch(CPU *cpu, u16 instr) {
 
     if (testCond(cpu, cond)) cpu->r[CPUReg::PC] = target;
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] B%s 0x%08X\n", cpu->cpuID, cpu->cpc, condNames[cond], target);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] B%s 0x%08X\n", cpu->cpuID, cpu->cpc, condNames[cond], target);
 }
 
 /* THUMB Data Processing (register) */
@@ -1478,7 +1530,7 @@ void tDataProcessing(CPU *cpu, u16 instr) {
     const auto rd = (instr >> 0) & 7;
     const auto rm = (instr >> 3) & 7;
 
-    cpu->cout = cpu->cpsr.c; // Required for bit flags
+    keepCarry(cpu);
 
     switch (opcode) {
         case THUMBDPOpcode::AND:
@@ -1508,7 +1560,7 @@ void tDataProcessing(CPU *cpu, u16 instr) {
             break;
         case THUMBDPOpcode::ADC:
             {
-                const auto res = (u64)cpu->r[rd] + (u64)cpu->r[rm] + (u64)cpu->cpsr.c;
+                const auto res = (u64)cpu->r[rd] + (u64)cpu->r[rm] + (u64)getCarry(cpu);
 
                 setADCFlags(cpu, cpu->r[rd], cpu->r[rm], res);
 
@@ -1552,7 +1604,7 @@ void tDataProcessing(CPU *cpu, u16 instr) {
             setBitFlags(cpu, cpu->r[rd]);
             break;
         default:
-            std::printf("[ARM%d:T    ] Unhandled Data Processing opcode %s\n", cpu->cpuID, thumbDPNames[static_cast<int>(opcode)]);
+            Log::error("[ARM%d:T    ] Unhandled Data Processing opcode %s\n", cpu->cpuID, thumbDPNames[static_cast<int>(opcode)]);
 
             exit(0);
     }
@@ -1560,10 +1612,10 @@ void tDataProcessing(CPU *cpu, u16 instr) {
     if (doDisasm) {
         switch (opcode) {
             case THUMBDPOpcode::TST: case THUMBDPOpcode::CMP: case THUMBDPOpcode::CMN:
-                std::printf("[ARM%d:T    ] [0x%08X] %s %s, %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbDPNames[static_cast<int>(opcode)], regNames[rd], regNames[rm], regNames[rd], cpu->r[rd], regNames[rm], cpu->r[rm]);
+                Disasm::trace("[ARM%d:T    ] [0x%08X] %s %s, %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbDPNames[static_cast<int>(opcode)], regNames[rd], regNames[rm], regNames[rd], cpu->r[rd], regNames[rm], cpu->r[rm]);
                 break;
             default:
-                std::printf("[ARM%d:T    ] [0x%08X] %sS %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbDPNames[static_cast<int>(opcode)], regNames[rd], regNames[rm], regNames[rd], cpu->r[rd]);
+                Disasm::trace("[ARM%d:T    ] [0x%08X] %sS %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbDPNames[static_cast<int>(opcode)], regNames[rd], regNames[rm], regNames[rd], cpu->r[rd]);
                 break;
         }
     }
@@ -1579,7 +1631,7 @@ void tDataProcessingLarge(CPU *cpu, u16 instr) {
 
     const auto imm = instr & 0xFF;
 
-    cpu->cout = cpu->cpsr.c; // Required for bit flags
+    keepCarry(cpu);
 
     switch (opcode) {
         case DPOpcode::ADD:
@@ -1610,7 +1662,7 @@ void tDataProcessingLarge(CPU *cpu, u16 instr) {
             break;
     }
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] %s%s %s, %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], (opcode != DPOpcode::CMP) ? "S" : "", regNames[rd], imm, regNames[rd], cpu->r[rd]);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] %s%s %s, %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], (opcode != DPOpcode::CMP) ? "S" : "", regNames[rd], imm, regNames[rd], cpu->r[rd]);
 }
 
 /* THUMB Data Processing (high registers) */
@@ -1639,9 +1691,9 @@ void tDataProcessingSpecial(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (opcode == DPOpcode::CMP) {
-            std::printf("[ARM%d:T    ] [0x%08X] CMP %s, %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], regNames[rm], regNames[rd], op1, regNames[rm], op2);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] CMP %s, %s; %s = 0x%08X, %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], regNames[rm], regNames[rd], op1, regNames[rm], op2);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] %s %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], regNames[rd], regNames[rm], regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %s %s, %s; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, dpNames[static_cast<int>(opcode)], regNames[rd], regNames[rm], regNames[rd], cpu->r[rd]);
         }
     }
 }
@@ -1660,7 +1712,7 @@ void tGetAddress(CPU *cpu, u16 instr) {
         cpu->r[rd] = (cpu->get(CPUReg::PC) & ~3) + offset;
     }
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] ADD %s, %s, 0x%03X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], (isSP) ? "SP" : "PC", offset, regNames[rd], cpu->r[rd]);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] ADD %s, %s, 0x%03X; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], (isSP) ? "SP" : "PC", offset, regNames[rd], cpu->r[rd]);
 }
 
 /* Load from literal pool */
@@ -1674,7 +1726,7 @@ void tLoadFromPool(CPU *cpu, u16 instr) {
 
     cpu->r[rd] = cpu->read32(addr);
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] LDR %s, [0x%08X]; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], addr, regNames[rd], cpu->r[rd]);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] LDR %s, [0x%08X]; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], addr, regNames[rd], cpu->r[rd]);
 }
 
 /* Load from stack */
@@ -1697,9 +1749,9 @@ void tLoadFromStack(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (isL) {
-            std::printf("[ARM%d:T    ] [0x%08X] LDR %s, [SP, 0x%02X]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], offset, regNames[rd], addr, cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] LDR %s, [SP, 0x%02X]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], offset, regNames[rd], addr, cpu->r[rd]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] STR %s, [SP, 0x%02X]; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], offset, addr, regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] STR %s, [SP, 0x%02X]; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], offset, addr, regNames[rd], cpu->r[rd]);
         }
     }
 }
@@ -1723,9 +1775,9 @@ void tLoadHalfwordImmediateOffset(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (isL) {
-            std::printf("[ARM%d:T    ] [0x%08X] LDRH %s, [%s, 0x%02X]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], regNames[rn], offset, regNames[rd], addr, cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] LDRH %s, [%s, 0x%02X]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, regNames[rd], regNames[rn], offset, regNames[rd], addr, cpu->r[rd]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] STRH %s, [%s, 0x%02X]; [0x%08X] = %s = 0x%04X\n", cpu->cpuID, cpu->cpc, regNames[rd], regNames[rn], offset, addr, regNames[rd], cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] STRH %s, [%s, 0x%02X]; [0x%08X] = %s = 0x%04X\n", cpu->cpuID, cpu->cpc, regNames[rd], regNames[rn], offset, addr, regNames[rd], cpu->r[rd]);
         }
     }
 }
@@ -1760,9 +1812,9 @@ void tLoadImmediateOffset(CPU *cpu, u16 instr) {
 
     if (doDisasm) {
         if constexpr (isL) {
-            std::printf("[ARM%d:T    ] [0x%08X] LDR%s %s, [%s, %u]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, (isB) ? "B" : "", regNames[rd], regNames[rn], offset, regNames[rd], addr, cpu->r[rd]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] LDR%s %s, [%s, %u]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, (isB) ? "B" : "", regNames[rd], regNames[rn], offset, regNames[rd], addr, cpu->r[rd]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] STR%s %s, [%s, %u]; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isB) ? "B" : "", regNames[rd], regNames[rn], offset, addr, regNames[rd], data);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] STR%s %s, [%s, %u]; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isB) ? "B" : "", regNames[rd], regNames[rn], offset, addr, regNames[rd], data);
         }
     }
 }
@@ -1799,9 +1851,9 @@ void tLoadMultiple(CPU *cpu, u16 instr) {
         if constexpr (isL) {
             cpu->r[i] = cpu->read32(addr);
 
-            if (doDisasm) std::printf("%s = [0x%08X] = 0x%08X\n", regNames[i], addr, cpu->r[i]);
+            if (doDisasm) Disasm::trace("%s = [0x%08X] = 0x%08X\n", regNames[i], addr, cpu->r[i]);
         } else {
-            if (doDisasm) std::printf("[0x%08X] = %s = 0x%08X\n", addr, regNames[i], cpu->r[i]);
+            if (doDisasm) Disasm::trace("[0x%08X] = %s = 0x%08X\n", addr, regNames[i], cpu->r[i]);
 
             cpu->write32(addr, cpu->r[i]);
         }
@@ -1829,7 +1881,7 @@ void tLoadMultiple(CPU *cpu, u16 instr) {
     if (doDisasm) {
         const auto list = getReglist(reglist);
 
-        std::printf("[ARM%d:T    ] [0x%08X] %sIA %s!, {%s}; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isL) ? "LDM" : "STM", regNames[rn], list.c_str(), regNames[rn], cpu->r[rn]);
+        Disasm::trace("[ARM%d:T    ] [0x%08X] %sIA %s!, {%s}; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, (isL) ? "LDM" : "STM", regNames[rn], list.c_str(), regNames[rn], cpu->r[rn]);
     }
 }
 
@@ -1874,16 +1926,16 @@ void tLoadRegisterOffset(CPU *cpu, u16 instr) {
             cpu->r[rd] = (i16)cpu->read16(addr);
             break;
         default:
-            std::printf("[ARM%d:T    ] Unhandled register offset %s\n", cpu->cpuID, thumbLoadNames[static_cast<int>(opcode)]);
+            Log::error("[ARM%d:T    ] Unhandled register offset %s\n", cpu->cpuID, thumbLoadNames[static_cast<int>(opcode)]);
 
             exit(0);
     }
 
     if (doDisasm) {
         if constexpr ((opcode == THUMBLoadOpcode::STR) || (opcode == THUMBLoadOpcode::STRH) || (opcode == THUMBLoadOpcode::STRB)) {
-            std::printf("[ARM%d:T    ] [0x%08X] %s %s, [%s, %s]; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbLoadNames[static_cast<int>(opcode)], regNames[rd], regNames[rn], regNames[rm], addr, regNames[rd], data);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %s %s, [%s, %s]; [0x%08X] = %s = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbLoadNames[static_cast<int>(opcode)], regNames[rd], regNames[rn], regNames[rm], addr, regNames[rd], data);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] %s %s, [%s, %s]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbLoadNames[static_cast<int>(opcode)], regNames[rd], regNames[rn], regNames[rm], regNames[rd], addr, data);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %s %s, [%s, %s]; %s = [0x%08X] = 0x%08X\n", cpu->cpuID, cpu->cpc, thumbLoadNames[static_cast<int>(opcode)], regNames[rd], regNames[rn], regNames[rm], regNames[rd], addr, data);
         }
     }
 }
@@ -1912,7 +1964,7 @@ void tPop(CPU *cpu, u16 instr) {
         if constexpr (isL) {
             cpu->r[i] = cpu->read32(addr);
 
-            if (doDisasm) std::printf("%s = [0x%08X] = 0x%08X\n", regNames[i], addr, cpu->r[i]);
+            if (doDisasm) Disasm::trace("%s = [0x%08X] = 0x%08X\n", regNames[i], addr, cpu->r[i]);
 
             if ((i == CPUReg::PC) && (cpu->cpuID == 9)) {
                 // Change processor state
@@ -1921,7 +1973,7 @@ void tPop(CPU *cpu, u16 instr) {
                 cpu->r[CPUReg::PC] &= ~1;
             }
         } else {
-            if (doDisasm) std::printf("[0x%08X] = %s = 0x%08X\n", addr, regNames[i], cpu->r[i]);
+            if (doDisasm) Disasm::trace("[0x%08X] = %s = 0x%08X\n", addr, regNames[i], cpu->r[i]);
 
             cpu->write32(addr, cpu->r[i]);
         }
@@ -1937,9 +1989,9 @@ void tPop(CPU *cpu, u16 instr) {
     if (doDisasm) {
         const auto list = getReglist(reglist);
         if constexpr (isL && isR) {
-            std::printf("[ARM%d:T    ] [0x%08X] %s {%s}; PC = 0x%08X\n", cpu->cpuID, cpu->cpc, (isL) ? "POP" : "PUSH", list.c_str(), cpu->r[CPUReg::PC]);
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %s {%s}; PC = 0x%08X\n", cpu->cpuID, cpu->cpc, (isL) ? "POP" : "PUSH", list.c_str(), cpu->r[CPUReg::PC]);
         } else {
-            std::printf("[ARM%d:T    ] [0x%08X] %s {%s}\n", cpu->cpuID, cpu->cpc, (isL) ? "POP" : "PUSH", list.c_str());
+            Disasm::trace("[ARM%d:T    ] [0x%08X] %s {%s}\n", cpu->cpuID, cpu->cpc, (isL) ? "POP" : "PUSH", list.c_str());
         }
     }
 }
@@ -1957,14 +2009,14 @@ void tShift(CPU *cpu, u16 instr) {
 
     setBitFlags(cpu, cpu->r[rd]);
 
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] %sS %s, %s, %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, shiftNames[static_cast<int>(stype)], regNames[rd], regNames[rm], amt, regNames[rd], cpu->r[rd]);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] %sS %s, %s, %u; %s = 0x%08X\n", cpu->cpuID, cpu->cpc, shiftNames[static_cast<int>(stype)], regNames[rd], regNames[rm], amt, regNames[rd], cpu->r[rd]);
 }
 
 /* THUMB state SWI */
 void tSWI(CPU *cpu, u16 instr) {
-    if (doDisasm) std::printf("[ARM%d:T    ] [0x%08X] SWI 0x%02X\n", cpu->cpuID, cpu->cpc, instr & 0xFF);
+    if (doDisasm) Disasm::trace("[ARM%d:T    ] [0x%08X] SWI 0x%02X\n", cpu->cpuID, cpu->cpc, instr & 0xFF);
 
-    cpu->raiseSVCException();
+    if (!bios::handleSWI(cpu, instr)) cpu->raiseSVCException();
 }
 
 void decodeUnconditional(CPU *cpu, u32 instr) {
@@ -1976,19 +2028,52 @@ void decodeUnconditional(CPU *cpu, u32 instr) {
             aBLX<true>(cpu, instr);
             break;
         default:
-            std::printf("[ARM%d      ] Unhandled unconditional instruction 0x%08X @ 0x%08X\n", cpu->cpuID, instr, cpu->cpc);
+            Log::error("[ARM%d      ] Unhandled unconditional instruction 0x%08X @ 0x%08X\n", cpu->cpuID, instr, cpu->cpc);
 
             exit(0);
     }
 }
 
+// Instruction fetch
+
+u32 fetchGen; // Incremented when the memory map changes
+
+/* Returns a host pointer to an instruction, NULL if its page can't be read directly. Only refreshes the cached page on page crossings and memory map changes */
+u8 *getFetchPointer(CPU *cpu, u32 addr) {
+    if (((addr & ~0xFFF) != cpu->fetchBase) || (cpu->fetchGen != fetchGen)) {
+        cpu->fetchBase = addr & ~0xFFF;
+        cpu->fetchGen  = fetchGen;
+        cpu->fetchPage = cpu->getCodePointer(cpu->fetchBase);
+    }
+
+    return (cpu->fetchPage != NULL) ? &cpu->fetchPage[addr & 0xFFF] : NULL;
+}
+
+/* Fetches an instruction, bypasses the bus if possible */
+template<typename T>
+T fetch(CPU *cpu, u32 addr) {
+    if (const auto codePtr = getFetchPointer(cpu, addr); codePtr != NULL) {
+        T instr;
+
+        std::memcpy(&instr, codePtr, sizeof(T));
+
+        return instr;
+    }
+
+    if constexpr (sizeof(T) == sizeof(u32)) {
+        return cpu->read32(addr);
+    } else {
+        return cpu->read16(addr);
+    }
+}
+
 void decodeARM(CPU *cpu) {
     cpu->r[CPUReg::PC] &= ~3;
 
     cpu->cpc = cpu->r[CPUReg::PC];
 
     // Fetch instruction, increment program counter
-    const auto instr = cpu->read32(cpu->cpc);
+    const auto instr = fetch<u32>(cpu, cpu->cpc);
 
     cpu->r[CPUReg::PC] += 4;
 
@@ -2011,7 +2096,7 @@ void decodeTHUMB(CPU *cpu) {
     cpu->cpc = cpu->r[CPUReg::PC];
 
     // Fetch instruction, increment program counter
-    const auto instr = cpu->read16(cpu->cpc);
+    const auto instr = fetch<u16>(cpu, cpu->cpc);
 
     cpu->r[CPUReg::PC] += 2;
 
@@ -2021,267 +2106,763 @@ void decodeTHUMB(CPU *cpu) {
     instrTableTHUMB[opcode](cpu, instr);
 }
 
+/* Executes a single instruction without going through the block cache */
+void step(CPU *cpu) {
+    (cpu->cpsr.t) ? decodeTHUMB(cpu) : decodeARM(cpu);
+}
+
+// Block cache
+
+std::unordered_map<u32, Block> blocks[2]; // ARM7, ARM9
+
+std::array<u32 , CODE_PAGE_NUM> codePageVersion;
+std::array<bool, CODE_PAGE_NUM> isCodePage;
+
+u32 blockGen;
+
+bool isBlockInvalid; // Set if a code page was written to or the cache was flushed
+
+/* Returns the (hashed) host code page of a pointer */
+u32 getCodePage(const u8 *codePtr) {
+    return ((uintptr_t)codePtr >> 12) & (CODE_PAGE_NUM - 1);
+}
+
+/* Returns true if an ARM state instruction may change PC, state or memory map */
+bool isBranchARM(u32 instr) {
+    if ((instr >> 28) == Condition::NV) return true;
+
+    switch ((instr >> 25) & 7) {
+        case 0: case 1: case 2: case 3: // Data processing, BX/BLX, MSR, single data transfers
+            return ((instr >> 12) & 0xF) == CPUReg::PC;
+        case 4: // LDM
+            return (instr & (1 << 20)) && (instr & (1 << CPUReg::PC));
+        case 5: // B/BL
+            return true;
+        case 6:
+            return false;
+        case 7: // MCR/MRC, SWI
+            return true;
+    }
+
+    return true;
+}
+
+/* Returns true if a THUMB state instruction may change PC or state */
+bool isBranchTHUMB(u16 instr) {
+    switch (instr >> 12) {
+        case 0x4: // Hi register operations/BX/BLX
+            return ((instr & 0xFC00) == 0x4400) && ((((instr >> 8) & 3) == 3) || ((instr & 0x87) == 0x87));
+        case 0xB: // POP {PC}
+            return (instr & 0xFF00) == 0xBD00;
+        case 0xD: case 0xE: // Conditional branch, SWI, B, BLX
+            return true;
+        case 0xF: // BL
+            return instr & (1 << 11);
+        default:
+            return false;
+    }
+}
+
+/* Runs a block instruction, then tail calls the next one. Returns the number of remaining cycles */
+template<void (*handler)(CPU *, u32)>
+i64 runThreadedARM(CPU *cpu, const BlockInstr *i, i64 cycles) {
+    cpu->cpc = cpu->r[CPUReg::PC];
+
+    cpu->r[CPUReg::PC] += 4;
+
+    if (testCond(cpu, i->cond)) handler(cpu, i->instr);
+
+    // Stop at the end of the block, on branches, exceptions, state changes, halts and code writes
+    if (!--cycles || (cpu->r[CPUReg::PC] != (cpu->cpc + 4)) || cpu->cpsr.t || cpu->isHalted || isBlockInvalid) return cycles;
+
+    MUSTTAIL return i[1].threaded(cpu, &i[1], cycles);
+}
+
+/* Runs a block instruction, then tail calls the next one. Returns the number of remaining cycles */
+template<void (*handler)(CPU *, u16)>
+i64 runThreadedTHUMB(CPU *cpu, const BlockInstr *i, i64 cycles) {
+    cpu->cpc = cpu->r[CPUReg::PC];
+
+    cpu->r[CPUReg::PC] += 2;
+
+    handler(cpu, i->instr);
+
+    // Stop at the end of the block, on branches, exceptions, state changes, halts and code writes
+    if (!--cycles || (cpu->r[CPUReg::PC] != (cpu->cpc + 2)) || !cpu->cpsr.t || cpu->isHalted || isBlockInvalid) return cycles;
+
+    MUSTTAIL return i[1].threaded(cpu, &i[1], cycles);
+}
+
+/* Register and flag accesses of an idle loop instruction */
+struct LoopAccess {
+    u32 read, written;
+
+    bool isLoad; // Load from a guest register-relative address
+
+    u32 base, offset;
+};
+
+/* Gets the accesses of an ARM state instruction. Returns false if the instruction can't be part of an idle loop */
+bool getLoopAccessARM(u32 instr, LoopAccess &access) {
+    access = LoopAccess{};
+
+    if ((instr >> 28) != Condition::AL) return false;
+
+    const auto rd = (instr >> 12) & 0xF;
+    const auto rn = (instr >> 16) & 0xF;
+    const auto rm = (instr >>  0) & 0xF;
+
+    if ((instr & 0x0F300000) == 0x05100000) { // LDR/LDRB, immediate offset
+        if (rd == CPUReg::PC) return false;
+
+        access.written = 1 << rd;
+
+        if (rn == CPUReg::PC) return true; // Literal pool, constant
+
+        access.read = 1 << rn;
+
+        access.isLoad = true;
+        access.base   = rn;
+        access.offset = (instr & (1 << 23)) ? (instr & 0xFFF) : -(instr & 0xFFF);
+
+        return true;
+    }
+
+    if ((instr & 0x0F7000F0) == 0x015000B0) { // LDRH, immediate offset
+        if ((rd == CPUReg::PC) || (rn == CPUReg::PC)) return false;
+
+        const auto offset = ((instr >> 4) & 0xF0) | (instr & 0xF);
+
+        access.read    = 1 << rn;
+        access.written = 1 << rd;
+
+        access.isLoad = true;
+        access.base   = rn;
+        access.offset = (instr & (1 << 23)) ? offset : -offset;
+
+        return true;
+    }
+
+    // Data processing with immediate shifts
+    if (instr & (3 << 26)) return false;
+
+    const bool isImm = instr & (1 << 25);
+    const bool isS   = instr & (1 << 20);
+
+    if (!isImm && (instr & (1 << 4))) return false;
+
+    const auto opcode = (DPOpcode)((instr >> 21) & 0xF);
+
+    bool hasOp1 = true, isCompare = false;
+
+    switch (opcode) {
+        case DPOpcode::ADC: case DPOpcode::SBC: case DPOpcode::RSC:
+            return false;
+        case DPOpcode::TST: case DPOpcode::TEQ: case DPOpcode::CMP: case DPOpcode::CMN:
+            if (!isS) return false;
+
+            isCompare = true;
+            break;
+        case DPOpcode::MOV: case DPOpcode::MVN:
+            hasOp1 = false;
+            break;
+        default:
+            break;
+    }
+
+    if ((rd == CPUReg::PC) || (hasOp1 && (rn == CPUReg::PC)) || (!isImm && (rm == CPUReg::PC))) return false;
+
+    if (hasOp1) access.read |= 1 << rn;
+    if (!isImm) access.read |= 1 << rm;
+
+    if (!isCompare) access.written |= 1 << rd;
+    if (isS) access.written |= IDLE_LOOP_FLAGS;
+
+    return true;
+}
+
+/* Gets the accesses of a THUMB state instruction. Returns false if the instruction can't be part of an idle loop */
+bool getLoopAccessTHUMB(u16 instr, LoopAccess &access) {
+    access = LoopAccess{};
+
+    const auto rd = (instr >> 0) & 7;
+    const auto rn = (instr >> 3) & 7;
+    const auto rm = (instr >> 6) & 7;
+
+    const auto rdLarge = (instr >> 8) & 7;
+
+    switch (instr >> 11) {
+        case 0x00: case 0x01: case 0x02: // Shift by immediate
+            access.read    = 1 << rn;
+            access.written = (1 << rd) | IDLE_LOOP_FLAGS;
+            break;
+        case 0x03: // ADD/SUB short/register
+            access.read    = (1 << rn) | ((instr & (1 << 10)) ? 0 : 1 << rm);
+            access.written = (1 << rd) | IDLE_LOOP_FLAGS;
+            break;
+        case 0x04: // MOV imm
+            access.written = (1 << rdLarge) | IDLE_LOOP_FLAGS;
+            break;
+        case 0x05: // CMP imm
+            access.read    = 1 << rdLarge;
+            access.written = IDLE_LOOP_FLAGS;
+            break;
+        case 0x06: case 0x07: // ADD/SUB imm
+            access.read    = 1 << rdLarge;
+            access.written = (1 << rdLarge) | IDLE_LOOP_FLAGS;
+            break;
+        case 0x08: // ALU operations
+            {
+                if (instr & (1 << 10)) return false; // High register operations, BX
+
+                const auto opcode = (THUMBDPOpcode)((instr >> 6) & 0xF);
+
+                if ((opcode == THUMBDPOpcode::ADC) || (opcode == THUMBDPOpcode::SBC)) return false;
+
+                access.read    = 1 << rn;
+                access.written = IDLE_LOOP_FLAGS;
+
+                if ((opcode != THUMBDPOpcode::NEG) && (opcode != THUMBDPOpcode::MVN)) access.read |= 1 << rd;
+
+                if ((opcode != THUMBDPOpcode::TST) && (opcode != THUMBDPOpcode::CMP) && (opcode != THUMBDPOpcode::CMN)) access.written |= 1 << rd;
+            }
+            break;
+        case 0x09: // Literal pool load, constant
+            access.written = 1 << rdLarge;
+            break;
+        case 0x0D: // LDR
+        case 0x0F: // LDRB
+        case 0x11: // LDRH
+            access.read    = 1 << rn;
+            access.written = 1 << rd;
+
+            access.isLoad = true;
+            access.base   = rn;
+            access.offset = ((instr >> 6) & 0x1F) << ((instr >> 11) == 0x0D ? 2 : (instr >> 11) == 0x11 ? 1 : 0);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+/* Checks if a block is a loop that only polls memory and has no loop-carried state */
+void findIdleLoop(Block &block, u32 pc, bool isTHUMB) {
+    block.isIdleLoop = false;
+
+    const u32 size = block.instrs.size();
+
+    if (size > MAX_IDLE_LOOP_SIZE) return;
+
+    // Last instruction has to branch back to the start of the block
+    const auto branch = block.instrs.back().instr;
+    const auto branchAddr = pc + ((isTHUMB) ? 2 : 4) * (size - 1);
+
+    u32 target, branchRead = 0;
+
+    if (isTHUMB) {
+        if ((branch & 0xF800) == 0xE000) {
+            target = branchAddr + 4 + ((i32)(branch << 21) >> 20);
+        } else if (((branch & 0xF000) == 0xD000) && (((branch >> 8) & 0xF) < Condition::AL)) {
+            target = branchAddr + 4 + ((i32)(i8)branch << 1);
+
+            branchRead = IDLE_LOOP_FLAGS;
+        } else {
+            return;
+        }
+    } else {
+        if (((branch & 0x0F000000) != 0x0A000000) || ((branch >> 28) == Condition::NV)) return;
+
+        target = branchAddr + 8 + ((i32)(branch << 8) >> 6);
+
+        if ((branch >> 28) != Condition::AL) branchRead = IDLE_LOOP_FLAGS;
+    }
+
+    if (target != pc) return;
+
+    // Registers (and flags) that are read before being written in one iteration must not be written later
+    u32 readFirst = 0, written = 0;
+
+    bool hasLoad = false;
+
+    block.idleBase = 16;
+
+    for (u32 i = 0; i < (size - 1); i++) {
+        LoopAccess access;
+
+        const auto isValid = (isTHUMB) ? getLoopAccessTHUMB(block.instrs[i].instr, access) : getLoopAccessARM(block.instrs[i].instr, access);
+
+        if (!isValid) return;
+
+        readFirst |= access.read & ~written;
+        written   |= access.written;
+
+        if (access.isLoad) {
+            if (hasLoad) return; // Only poll one location
+
+            hasLoad = true;
+
+            block.idleBase   = access.base;
+            block.idleOffset = access.offset;
+        }
+    }
+
+    readFirst |= branchRead & ~written;
+
+    block.isIdleLoop = !(readFirst & written);
+}
+
+/* Returns the block at PC, decodes a new one if needed. Returns NULL if the code page can't be cached */
+Block *getBlock(CPU *cpu) {
+    const auto isTHUMB = cpu->cpsr.t;
+
+    cpu->r[CPUReg::PC] &= (isTHUMB) ? ~1 : ~3;
+
+    const auto pc = cpu->r[CPUReg::PC];
+
+    auto &cache = blocks[cpu->cpuID == 9];
+
+    if (const auto it = cache.find(pc | isTHUMB); it != cache.end()) {
+        auto &block = it->second;
+
+        if ((block.gen == blockGen) && (block.version[0] == codePageVersion[block.page[0]]) && (block.version[1] == codePageVersion[block.page[1]])) return &block;
+    }
+
+    const auto codePtr = getFetchPointer(cpu, pc);
+
+    if (codePtr == NULL) return NULL;
+
+    auto &block = cache[pc | isTHUMB];
+
+    block.instrs.clear();
+
+    block.code     = NULL;
+    block.runCount = 0;
+
+    // Blocks never cross a 4KB page
+    const u32 instrSize = (isTHUMB) ? 2 : 4;
+    const u32 maxSize   = std::min((u32)MAX_BLOCK_SIZE, (0x1000 - (pc & 0xFFF)) / instrSize);
+
+    for (u32 i = 0; i < maxSize; i++) {
+        BlockInstr blockInstr;
+
+        if (isTHUMB) {
+            u16 instr;
+
+            std::memcpy(&instr, &codePtr[2 * i], sizeof(u16));
+
+            blockInstr.handlerTHUMB = instrTableTHUMB[(instr >> 6) & 0x3FF];
+            blockInstr.threaded     = threadedTableTHUMB[(instr >> 6) & 0x3FF];
+
+            blockInstr.instr = instr;
+            blockInstr.cond  = Condition::AL;
+
+            block.instrs.push_back(blockInstr);
+
+            if (isBranchTHUMB(instr)) break;
+        } else {
+            u32 instr;
+
+            std::memcpy(&instr, &codePtr[4 * i], sizeof(u32));
+
+            blockInstr.cond = Condition(instr >> 28);
+
+            if (blockInstr.cond == Condition::NV) {
+                blockInstr.handlerARM = &decodeUnconditional;
+                blockInstr.threaded   = &runThreadedARM<&decodeUnconditional>;
+
+                blockInstr.cond = Condition::AL;
+            } else {
+                const auto opcode = ((instr >> 4) & 0xF) | ((instr >> 16) & 0xFF0);
+
+                blockInstr.handlerARM = instrTableARM[opcode];
+                blockInstr.threaded   = threadedTableARM[opcode];
+            }
+
+            blockInstr.instr = instr;
+
+            block.instrs.push_back(blockInstr);
+
+            if (isBranchARM(instr)) break;
+        }
+    }
+
+    findIdleLoop(block, pc, isTHUMB);
+
+    block.gen = blockGen;
+
+    block.page[0] = getCodePage(codePtr);
+    block.page[1] = getCodePage(codePtr + instrSize * block.instrs.size() - 1);
+
+    for (int i = 0; i < 2; i++) {
+        block.version[i] = codePageVersion[block.page[i]];
+
+        isCodePage[block.page[i]] = true;
+    }
+
+    return &block;
+}
+
+/* Executes a block until it ends, leaves the straight-line path or runs out of cycles. Returns the number of executed instructions */
+i64 runBlock(CPU *cpu, const Block &block, i64 runCycles) {
+    const auto isTHUMB = cpu->cpsr.t;
+
+    const u32 instrSize = (isTHUMB) ? 2 : 4;
+
+    isBlockInvalid = false;
+
+    if constexpr (doThreadedDispatch) {
+        const auto first = block.instrs.data();
+
+        const auto cycles = std::min(runCycles, (i64)block.instrs.size());
+
+        return cycles - first->threaded(cpu, first, cycles);
+    }
+
+    auto pc = cpu->r[CPUReg::PC];
+
+    i64 cycles = 0;
+
+    for (const auto &i : block.instrs) {
+        cpu->cpc = pc;
+
+        pc += instrSize;
+
+        cpu->r[CPUReg::PC] = pc;
+
+        if (isTHUMB) {
+            i.handlerTHUMB(cpu, i.instr);
+        } else if (testCond(cpu, i.cond)) {
+            i.handlerARM(cpu, i.instr);
+        }
+
+        cycles++;
+
+        // Stop on branches, exceptions, state changes, halts and code writes
+        if ((cpu->r[CPUReg::PC] != pc) || (cpu->cpsr.t != isTHUMB) || cpu->isHalted || isBlockInvalid || (cycles == runCycles)) break;
+    }
+
+    return cycles;
+}
+
+/* Returns true if the block that started at pc is an idle loop that went around once. Idle loops can't exit before the next scheduler event */
+bool isIdle(CPU *cpu, const Block &block, u32 pc) {
+    if (!block.isIdleLoop || (cpu->r[CPUReg::PC] != pc)) return false;
+
+    // Reads from the IPC FIFO and cartridge bus have side effects
+    return (block.idleBase == 16) || ((cpu->r[block.idleBase] + block.idleOffset) < 0x04100000);
+}
+
+/* Invalidates all blocks in the host code page of codePtr. Every guest RAM write ends up here, so this also marks the page dirty */
+void invalidateBlocks(const u8 *codePtr) {
+    fastmem::markDirty(codePtr);
+
+    const auto page = getCodePage(codePtr);
+
+    if (!isCodePage[page]) return;
+
+    isCodePage[page] = false;
+
+    codePageVersion[page]++;
+
+    isBlockInvalid = true;
+}
+
+/* Invalidates all blocks in a host memory range */
+void invalidateRange(const u8 *mem, u32 size) {
+    if (!size) return;
+
+    fastmem::markDirtyRange(mem, size);
+
+    for (u32 i = 0; i < size; i += 0x1000) invalidateBlocks(&mem[i]);
+
+    invalidateBlocks(&mem[size - 1]);
+}
+
+/* Invalidates all blocks and cached code pages, required if the memory map changes */
+void flushBlocks() {
+    blockGen++;
+    fetchGen++;
+
+    isBlockInvalid = true;
+}
+
+/* Sets the handler and threaded handler of an ARM instruction table entry */
+template<void (*handler)(CPU *, u32)>
+void setARM(int idx) {
+    instrTableARM   [idx] = handler;
+    threadedTableARM[idx] = &runThreadedARM<handler>;
+}
+
+/* Sets the handler and threaded handler of a THUMB instruction table entry */
+template<void (*handler)(CPU *, u16)>
+void setTHUMB(int idx) {
+    instrTableTHUMB   [idx] = handler;
+    threadedTableTHUMB[idx] = &runThreadedTHUMB<handler>;
+}
+
 void init() {
     // Populate instruction tables
 
     // ARM
-    for (auto &i : instrTableARM  ) i = &aUnhandledInstruction;
-    for (auto &i : instrTableTHUMB) i = &tUnhandledInstruction;
+    for (int i = 0; i < 4096; i++) setARM<&aUnhandledInstruction>(i);
+    for (int i = 0; i < 1024; i++) setTHUMB<&tUnhandledInstruction>(i);
 
     for (int i = 0x000; i < 0x200; i++) {
         if (!(i & 1) && ((i & 0x191) != 0x100)) { // Don't include misc instructions
             // Immediate shift
-            instrTableARM[i] = &aDataProcessing<0, 1, 0>;
+            setARM<&aDataProcessing<0, 1, 0>>(i);
         }
 
         if (((i & 9) == 1) && ((i & 0x199) != 0x101)) { // Don't include multiplies
             // Register shift
-            instrTableARM[i] = &aDataProcessing<0, 0, 1>;
+            setARM<&aDataProcessing<0, 0, 1>>(i);
         }
 
         if (((i & 0x1B0) != 0x100) && ((i & 0x1B0) != 0x120)) { // Don't include UDF and MSR
             // Immediate DP
-            instrTableARM[i | 0x200] = &aDataProcessing<1, 0, 0>;
+            setARM<&aDataProcessing<1, 0, 0>>(i | 0x200);
         }
     }
 
-    instrTableARM[0x009] = &aMultiply<0, 0>;
-    instrTableARM[0x019] = &aMultiply<0, 1>;
-    instrTableARM[0x029] = &aMultiply<1, 0>;
-    instrTableARM[0x039] = &aMultiply<1, 1>;
-
-    instrTableARM[0x089] = &aMultiplyLong<0, 0, 0>;
-    instrTableARM[0x099] = &aMultiplyLong<0, 0, 1>;
-    instrTableARM[0x0A9] = &aMultiplyLong<0, 1, 0>;
-    instrTableARM[0x0B9] = &aMultiplyLong<0, 1, 1>;
-    instrTableARM[0x0C9] = &aMultiplyLong<1, 0, 0>;
-    instrTableARM[0x0D9] = &aMultiplyLong<1, 0, 1>;
-    instrTableARM[0x0E9] = &aMultiplyLong<1, 1, 0>;
-    instrTableARM[0x0F9] = &aMultiplyLong<1, 1, 1>;
-
-    instrTableARM[0x109] = &aSwap<0>;
-    instrTableARM[0x149] = &aSwap<1>;
-
-    instrTableARM[0x00B] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 0, 0>;
-    instrTableARM[0x02B] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 0, 1>;
-    instrTableARM[0x04B] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 1, 0>;
-    instrTableARM[0x06B] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 1, 1>;
-    instrTableARM[0x08B] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 0, 0>;
-    instrTableARM[0x0AB] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 0, 1>;
-    instrTableARM[0x0CB] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 1, 0>;
-    instrTableARM[0x0EB] = &aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 1, 1>;
-    instrTableARM[0x10B] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 0, 0>;
-    instrTableARM[0x12B] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 0, 1>;
-    instrTableARM[0x14B] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 1, 0>;
-    instrTableARM[0x16B] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 1, 1>;
-    instrTableARM[0x18B] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 0, 0>;
-    instrTableARM[0x1AB] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 0, 1>;
-    instrTableARM[0x1CB] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 1, 0>;
-    instrTableARM[0x1EB] = &aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 1, 1>;
-    instrTableARM[0x01B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 0, 0>;
-    instrTableARM[0x03B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 0, 1>;
-    instrTableARM[0x05B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 1, 0>;
-    instrTableARM[0x07B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 1, 1>;
-    instrTableARM[0x09B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 0, 0>;
-    instrTableARM[0x0BB] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 0, 1>;
-    instrTableARM[0x0DB] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 1, 0>;
-    instrTableARM[0x0FB] = &aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 1, 1>;
-    instrTableARM[0x11B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 0, 0>;
-    instrTableARM[0x13B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 0, 1>;
-    instrTableARM[0x15B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 1, 0>;
-    instrTableARM[0x17B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 1, 1>;
-    instrTableARM[0x19B] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 0, 0>;
-    instrTableARM[0x1BB] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 0, 1>;
-    instrTableARM[0x1DB] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 1, 0>;
-    instrTableARM[0x1FB] = &aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 1, 1>;
-    instrTableARM[0x01D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 0, 0>;
-    instrTableARM[0x03D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 0, 1>;
-    instrTableARM[0x05D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 1, 0>;
-    instrTableARM[0x07D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 1, 1>;
-    instrTableARM[0x09D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 0, 0>;
-    instrTableARM[0x0BD] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 0, 1>;
-    instrTableARM[0x0DD] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 1, 0>;
-    instrTableARM[0x0FD] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 1, 1>;
-    instrTableARM[0x11D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 0, 0>;
-    instrTableARM[0x13D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 0, 1>;
-    instrTableARM[0x15D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 1, 0>;
-    instrTableARM[0x17D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 1, 1>;
-    instrTableARM[0x19D] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 0, 0>;
-    instrTableARM[0x1BD] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 0, 1>;
-    instrTableARM[0x1DD] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 1, 0>;
-    instrTableARM[0x1FD] = &aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 1, 1>;
-    instrTableARM[0x01F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 0, 0>;
-    instrTableARM[0x03F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 0, 1>;
-    instrTableARM[0x05F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 1, 0>;
-    instrTableARM[0x07F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 1, 1>;
-    instrTableARM[0x09F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 0, 0>;
-    instrTableARM[0x0BF] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 0, 1>;
-    instrTableARM[0x0DF] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 1, 0>;
-    instrTableARM[0x0FF] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 1, 1>;
-    instrTableARM[0x11F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 0, 0>;
-    instrTableARM[0x13F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 0, 1>;
-    instrTableARM[0x15F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 1, 0>;
-    instrTableARM[0x17F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 1, 1>;
-    instrTableARM[0x19F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 0, 0>;
-    instrTableARM[0x1BF] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 0, 1>;
-    instrTableARM[0x1DF] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 1, 0>;
-    instrTableARM[0x1FF] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 1, 1>;
-
-    //instrTableARM[0x00D] = &aExtraLoad<ExtraLoadOpcode::LDRD , 0, 0, 0, 0>;
-    //instrTableARM[0x00F] = &aExtraLoad<ExtraLoadOpcode::STRD , 0, 0, 0, 0>;
-    //instrTableARM[0x01F] = &aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 0, 0>;
-
-    instrTableARM[0x100] = &aMRS<0>;
-    instrTableARM[0x120] = &aMSR<0, 0>;
-    instrTableARM[0x140] = &aMRS<1>;
-    instrTableARM[0x160] = &aMSR<1, 0>;
+    setARM<&aMultiply<0, 0>>(0x009);
+    setARM<&aMultiply<0, 1>>(0x019);
+    setARM<&aMultiply<1, 0>>(0x029);
+    setARM<&aMultiply<1, 1>>(0x039);
+
+    setARM<&aMultiplyLong<0, 0, 0>>(0x089);
+    setARM<&aMultiplyLong<0, 0, 1>>(0x099);
+    setARM<&aMultiplyLong<0, 1, 0>>(0x0A9);
+    setARM<&aMultiplyLong<0, 1, 1>>(0x0B9);
+    setARM<&aMultiplyLong<1, 0, 0>>(0x0C9);
+    setARM<&aMultiplyLong<1, 0, 1>>(0x0D9);
+    setARM<&aMultiplyLong<1, 1, 0>>(0x0E9);
+    setARM<&aMultiplyLong<1, 1, 1>>(0x0F9);
+
+    setARM<&aSwap<0>>(0x109);
+    setARM<&aSwap<1>>(0x149);
+
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 0, 0>>(0x00B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 0, 1>>(0x02B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 1, 0>>(0x04B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 0, 1, 1>>(0x06B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 0, 0>>(0x08B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 0, 1>>(0x0AB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 1, 0>>(0x0CB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 0, 1, 1, 1>>(0x0EB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 0, 0>>(0x10B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 0, 1>>(0x12B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 1, 0>>(0x14B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 0, 1, 1>>(0x16B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 0, 0>>(0x18B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 0, 1>>(0x1AB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 1, 0>>(0x1CB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::STRH , 1, 1, 1, 1>>(0x1EB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 0, 0>>(0x01B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 0, 1>>(0x03B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 1, 0>>(0x05B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 0, 1, 1>>(0x07B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 0, 0>>(0x09B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 0, 1>>(0x0BB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 1, 0>>(0x0DB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 0, 1, 1, 1>>(0x0FB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 0, 0>>(0x11B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 0, 1>>(0x13B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 1, 0>>(0x15B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 0, 1, 1>>(0x17B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 0, 0>>(0x19B);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 0, 1>>(0x1BB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 1, 0>>(0x1DB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRH , 1, 1, 1, 1>>(0x1FB);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 0, 0>>(0x01D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 0, 1>>(0x03D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 1, 0>>(0x05D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 0, 1, 1>>(0x07D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 0, 0>>(0x09D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 0, 1>>(0x0BD);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 1, 0>>(0x0DD);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 0, 1, 1, 1>>(0x0FD);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 0, 0>>(0x11D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 0, 1>>(0x13D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 1, 0>>(0x15D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 0, 1, 1>>(0x17D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 0, 0>>(0x19D);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 0, 1>>(0x1BD);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 1, 0>>(0x1DD);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSB, 1, 1, 1, 1>>(0x1FD);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 0, 0>>(0x01F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 0, 1>>(0x03F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 1, 0>>(0x05F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 1, 1>>(0x07F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 0, 0>>(0x09F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 0, 1>>(0x0BF);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 1, 0>>(0x0DF);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 1, 1, 1>>(0x0FF);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 0, 0>>(0x11F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 0, 1>>(0x13F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 1, 0>>(0x15F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 0, 1, 1>>(0x17F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 0, 0>>(0x19F);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 0, 1>>(0x1BF);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 1, 0>>(0x1DF);
+    setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 1, 1, 1, 1>>(0x1FF);
+
+    //setARM<&aExtraLoad<ExtraLoadOpcode::LDRD , 0, 0, 0, 0>>(0x00D);
+    //setARM<&aExtraLoad<ExtraLoadOpcode::STRD , 0, 0, 0, 0>>(0x00F);
+    //setARM<&aExtraLoad<ExtraLoadOpcode::LDRSH, 0, 0, 0, 0>>(0x01F);
+
+    setARM<&aMRS<0>>(0x100);
+    setARM<&aMSR<0, 0>>(0x120);
+    setARM<&aMRS<1>>(0x140);
+    setARM<&aMSR<1, 0>>(0x160);
     
-    instrTableARM[0x121] = &aBX;
-    instrTableARM[0x123] = &aBLX<0>;
+    setARM<&aBX>(0x121);
+    setARM<&aBLX<0>>(0x123);
 
-    instrTableARM[0x161] = &aCLZ;
+    setARM<&aCLZ>(0x161);
 
-    instrTableARM[0x108] = &aSMLAxy<0, 0>;
-    instrTableARM[0x10A] = &aSMLAxy<0, 1>;
-    instrTableARM[0x10C] = &aSMLAxy<1, 0>;
-    instrTableARM[0x10E] = &aSMLAxy<1, 1>;
+    setARM<&aSMLAxy<0, 0>>(0x108);
+    setARM<&aSMLAxy<0, 1>>(0x10A);
+    setARM<&aSMLAxy<1, 0>>(0x10C);
+    setARM<&aSMLAxy<1, 1>>(0x10E);
 
-    instrTableARM[0x168] = &aSMULxy<0, 0>;
-    instrTableARM[0x16A] = &aSMULxy<0, 1>;
-    instrTableARM[0x16C] = &aSMULxy<1, 0>;
-    instrTableARM[0x16E] = &aSMULxy<1, 1>;
+    setARM<&aSMULxy<0, 0>>(0x168);
+    setARM<&aSMULxy<0, 1>>(0x16A);
+    setARM<&aSMULxy<1, 0>>(0x16C);
+    setARM<&aSMULxy<1, 1>>(0x16E);
 
     for (int i = 0x320; i < 0x330; i++) {
-        instrTableARM[i | (0 << 6)] = &aMSR<0, 1>;
-        instrTableARM[i | (1 << 6)] = &aMSR<1, 1>;
+        setARM<&aMSR<0, 1>>(i | (0 << 6));
+        setARM<&aMSR<1, 1>>(i | (1 << 6));
     }
 
     for (int i = 0x400; i < 0x600; i++) {
         // Immediate SDT
         switch ((i >> 4) & 0x1F) {
-            case 0x00: instrTableARM[i] = &aSingleDataTransfer<0, 0, 0, 0, 0, 1>; break;
-            case 0x01: instrTableARM[i] = &aSingleDataTransfer<0, 0, 0, 0, 1, 1>; break;
-            case 0x02: instrTableARM[i] = &aSingleDataTransfer<0, 0, 0, 1, 0, 1>; break;
-            case 0x03: instrTableARM[i] = &aSingleDataTransfer<0, 0, 0, 1, 1, 1>; break;
-            case 0x04: instrTableARM[i] = &aSingleDataTransfer<0, 0, 1, 0, 0, 1>; break;
-            case 0x05: instrTableARM[i] = &aSingleDataTransfer<0, 0, 1, 0, 1, 1>; break;
-            case 0x06: instrTableARM[i] = &aSingleDataTransfer<0, 0, 1, 1, 0, 1>; break;
-            case 0x07: instrTableARM[i] = &aSingleDataTransfer<0, 0, 1, 1, 1, 1>; break;
-            case 0x08: instrTableARM[i] = &aSingleDataTransfer<0, 1, 0, 0, 0, 1>; break;
-            case 0x09: instrTableARM[i] = &aSingleDataTransfer<0, 1, 0, 0, 1, 1>; break;
-            case 0x0A: instrTableARM[i] = &aSingleDataTransfer<0, 1, 0, 1, 0, 1>; break;
-            case 0x0B: instrTableARM[i] = &aSingleDataTransfer<0, 1, 0, 1, 1, 1>; break;
-            case 0x0C: instrTableARM[i] = &aSingleDataTransfer<0, 1, 1, 0, 0, 1>; break;
-            case 0x0D: instrTableARM[i] = &aSingleDataTransfer<0, 1, 1, 0, 1, 1>; break;
-            case 0x0E: instrTableARM[i] = &aSingleDataTransfer<0, 1, 1, 1, 0, 1>; break;
-            case 0x0F: instrTableARM[i] = &aSingleDataTransfer<0, 1, 1, 1, 1, 1>; break;
-            case 0x10: instrTableARM[i] = &aSingleDataTransfer<1, 0, 0, 0, 0, 1>; break;
-            case 0x11: instrTableARM[i] = &aSingleDataTransfer<1, 0, 0, 0, 1, 1>; break;
-            case 0x12: instrTableARM[i] = &aSingleDataTransfer<1, 0, 0, 1, 0, 1>; break;
-            case 0x13: instrTableARM[i] = &aSingleDataTransfer<1, 0, 0, 1, 1, 1>; break;
-            case 0x14: instrTableARM[i] = &aSingleDataTransfer<1, 0, 1, 0, 0, 1>; break;
-            case 0x15: instrTableARM[i] = &aSingleDataTransfer<1, 0, 1, 0, 1, 1>; break;
-            case 0x16: instrTableARM[i] = &aSingleDataTransfer<1, 0, 1, 1, 0, 1>; break;
-            case 0x17: instrTableARM[i] = &aSingleDataTransfer<1, 0, 1, 1, 1, 1>; break;
-            case 0x18: instrTableARM[i] = &aSingleDataTransfer<1, 1, 0, 0, 0, 1>; break;
-            case 0x19: instrTableARM[i] = &aSingleDataTransfer<1, 1, 0, 0, 1, 1>; break;
-            case 0x1A: instrTableARM[i] = &aSingleDataTransfer<1, 1, 0, 1, 0, 1>; break;
-            case 0x1B: instrTableARM[i] = &aSingleDataTransfer<1, 1, 0, 1, 1, 1>; break;
-            case 0x1C: instrTableARM[i] = &aSingleDataTransfer<1, 1, 1, 0, 0, 1>; break;
-            case 0x1D: instrTableARM[i] = &aSingleDataTransfer<1, 1, 1, 0, 1, 1>; break;
-            case 0x1E: instrTableARM[i] = &aSingleDataTransfer<1, 1, 1, 1, 0, 1>; break;
-            case 0x1F: instrTableARM[i] = &aSingleDataTransfer<1, 1, 1, 1, 1, 1>; break;
+            case 0x00: setARM<&aSingleDataTransfer<0, 0, 0, 0, 0, 1>>(i); break;
+            case 0x01: setARM<&aSingleDataTransfer<0, 0, 0, 0, 1, 1>>(i); break;
+            case 0x02: setARM<&aSingleDataTransfer<0, 0, 0, 1, 0, 1>>(i); break;
+            case 0x03: setARM<&aSingleDataTransfer<0, 0, 0, 1, 1, 1>>(i); break;
+            case 0x04: setARM<&aSingleDataTransfer<0, 0, 1, 0, 0, 1>>(i); break;
+            case 0x05: setARM<&aSingleDataTransfer<0, 0, 1, 0, 1, 1>>(i); break;
+            case 0x06: setARM<&aSingleDataTransfer<0, 0, 1, 1, 0, 1>>(i); break;
+            case 0x07: setARM<&aSingleDataTransfer<0, 0, 1, 1, 1, 1>>(i); break;
+            case 0x08: setARM<&aSingleDataTransfer<0, 1, 0, 0, 0, 1>>(i); break;
+            case 0x09: setARM<&aSingleDataTransfer<0, 1, 0, 0, 1, 1>>(i); break;
+            case 0x0A: setARM<&aSingleDataTransfer<0, 1, 0, 1, 0, 1>>(i); break;
+            case 0x0B: setARM<&aSingleDataTransfer<0, 1, 0, 1, 1, 1>>(i); break;
+            case 0x0C: setARM<&aSingleDataTransfer<0, 1, 1, 0, 0, 1>>(i); break;
+            case 0x0D: setARM<&aSingleDataTransfer<0, 1, 1, 0, 1, 1>>(i); break;
+            case 0x0E: setARM<&aSingleDataTransfer<0, 1, 1, 1, 0, 1>>(i); break;
+            case 0x0F: setARM<&aSingleDataTransfer<0, 1, 1, 1, 1, 1>>(i); break;
+            case 0x10: setARM<&aSingleDataTransfer<1, 0, 0, 0, 0, 1>>(i); break;
+            case 0x11: setARM<&aSingleDataTransfer<1, 0, 0, 0, 1, 1>>(i); break;
+            case 0x12: setARM<&aSingleDataTransfer<1, 0, 0, 1, 0, 1>>(i); break;
+            case 0x13: setARM<&aSingleDataTransfer<1, 0, 0, 1, 1, 1>>(i); break;
+            case 0x14: setARM<&aSingleDataTransfer<1, 0, 1, 0, 0, 1>>(i); break;
+            case 0x15: setARM<&aSingleDataTransfer<1, 0, 1, 0, 1, 1>>(i); break;
+            case 0x16: setARM<&aSingleDataTransfer<1, 0, 1, 1, 0, 1>>(i); break;
+            case 0x17: setARM<&aSingleDataTransfer<1, 0, 1, 1, 1, 1>>(i); break;
+            case 0x18: setARM<&aSingleDataTransfer<1, 1, 0, 0, 0, 1>>(i); break;
+            case 0x19: setARM<&aSingleDataTransfer<1, 1, 0, 0, 1, 1>>(i); break;
+            case 0x1A: setARM<&aSingleDataTransfer<1, 1, 0, 1, 0, 1>>(i); break;
+            case 0x1B: setARM<&aSingleDataTransfer<1, 1, 0, 1, 1, 1>>(i); break;
+            case 0x1C: setARM<&aSingleDataTransfer<1, 1, 1, 0, 0, 1>>(i); break;
+            case 0x1D: setARM<&aSingleDataTransfer<1, 1, 1, 0, 1, 1>>(i); break;
+            case 0x1E: setARM<&aSingleDataTransfer<1, 1, 1, 1, 0, 1>>(i); break;
+            case 0x1F: setARM<&aSingleDataTransfer<1, 1, 1, 1, 1, 1>>(i); break;
         }
 
         // Register SDT
         if (!(i & 1)) {
             switch ((i >> 4) & 0x1F) {
-                case 0x00: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 0, 0, 0, 0>; break;
-                case 0x01: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 0, 0, 1, 0>; break;
-                case 0x02: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 0, 1, 0, 0>; break;
-                case 0x03: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 0, 1, 1, 0>; break;
-                case 0x04: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 1, 0, 0, 0>; break;
-                case 0x05: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 1, 0, 1, 0>; break;
-                case 0x06: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 1, 1, 0, 0>; break;
-                case 0x07: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 0, 1, 1, 1, 0>; break;
-                case 0x08: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 0, 0, 0, 0>; break;
-                case 0x09: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 0, 0, 1, 0>; break;
-                case 0x0A: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 0, 1, 0, 0>; break;
-                case 0x0B: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 0, 1, 1, 0>; break;
-                case 0x0C: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 1, 0, 0, 0>; break;
-                case 0x0D: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 1, 0, 1, 0>; break;
-                case 0x0E: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 1, 1, 0, 0>; break;
-                case 0x0F: instrTableARM[i | 0x200] = &aSingleDataTransfer<0, 1, 1, 1, 1, 0>; break;
-                case 0x10: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 0, 0, 0, 0>; break;
-                case 0x11: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 0, 0, 1, 0>; break;
-                case 0x12: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 0, 1, 0, 0>; break;
-                case 0x13: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 0, 1, 1, 0>; break;
-                case 0x14: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 1, 0, 0, 0>; break;
-                case 0x15: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 1, 0, 1, 0>; break;
-                case 0x16: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 1, 1, 0, 0>; break;
-                case 0x17: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 0, 1, 1, 1, 0>; break;
-                case 0x18: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 0, 0, 0, 0>; break;
-                case 0x19: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 0, 0, 1, 0>; break;
-                case 0x1A: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 0, 1, 0, 0>; break;
-                case 0x1B: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 0, 1, 1, 0>; break;
-                case 0x1C: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 1, 0, 0, 0>; break;
-                case 0x1D: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 1, 0, 1, 0>; break;
-                case 0x1E: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 1, 1, 0, 0>; break;
-                case 0x1F: instrTableARM[i | 0x200] = &aSingleDataTransfer<1, 1, 1, 1, 1, 0>; break;
+                case 0x00: setARM<&aSingleDataTransfer<0, 0, 0, 0, 0, 0>>(i | 0x200); break;
+                case 0x01: setARM<&aSingleDataTransfer<0, 0, 0, 0, 1, 0>>(i | 0x200); break;
+                case 0x02: setARM<&aSingleDataTransfer<0, 0, 0, 1, 0, 0>>(i | 0x200); break;
+                case 0x03: setARM<&aSingleDataTransfer<0, 0, 0, 1, 1, 0>>(i | 0x200); break;
+                case 0x04: setARM<&aSingleDataTransfer<0, 0, 1, 0, 0, 0>>(i | 0x200); break;
+                case 0x05: setARM<&aSingleDataTransfer<0, 0, 1, 0, 1, 0>>(i | 0x200); break;
+                case 0x06: setARM<&aSingleDataTransfer<0, 0, 1, 1, 0, 0>>(i | 0x200); break;
+                case 0x07: setARM<&aSingleDataTransfer<0, 0, 1, 1, 1, 0>>(i | 0x200); break;
+                case 0x08: setARM<&aSingleDataTransfer<0, 1, 0, 0, 0, 0>>(i | 0x200); break;
+                case 0x09: setARM<&aSingleDataTransfer<0, 1, 0, 0, 1, 0>>(i | 0x200); break;
+                case 0x0A: setARM<&aSingleDataTransfer<0, 1, 0, 1, 0, 0>>(i | 0x200); break;
+                case 0x0B: setARM<&aSingleDataTransfer<0, 1, 0, 1, 1, 0>>(i | 0x200); break;
+                case 0x0C: setARM<&aSingleDataTransfer<0, 1, 1, 0, 0, 0>>(i | 0x200); break;
+                case 0x0D: setARM<&aSingleDataTransfer<0, 1, 1, 0, 1, 0>>(i | 0x200); break;
+                case 0x0E: setARM<&aSingleDataTransfer<0, 1, 1, 1, 0, 0>>(i | 0x200); break;
+                case 0x0F: setARM<&aSingleDataTransfer<0, 1, 1, 1, 1, 0>>(i | 0x200); break;
+                case 0x10: setARM<&aSingleDataTransfer<1, 0, 0, 0, 0, 0>>(i | 0x200); break;
+                case 0x11: setARM<&aSingleDataTransfer<1, 0, 0, 0, 1, 0>>(i | 0x200); break;
+                case 0x12: setARM<&aSingleDataTransfer<1, 0, 0, 1, 0, 0>>(i | 0x200); break;
+                case 0x13: setARM<&aSingleDataTransfer<1, 0, 0, 1, 1, 0>>(i | 0x200); break;
+                case 0x14: setARM<&aSingleDataTransfer<1, 0, 1, 0, 0, 0>>(i | 0x200); break;
+                case 0x15: setARM<&aSingleDataTransfer<1, 0, 1, 0, 1, 0>>(i | 0x200); break;
+                case 0x16: setARM<&aSingleDataTransfer<1, 0, 1, 1, 0, 0>>(i | 0x200); break;
+                case 0x17: setARM<&aSingleDataTransfer<1, 0, 1, 1, 1, 0>>(i | 0x200); break;
+                case 0x18: setARM<&aSingleDataTransfer<1, 1, 0, 0, 0, 0>>(i | 0x200); break;
+                case 0x19: setARM<&aSingleDataTransfer<1, 1, 0, 0, 1, 0>>(i | 0x200); break;
+                case 0x1A: setARM<&aSingleDataTransfer<1, 1, 0, 1, 0, 0>>(i | 0x200); break;
+                case 0x1B: setARM<&aSingleDataTransfer<1, 1, 0, 1, 1, 0>>(i | 0x200); break;
+                case 0x1C: setARM<&aSingleDataTransfer<1, 1, 1, 0, 0, 0>>(i | 0x200); break;
+                case 0x1D: setARM<&aSingleDataTransfer<1, 1, 1, 0, 1, 0>>(i | 0x200); break;
+                case 0x1E: setARM<&aSingleDataTransfer<1, 1, 1, 1, 0, 0>>(i | 0x200); break;
+                case 0x1F: setARM<&aSingleDataTransfer<1, 1, 1, 1, 1, 0>>(i | 0x200); break;
             }
         }
     }
 
     for (int i = 0x800; i < 0x810; i++) {
-        instrTableARM[i | (0x00 << 4)] = &aLoadMultiple<0, 0, 0, 0, 0>;
-        instrTableARM[i | (0x01 << 4)] = &aLoadMultiple<0, 0, 0, 0, 1>;
-        instrTableARM[i | (0x02 << 4)] = &aLoadMultiple<0, 0, 0, 1, 0>;
-        instrTableARM[i | (0x03 << 4)] = &aLoadMultiple<0, 0, 0, 1, 1>;
-        instrTableARM[i | (0x04 << 4)] = &aLoadMultiple<0, 0, 1, 0, 0>;
-        instrTableARM[i | (0x05 << 4)] = &aLoadMultiple<0, 0, 1, 0, 1>;
-        instrTableARM[i | (0x06 << 4)] = &aLoadMultiple<0, 0, 1, 1, 0>;
-        instrTableARM[i | (0x07 << 4)] = &aLoadMultiple<0, 0, 1, 1, 1>;
-        instrTableARM[i | (0x08 << 4)] = &aLoadMultiple<0, 1, 0, 0, 0>;
-        instrTableARM[i | (0x09 << 4)] = &aLoadMultiple<0, 1, 0, 0, 1>;
-        instrTableARM[i | (0x0A << 4)] = &aLoadMultiple<0, 1, 0, 1, 0>;
-        instrTableARM[i | (0x0B << 4)] = &aLoadMultiple<0, 1, 0, 1, 1>;
-        instrTableARM[i | (0x0C << 4)] = &aLoadMultiple<0, 1, 1, 0, 0>;
-        instrTableARM[i | (0x0D << 4)] = &aLoadMultiple<0, 1, 1, 0, 1>;
-        instrTableARM[i | (0x0E << 4)] = &aLoadMultiple<0, 1, 1, 1, 0>;
-        instrTableARM[i | (0x0F << 4)] = &aLoadMultiple<0, 1, 1, 1, 1>;
-        instrTableARM[i | (0x10 << 4)] = &aLoadMultiple<1, 0, 0, 0, 0>;
-        instrTableARM[i | (0x11 << 4)] = &aLoadMultiple<1, 0, 0, 0, 1>;
-        instrTableARM[i | (0x12 << 4)] = &aLoadMultiple<1, 0, 0, 1, 0>;
-        instrTableARM[i | (0x13 << 4)] = &aLoadMultiple<1, 0, 0, 1, 1>;
-        instrTableARM[i | (0x14 << 4)] = &aLoadMultiple<1, 0, 1, 0, 0>;
-        instrTableARM[i | (0x15 << 4)] = &aLoadMultiple<1, 0, 1, 0, 1>;
-        instrTableARM[i | (0x16 << 4)] = &aLoadMultiple<1, 0, 1, 1, 0>;
-        instrTableARM[i | (0x17 << 4)] = &aLoadMultiple<1, 0, 1, 1, 1>;
-        instrTableARM[i | (0x18 << 4)] = &aLoadMultiple<1, 1, 0, 0, 0>;
-        instrTableARM[i | (0x19 << 4)] = &aLoadMultiple<1, 1, 0, 0, 1>;
-        instrTableARM[i | (0x1A << 4)] = &aLoadMultiple<1, 1, 0, 1, 0>;
-        instrTableARM[i | (0x1B << 4)] = &aLoadMultiple<1, 1, 0, 1, 1>;
-        instrTableARM[i | (0x1C << 4)] = &aLoadMultiple<1, 1, 1, 0, 0>;
-        instrTableARM[i | (0x1D << 4)] = &aLoadMultiple<1, 1, 1, 0, 1>;
-        instrTableARM[i | (0x1E << 4)] = &aLoadMultiple<1, 1, 1, 1, 0>;
-        instrTableARM[i | (0x1F << 4)] = &aLoadMultiple<1, 1, 1, 1, 1>;
+        setARM<&aLoadMultiple<0, 0, 0, 0, 0>>(i | (0x00 << 4));
+        setARM<&aLoadMultiple<0, 0, 0, 0, 1>>(i | (0x01 << 4));
+        setARM<&aLoadMultiple<0, 0, 0, 1, 0>>(i | (0x02 << 4));
+        setARM<&aLoadMultiple<0, 0, 0, 1, 1>>(i | (0x03 << 4));
+        setARM<&aLoadMultiple<0, 0, 1, 0, 0>>(i | (0x04 << 4));
+        setARM<&aLoadMultiple<0, 0, 1, 0, 1>>(i | (0x05 << 4));
+        setARM<&aLoadMultiple<0, 0, 1, 1, 0>>(i | (0x06 << 4));
+        setARM<&aLoadMultiple<0, 0, 1, 1, 1>>(i | (0x07 << 4));
+        setARM<&aLoadMultiple<0, 1, 0, 0, 0>>(i | (0x08 << 4));
+        setARM<&aLoadMultiple<0, 1, 0, 0, 1>>(i | (0x09 << 4));
+        setARM<&aLoadMultiple<0, 1, 0, 1, 0>>(i | (0x0A << 4));
+        setARM<&aLoadMultiple<0, 1, 0, 1, 1>>(i | (0x0B << 4));
+        setARM<&aLoadMultiple<0, 1, 1, 0, 0>>(i | (0x0C << 4));
+        setARM<&aLoadMultiple<0, 1, 1, 0, 1>>(i | (0x0D << 4));
+        setARM<&aLoadMultiple<0, 1, 1, 1, 0>>(i | (0x0E << 4));
+        setARM<&aLoadMultiple<0, 1, 1, 1, 1>>(i | (0x0F << 4));
+        setARM<&aLoadMultiple<1, 0, 0, 0, 0>>(i | (0x10 << 4));
+        setARM<&aLoadMultiple<1, 0, 0, 0, 1>>(i | (0x11 << 4));
+        setARM<&aLoadMultiple<1, 0, 0, 1, 0>>(i | (0x12 << 4));
+        setARM<&aLoadMultiple<1, 0, 0, 1, 1>>(i | (0x13 << 4));
+        setARM<&aLoadMultiple<1, 0, 1, 0, 0>>(i | (0x14 << 4));
+        setARM<&aLoadMultiple<1, 0, 1, 0, 1>>(i | (0x15 << 4));
+        setARM<&aLoadMultiple<1, 0, 1, 1, 0>>(i | (0x16 << 4));
+        setARM<&aLoadMultiple<1, 0, 1, 1, 1>>(i | (0x17 << 4));
+        setARM<&aLoadMultiple<1, 1, 0, 0, 0>>(i | (0x18 << 4));
+        setARM<&aLoadMultiple<1, 1, 0, 0, 1>>(i | (0x19 << 4));
+        setARM<&aLoadMultiple<1, 1, 0, 1, 0>>(i | (0x1A << 4));
+        setARM<&aLoadMultiple<1, 1, 0, 1, 1>>(i | (0x1B << 4));
+        setARM<&aLoadMultiple<1, 1, 1, 0, 0>>(i | (0x1C << 4));
+        setARM<&aLoadMultiple<1, 1, 1, 0, 1>>(i | (0x1D << 4));
+        setARM<&aLoadMultiple<1, 1, 1, 1, 0>>(i | (0x1E << 4));
+        setARM<&aLoadMultiple<1, 1, 1, 1, 1>>(i | (0x1F << 4));
     }
 
     for (int i = 0xA00; i < 0xB00; i++) {
-        instrTableARM[i | 0x000] = &aBranch<0>;
-        instrTableARM[i | 0x100] = &aBranch<1>;
+        setARM<&aBranch<0>>(i | 0x000);
+        setARM<&aBranch<1>>(i | 0x100);
     }
 
     for (int i = 0xF00; i <= 0xFFF; i++) {
-        instrTableARM[i] = &aSWI;
+        setARM<&aSWI>(i);
     }
 
     for (int i = 0xE00; i < 0xF00; i++) {
         if (i & 1) {
             if (i & (1 << 4)) {
-                instrTableARM[i] = &aCoprocessorRegisterTransfer<1>;
+                setARM<&aCoprocessorRegisterTransfer<1>>(i);
             } else {
-                instrTableARM[i] = &aCoprocessorRegisterTransfer<0>;
+                setARM<&aCoprocessorRegisterTransfer<0>>(i);
             }
         }
     }
@@ -2289,145 +2870,156 @@ void init() {
     // THUMB
     for (int i = 0x000; i < 0x080; i++) {
         switch ((i >> 5) & 3) {
-            case 0: instrTableTHUMB[i] = &tShift<ShiftType::LSL>; break;
-            case 1: instrTableTHUMB[i] = &tShift<ShiftType::LSR>; break;
-            case 2: instrTableTHUMB[i] = &tShift<ShiftType::ASR>; break;
+            case 0: setTHUMB<&tShift<ShiftType::LSL>>(i); break;
+            case 1: setTHUMB<&tShift<ShiftType::LSR>>(i); break;
+            case 2: setTHUMB<&tShift<ShiftType::ASR>>(i); break;
             case 3:
                 switch ((i >> 3) & 3) {
-                    case 0: instrTableTHUMB[i] = &tAddShort<0, 0>; break;
-                    case 1: instrTableTHUMB[i] = &tAddShort<1, 0>; break;
-                    case 2: instrTableTHUMB[i] = &tAddShort<0, 1>; break;
-                    case 3: instrTableTHUMB[i] = &tAddShort<1, 1>; break;
+                    case 0: setTHUMB<&tAddShort<0, 0>>(i); break;
+                    case 1: setTHUMB<&tAddShort<1, 0>>(i); break;
+                    case 2: setTHUMB<&tAddShort<0, 1>>(i); break;
+                    case 3: setTHUMB<&tAddShort<1, 1>>(i); break;
                 }
                 break;
         }
     }
 
     for (int i = 0x080; i < 0x0A0; i++) {
-        instrTableTHUMB[i | (0 << 5)] = &tDataProcessingLarge<DPOpcode::MOV>;
-        instrTableTHUMB[i | (1 << 5)] = &tDataProcessingLarge<DPOpcode::CMP>;
-        instrTableTHUMB[i | (2 << 5)] = &tDataProcessingLarge<DPOpcode::ADD>;
-        instrTableTHUMB[i | (3 << 5)] = &tDataProcessingLarge<DPOpcode::SUB>;
-    }
-
-    instrTableTHUMB[0x100] = &tDataProcessing<THUMBDPOpcode::AND>;
-    instrTableTHUMB[0x101] = &tDataProcessing<THUMBDPOpcode::EOR>;
-    instrTableTHUMB[0x102] = &tDataProcessing<THUMBDPOpcode::LSL>;
-    instrTableTHUMB[0x103] = &tDataProcessing<THUMBDPOpcode::LSR>;
-    instrTableTHUMB[0x104] = &tDataProcessing<THUMBDPOpcode::ASR>;
-    instrTableTHUMB[0x105] = &tDataProcessing<THUMBDPOpcode::ADC>;
-    instrTableTHUMB[0x106] = &tDataProcessing<THUMBDPOpcode::SBC>;
-    instrTableTHUMB[0x107] = &tDataProcessing<THUMBDPOpcode::ROR>;
-    instrTableTHUMB[0x108] = &tDataProcessing<THUMBDPOpcode::TST>;
-    instrTableTHUMB[0x109] = &tDataProcessing<THUMBDPOpcode::NEG>;
-    instrTableTHUMB[0x10A] = &tDataProcessing<THUMBDPOpcode::CMP>;
-    instrTableTHUMB[0x10B] = &tDataProcessing<THUMBDPOpcode::CMN>;
-    instrTableTHUMB[0x10C] = &tDataProcessing<THUMBDPOpcode::ORR>;
-    instrTableTHUMB[0x10D] = &tDataProcessing<THUMBDPOpcode::MUL>;
-    instrTableTHUMB[0x10E] = &tDataProcessing<THUMBDPOpcode::BIC>;
-    instrTableTHUMB[0x10F] = &tDataProcessing<THUMBDPOpcode::MVN>;
+        setTHUMB<&tDataProcessingLarge<DPOpcode::MOV>>(i | (0 << 5));
+        setTHUMB<&tDataProcessingLarge<DPOpcode::CMP>>(i | (1 << 5));
+        setTHUMB<&tDataProcessingLarge<DPOpcode::ADD>>(i | (2 << 5));
+        setTHUMB<&tDataProcessingLarge<DPOpcode::SUB>>(i | (3 << 5));
+    }
+
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::AND>>(0x100);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::EOR>>(0x101);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::LSL>>(0x102);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::LSR>>(0x103);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::ASR>>(0x104);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::ADC>>(0x105);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::SBC>>(0x106);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::ROR>>(0x107);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::TST>>(0x108);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::NEG>>(0x109);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::CMP>>(0x10A);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::CMN>>(0x10B);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::ORR>>(0x10C);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::MUL>>(0x10D);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::BIC>>(0x10E);
+    setTHUMB<&tDataProcessing<THUMBDPOpcode::MVN>>(0x10F);
 
     for (int i = 0x110; i < 0x114; i++) {
-        instrTableTHUMB[i | (0 << 2)] = &tDataProcessingSpecial<DPOpcode::ADD>;
-        instrTableTHUMB[i | (1 << 2)] = &tDataProcessingSpecial<DPOpcode::CMP>;
-        instrTableTHUMB[i | (2 << 2)] = &tDataProcessingSpecial<DPOpcode::MOV>;
+        setTHUMB<&tDataProcessingSpecial<DPOpcode::ADD>>(i | (0 << 2));
+        setTHUMB<&tDataProcessingSpecial<DPOpcode::CMP>>(i | (1 << 2));
+        setTHUMB<&tDataProcessingSpecial<DPOpcode::MOV>>(i | (2 << 2));
     }
 
-    instrTableTHUMB[0x11C] = &tBranchExchange<0>;
-    instrTableTHUMB[0x11D] = &tBranchExchange<0>;
-    instrTableTHUMB[0x11E] = &tBranchExchange<1>;
-    instrTableTHUMB[0x11F] = &tBranchExchange<1>;
+    setTHUMB<&tBranchExchange<0>>(0x11C);
+    setTHUMB<&tBranchExchange<0>>(0x11D);
+    setTHUMB<&tBranchExchange<1>>(0x11E);
+    setTHUMB<&tBranchExchange<1>>(0x11F);
 
     for (int i = 0x120; i < 0x140; i++) {
-        instrTableTHUMB[i] = &tLoadFromPool;
+        setTHUMB<&tLoadFromPool>(i);
     }
 
     for (int i = 0x140; i < 0x180; i++) {
         switch ((i >> 3) & 7) {
-            case 0: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::STR  >; break;
-            case 1: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::STRH >; break;
-            case 2: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::STRB >; break;
-            case 3: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::LDRSB>; break;
-            case 4: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::LDR  >; break;
-            case 5: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::LDRH >; break;
-            case 6: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::LDRB >; break;
-            case 7: instrTableTHUMB[i] = &tLoadRegisterOffset<THUMBLoadOpcode::LDRSH>; break;
+            case 0: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::STR  >>(i); break;
+            case 1: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::STRH >>(i); break;
+            case 2: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::STRB >>(i); break;
+            case 3: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::LDRSB>>(i); break;
+            case 4: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::LDR  >>(i); break;
+            case 5: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::LDRH >>(i); break;
+            case 6: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::LDRB >>(i); break;
+            case 7: setTHUMB<&tLoadRegisterOffset<THUMBLoadOpcode::LDRSH>>(i); break;
         }
     }
 
     for (int i = 0x180; i < 0x1A0; i++) {
-        instrTableTHUMB[i | (0 << 5)] = &tLoadImmediateOffset<0, 0>;
-        instrTableTHUMB[i | (1 << 5)] = &tLoadImmediateOffset<0, 1>;
-        instrTableTHUMB[i | (2 << 5)] = &tLoadImmediateOffset<1, 0>;
-        instrTableTHUMB[i | (3 << 5)] = &tLoadImmediateOffset<1, 1>;
+        setTHUMB<&tLoadImmediateOffset<0, 0>>(i | (0 << 5));
+        setTHUMB<&tLoadImmediateOffset<0, 1>>(i | (1 << 5));
+        setTHUMB<&tLoadImmediateOffset<1, 0>>(i | (2 << 5));
+        setTHUMB<&tLoadImmediateOffset<1, 1>>(i | (3 << 5));
     }
 
     for (int i = 0x200; i < 0x240; i++) {
-        instrTableTHUMB[i] = (i & (1 << 5)) ? &tLoadHalfwordImmediateOffset<1> : &tLoadHalfwordImmediateOffset<0>;
+        (i & (1 << 5)) ? setTHUMB<&tLoadHalfwordImmediateOffset<1>>(i) : setTHUMB<&tLoadHalfwordImmediateOffset<0>>(i);
     }
 
     for (int i = 0x240; i < 0x260; i++) {
-        instrTableTHUMB[i | (0 << 5)] = &tLoadFromStack<0>;
-        instrTableTHUMB[i | (1 << 5)] = &tLoadFromStack<1>;
+        setTHUMB<&tLoadFromStack<0>>(i | (0 << 5));
+        setTHUMB<&tLoadFromStack<1>>(i | (1 << 5));
     }
 
     for (int i = 0x280; i < 0x2A0; i++) {
-        instrTableTHUMB[i | (0 << 5)] = &tGetAddress<0>;
-        instrTableTHUMB[i | (1 << 5)] = &tGetAddress<1>;
-    }
-
-    instrTableTHUMB[0x2C0] = &tAdjustSP<0>;
-    instrTableTHUMB[0x2C1] = &tAdjustSP<0>;
-    instrTableTHUMB[0x2C2] = &tAdjustSP<1>;
-    instrTableTHUMB[0x2C3] = &tAdjustSP<1>;
-
-    instrTableTHUMB[0x2D0] = &tPop<0, 0>;
-    instrTableTHUMB[0x2D1] = &tPop<0, 0>;
-    instrTableTHUMB[0x2D2] = &tPop<0, 0>;
-    instrTableTHUMB[0x2D3] = &tPop<0, 0>;
-    instrTableTHUMB[0x2D4] = &tPop<0, 1>;
-    instrTableTHUMB[0x2D5] = &tPop<0, 1>;
-    instrTableTHUMB[0x2D6] = &tPop<0, 1>;
-    instrTableTHUMB[0x2D7] = &tPop<0, 1>;
-    instrTableTHUMB[0x2F0] = &tPop<1, 0>;
-    instrTableTHUMB[0x2F1] = &tPop<1, 0>;
-    instrTableTHUMB[0x2F2] = &tPop<1, 0>;
-    instrTableTHUMB[0x2F3] = &tPop<1, 0>;
-    instrTableTHUMB[0x2F4] = &tPop<1, 1>;
-    instrTableTHUMB[0x2F5] = &tPop<1, 1>;
-    instrTableTHUMB[0x2F6] = &tPop<1, 1>;
-    instrTableTHUMB[0x2F7] = &tPop<1, 1>;
+        setTHUMB<&tGetAddress<0>>(i | (0 << 5));
+        setTHUMB<&tGetAddress<1>>(i | (1 << 5));
+    }
+
+    setTHUMB<&tAdjustSP<0>>(0x2C0);
+    setTHUMB<&tAdjustSP<0>>(0x2C1);
+    setTHUMB<&tAdjustSP<1>>(0x2C2);
+    setTHUMB<&tAdjustSP<1>>(0x2C3);
+
+    setTHUMB<&tPop<0, 0>>(0x2D0);
+    setTHUMB<&tPop<0, 0>>(0x2D1);
+    setTHUMB<&tPop<0, 0>>(0x2D2);
+    setTHUMB<&tPop<0, 0>>(0x2D3);
+    setTHUMB<&tPop<0, 1>>(0x2D4);
+    setTHUMB<&tPop<0, 1>>(0x2D5);
+    setTHUMB<&tPop<0, 1>>(0x2D6);
+    setTHUMB<&tPop<0, 1>>(0x2D7);
+    setTHUMB<&tPop<1, 0>>(0x2F0);
+    setTHUMB<&tPop<1, 0>>(0x2F1);
+    setTHUMB<&tPop<1, 0>>(0x2F2);
+    setTHUMB<&tPop<1, 0>>(0x2F3);
+    setTHUMB<&tPop<1, 1>>(0x2F4);
+    setTHUMB<&tPop<1, 1>>(0x2F5);
+    setTHUMB<&tPop<1, 1>>(0x2F6);
+    setTHUMB<&tPop<1, 1>>(0x2F7);
 
     for (int i = 0x300; i < 0x320; i++) {
-        instrTableTHUMB[i | (0 << 5)] = &tLoadMultiple<0>;
-        instrTableTHUMB[i | (1 << 5)] = &tLoadMultiple<1>;
+        setTHUMB<&tLoadMultiple<0>>(i | (0 << 5));
+        setTHUMB<&tLoadMultiple<1>>(i | (1 << 5));
     }
 
     for (int i = 0x340; i < 0x380; i++) {
         if ((i >> 2) == 0xDF) {
-            instrTableTHUMB[i] = &tSWI;
+            setTHUMB<&tSWI>(i);
         } else if (((i >> 2) != 0xDE) && ((i >> 2) != 0xDF)) {
-            instrTableTHUMB[i] = &tConditionalBranch;
+            setTHUMB<&tConditionalBranch>(i);
         }
     }
 
     for (int i = 0x380; i < 0x400; i++) {
         switch ((i >> 5) & 3) {
-            case 0: instrTableTHUMB[i] = &tBranch; break;
-            case 1: instrTableTHUMB[i] = &tBranchLink<1>; break;
-            case 2: instrTableTHUMB[i] = &tBranchLink<2>; break;
-            case 3: instrTableTHUMB[i] = &tBranchLink<3>; break;
+            case 0: setTHUMB<&tBranch>(i); break;
+            case 1: setTHUMB<&tBranchLink<1>>(i); break;
+            case 2: setTHUMB<&tBranchLink<2>>(i); break;
+            case 3: setTHUMB<&tBranchLink<3>>(i); break;
         }
     }
 }
 
 void run(CPU *cpu, i64 runCycles) {
-    for (auto c = runCycles; c > 0; c--) {
+    for (auto c = runCycles; c > 0;) {
         if (cpu->isHalted) return;
 
         //if (cpu->r[CPUReg::PC] == 0x020C42BC) doDisasm = true;
 
-        (cpu->cpsr.t) ? decodeTHUMB(cpu) : decodeARM(cpu);
+        if (const auto block = getBlock(cpu); block != NULL) {
+            const auto pc = cpu->r[CPUReg::PC];
+
+            c -= runBlock(cpu, *block, c);
+
+            // Skip to the end of the time slice
+            if (isIdle(cpu, *block, pc)) c = 0;
+        } else {
+            step(cpu);
+
+            c--;
+        }
 
         assert(cpu->r[CPUReg::PC]);
     }
@@ -6,13 +6,65 @@
 #pragma once
 
 #include <cstdio>
+#include <vector>
 
 #include "cpu.hpp"
 
 namespace nds::cpu::interpreter {
 
+/* Condition codes */
+enum Condition {
+    EQ, NE, HS, LO, MI, PL, VS, VC,
+    HI, LS, GE, LT, GT, LE, AL, NV,
+};
+
+/* Decoded block instruction */
+struct BlockInstr {
+    union {
+        void (*handlerARM  )(CPU *, u32);
+        void (*handlerTHUMB)(CPU *, u16);
+    };
+
+    u32 instr;
+
+    Condition cond;
+
+    // Threaded dispatch handler, runs this instruction and tail calls the next one
+    i64 (*threaded)(CPU *cpu, const BlockInstr *i, i64 cycles);
+};
+
+/* Straight-line run of decoded instructions */
+struct Block {
+    std::vector<BlockInstr> instrs;
+
+    u32 gen; // Cache generation the block was decoded in
+
+    u32 page[2], version[2]; // First and last host code page
+
+    // Idle loop detection, idleBase + idleOffset is the polled address (idleBase = 16 if there is none)
+    bool isIdleLoop;
+
+    u32 idleBase, idleOffset;
+
+    // Recompiled block (see cpujit.cpp), NULL if not compiled
+    i64 (*code)(CPU *, i64);
+
+    u32 codeGen, runCount;
+};
+
+extern bool isBlockInvalid;
+
 void init();
 
 void run(CPU *cpu, i64 runCycles);
+void step(CPU *cpu);
+
+Block *getBlock(CPU *cpu);
+i64 runBlock(CPU *cpu, const Block &block, i64 runCycles);
+bool isIdle(CPU *cpu, const Block &block, u32 pc);
+
+void invalidateBlocks(const u8 *codePtr);
+void invalidateRange(const u8 *mem, u32 size);
+void flushBlocks();
 
 }
\ No newline at end of file
@@ -0,0 +1,813 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#include "cpujit.hpp"
+
+#include <bit>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "cpuint.hpp"
+#include "../../common/log.hpp"
+
+namespace nds::cpu::jit {
+
+using interpreter::Block;
+using interpreter::BlockInstr;
+using interpreter::Condition;
+using Log = logger::Logger<logger::Category::JIT>;
+
+// JIT constants
+
+constexpr u64 CODE_BUFFER_SIZE  = 16 << 20;
+constexpr u64 MAX_BLOCK_CODE    = 8 << 10; // Upper bound for one compiled block
+constexpr u32 COMPILE_THRESHOLD = 8;       // Number of interpreted runs before a block gets compiled
+
+/* ARM Data Processing opcodes */
+enum class DPOpcode {
+    AND, EOR, SUB, RSB, ADD, ADC, SBC, RSC,
+    TST, TEQ, CMP, CMN, ORR, MOV, BIC, MVN,
+};
+
+/* THUMB Data Processing opcodes */
+enum class THUMBDPOpcode {
+    AND, EOR, LSL, LSR, ASR, ADC, SBC, ROR,
+    TST, NEG, CMP, CMN, ORR, MUL, BIC, MVN,
+};
+
+u8 *codeBuffer = NULL, *codePtr;
+
+bool isAvailable = true; // Cleared if the code buffer can't be mapped, run() falls back to the interpreter
+
+u32 codeGen = 0; // Incremented every time the code buffer is flushed
+
+#if defined(__x86_64__)
+
+// x86-64 emitter
+
+/* Host registers, RBX holds the CPU pointer, R12 the cycle budget and R13 the executed instruction count */
+enum X86Reg {
+    EAX, ECX,
+};
+
+/* Host condition codes */
+enum class X86Cond {
+    O  = 0x0, NO = 0x1, C = 0x2, NC = 0x3,
+    Z  = 0x4, NZ = 0x5, S = 0x8,
+};
+
+/* Host ALU opcodes (r/m32, r32 form) */
+enum class X86ALU {
+    ADD = 0x01, OR = 0x09, AND = 0x21, SUB = 0x29, XOR = 0x31, CMP = 0x39, TEST = 0x85,
+};
+
+/* Host shift opcode extensions */
+enum class X86Shift {
+    ROR = 1, SHL = 4, SHR = 5, SAR = 7,
+};
+
+/* Offsets of guest state relative to the CPU pointer */
+struct Offsets {
+    i32 r, cpc, n, z, c, v, t, flagOp, isHalted;
+} off;
+
+std::vector<u8 *> exitJumps;
+
+/* Makes code buffer pages in [mem;mem+size) either writable or executable, never both */
+bool protect(u8 *mem, u64 size, bool isWritable) {
+    const u64 pageSize = sysconf(_SC_PAGESIZE);
+
+    const auto start = (u8 *)((u64)mem & ~(pageSize - 1));
+    const auto end   = (u8 *)(((u64)mem + size + pageSize - 1) & ~(pageSize - 1));
+
+    return !mprotect(start, end - start, PROT_READ | ((isWritable) ? PROT_WRITE : PROT_EXEC));
+}
+
+/* Disables the JIT after a protection change failed */
+void disable() {
+    Log::warn("[JIT       ] Unable to change code buffer protection, falling back to the interpreter\n");
+
+    isAvailable = false;
+}
+
+void emit8(u8 data) {
+    *codePtr++ = data;
+}
+
+void emit32(u32 data) {
+    std::memcpy(codePtr, &data, 4);
+
+    codePtr += 4;
+}
+
+void emit64(u64 data) {
+    std::memcpy(codePtr, &data, 8);
+
+    codePtr += 8;
+}
+
+/* Emits a ModRM byte for [RBX + disp32] */
+void emitMem(int reg, i32 disp) {
+    emit8(0x83 | (reg << 3));
+    emit32(disp);
+}
+
+i32 getRegOffset(u32 idx) {
+    return off.r + 4 * idx;
+}
+
+/* MOV reg, [guest register] */
+void loadReg(X86Reg reg, u32 idx) {
+    emit8(0x8B); emitMem(reg, getRegOffset(idx));
+}
+
+/* MOV [guest register], reg */
+void storeReg(u32 idx, X86Reg reg) {
+    emit8(0x89); emitMem(reg, getRegOffset(idx));
+}
+
+/* MOV reg, imm32 */
+void loadImm(X86Reg reg, u32 imm) {
+    emit8(0xB8 + reg); emit32(imm);
+}
+
+/* MOV DWORD [RBX + disp], imm32 */
+void storeImm32(i32 disp, u32 imm) {
+    emit8(0xC7); emitMem(0, disp); emit32(imm);
+}
+
+/* MOV BYTE [RBX + disp], imm8 */
+void storeImm8(i32 disp, u8 imm) {
+    emit8(0xC6); emitMem(0, disp); emit8(imm);
+}
+
+/* CMP DWORD [RBX + disp], imm32 */
+void cmpImm32(i32 disp, u32 imm) {
+    emit8(0x81); emitMem(7, disp); emit32(imm);
+}
+
+/* CMP BYTE [RBX + disp], imm8 */
+void cmpImm8(i32 disp, u8 imm) {
+    emit8(0x80); emitMem(7, disp); emit8(imm);
+}
+
+/* MOV AL/CL, BYTE [RBX + disp] */
+void loadFlag(X86Reg reg, i32 disp) {
+    emit8(0x8A); emitMem(reg, disp);
+}
+
+/* SETcc BYTE [RBX + disp] */
+void setFlag(X86Cond cond, i32 disp) {
+    emit8(0x0F); emit8(0x90 | (u8)cond); emitMem(0, disp);
+}
+
+/* op dst, src */
+void alu(X86ALU op, X86Reg dst, X86Reg src) {
+    emit8((u8)op); emit8(0xC0 | (src << 3) | dst);
+}
+
+/* op dst, imm8 */
+void shiftImm(X86Shift op, X86Reg dst, u8 amt) {
+    emit8(0xC1); emit8(0xC0 | ((u8)op << 3) | dst); emit8(amt);
+}
+
+/* MOV RAX, imm64 */
+void loadPointer(const void *ptr) {
+    emit8(0x48); emit8(0xB8); emit64((u64)ptr);
+}
+
+/* Jcc rel32, returns the location of the displacement */
+u8 *jumpIf(X86Cond cond) {
+    emit8(0x0F); emit8(0x80 | (u8)cond); emit32(0);
+
+    return codePtr - 4;
+}
+
+void patchJump(u8 *disp, const u8 *target) {
+    const i32 rel = target - (disp + 4);
+
+    std::memcpy(disp, &rel, 4);
+}
+
+/* Sets N and Z from the host flags */
+void setNZ() {
+    setFlag(X86Cond::S, off.n);
+    setFlag(X86Cond::Z, off.z);
+}
+
+/* Sets NZCV from the host flags after ADD */
+void setAddFlags() {
+    setNZ();
+    setFlag(X86Cond::C, off.c);
+    setFlag(X86Cond::O, off.v);
+}
+
+/* Sets NZCV from the host flags after SUB (ARM carry is an inverted borrow) */
+void setSubFlags() {
+    setNZ();
+    setFlag(X86Cond::NC, off.c);
+    setFlag(X86Cond::O , off.v);
+}
+
+/* Emits an ARM condition check, returns the jump taken if the condition fails (or NULL) */
+u8 *emitCondition(Condition cond) {
+    switch (cond) {
+        case Condition::EQ: cmpImm8(off.z, 0); return jumpIf(X86Cond::Z);
+        case Condition::NE: cmpImm8(off.z, 0); return jumpIf(X86Cond::NZ);
+        case Condition::HS: cmpImm8(off.c, 0); return jumpIf(X86Cond::Z);
+        case Condition::LO: cmpImm8(off.c, 0); return jumpIf(X86Cond::NZ);
+        case Condition::MI: cmpImm8(off.n, 0); return jumpIf(X86Cond::Z);
+        case Condition::PL: cmpImm8(off.n, 0); return jumpIf(X86Cond::NZ);
+        case Condition::VS: cmpImm8(off.v, 0); return jumpIf(X86Cond::Z);
+        case Condition::VC: cmpImm8(off.v, 0); return jumpIf(X86Cond::NZ);
+        case Condition::HI:
+        case Condition::LS:
+            // AL = C & !Z
+            loadFlag(EAX, off.c);
+            loadFlag(ECX, off.z);
+
+            emit8(0x80); emit8(0xF1); emit8(0x01); // XOR CL, 1
+            emit8(0x20); emit8(0xC8);              // AND AL, CL
+
+            return jumpIf((cond == Condition::HI) ? X86Cond::Z : X86Cond::NZ);
+        case Condition::GE:
+        case Condition::LT:
+            loadFlag(EAX, off.n);
+
+            emit8(0x3A); emitMem(EAX, off.v); // CMP AL, [V]
+
+            return jumpIf((cond == Condition::GE) ? X86Cond::NZ : X86Cond::Z);
+        case Condition::GT:
+        case Condition::LE:
+            // AL = (N ^ V) | Z
+            loadFlag(EAX, off.n);
+
+            emit8(0x32); emitMem(EAX, off.v); // XOR AL, [V]
+            emit8(0x0A); emitMem(EAX, off.z); // OR  AL, [Z]
+
+            return jumpIf((cond == Condition::GT) ? X86Cond::NZ : X86Cond::Z);
+        default:
+            return NULL;
+    }
+}
+
+/* Emits ARM Data Processing instructions natively. Returns false if the instruction needs the interpreter */
+bool compileDataProcessingARM(u32 instr) {
+    if (((instr >> 28) == Condition::NV) || (instr & (3 << 26))) return false;
+
+    const bool isImm = instr & (1 << 25);
+    const bool isS   = instr & (1 << 20);
+
+    // Register-specified shifts, multiplies and extra loadstores
+    if (!isImm && (instr & (1 << 4))) return false;
+
+    const auto rd = (instr >> 12) & 0xF;
+    const auto rn = (instr >> 16) & 0xF;
+    const auto rm = (instr >>  0) & 0xF;
+
+    const auto opcode = (DPOpcode)((instr >> 21) & 0xF);
+
+    bool isArithmetic = false, isCompare = false;
+
+    switch (opcode) {
+        case DPOpcode::ADC: case DPOpcode::SBC: case DPOpcode::RSC:
+            return false;
+        case DPOpcode::SUB: case DPOpcode::RSB: case DPOpcode::ADD:
+            isArithmetic = true;
+            break;
+        case DPOpcode::CMP: case DPOpcode::CMN:
+            isArithmetic = true;
+            [[fallthrough]];
+        case DPOpcode::TST: case DPOpcode::TEQ:
+            if (!isS) return false; // PSR transfers, BX etc.
+
+            isCompare = true;
+            break;
+        default:
+            break;
+    }
+
+    const auto hasOp1 = (opcode != DPOpcode::MOV) && (opcode != DPOpcode::MVN);
+
+    if ((rd == CPUReg::PC) || (hasOp1 && (rn == CPUReg::PC))) return false;
+
+    // Decode op2 into ECX, a rotated immediate sets a constant carry out (1 = set, -1 = clear)
+    int carryOut = 0;
+
+    if (isImm) {
+        const auto amt = 2 * ((instr >> 8) & 0xF);
+        const auto imm = instr & 0xFF;
+
+        if (amt) {
+            carryOut = (imm & (1 << (amt - 1))) ? 1 : -1;
+
+            loadImm(ECX, std::rotr((u32)imm, amt));
+        } else {
+            loadImm(ECX, imm);
+        }
+    } else {
+        if (rm == CPUReg::PC) return false;
+
+        const auto amt   = (instr >> 7) & 0x1F;
+        const auto stype = (instr >> 5) & 3;
+
+        // LSR #32, ASR #32 and RRX
+        if ((stype != 0) && !amt) return false;
+
+        // Logical ops would need the shifter carry out
+        if (amt && isS && !isArithmetic) return false;
+
+        loadReg(ECX, rm);
+
+        if (amt) {
+            constexpr X86Shift shiftOps[] = {X86Shift::SHL, X86Shift::SHR, X86Shift::SAR, X86Shift::ROR};
+
+            shiftImm(shiftOps[stype], ECX, amt);
+        }
+    }
+
+    if (hasOp1) loadReg(EAX, rn);
+
+    auto res = EAX;
+
+    switch (opcode) {
+        case DPOpcode::AND: case DPOpcode::TST: alu(X86ALU::AND, EAX, ECX); break;
+        case DPOpcode::EOR: case DPOpcode::TEQ: alu(X86ALU::XOR, EAX, ECX); break;
+        case DPOpcode::SUB: case DPOpcode::CMP: alu(X86ALU::SUB, EAX, ECX); break;
+        case DPOpcode::ADD: case DPOpcode::CMN: alu(X86ALU::ADD, EAX, ECX); break;
+        case DPOpcode::ORR: alu(X86ALU::OR , EAX, ECX); break;
+        case DPOpcode::RSB:
+            alu(X86ALU::SUB, ECX, EAX);
+
+            res = ECX;
+            break;
+        case DPOpcode::MOV:
+            if (isS) alu(X86ALU::TEST, ECX, ECX);
+
+            res = ECX;
+            break;
+        case DPOpcode::BIC:
+            emit8(0xF7); emit8(0xD1); // NOT ECX
+
+            alu(X86ALU::AND, EAX, ECX);
+            break;
+        case DPOpcode::MVN:
+            emit8(0xF7); emit8(0xD1); // NOT ECX
+
+            if (isS) alu(X86ALU::TEST, ECX, ECX);
+
+            res = ECX;
+            break;
+        default:
+            assert(false);
+    }
+
+    if (isS) {
+        if (opcode == DPOpcode::ADD || opcode == DPOpcode::CMN) {
+            setAddFlags();
+        } else if (isArithmetic) {
+            setSubFlags();
+        } else {
+            setNZ();
+
+            if (carryOut) storeImm8(off.c, carryOut > 0);
+        }
+    }
+
+    if (!isCompare) storeReg(rd, res);
+
+    return true;
+}
+
+/* Emits THUMB ALU instructions natively. Returns false if the instruction needs the interpreter */
+bool compileDataProcessingTHUMB(u16 instr) {
+    if ((instr >> 13) == 0) {
+        if (((instr >> 11) & 3) == 3) {
+            // ADD/SUB short/register
+            const auto rd = (instr >> 0) & 7;
+            const auto rn = (instr >> 3) & 7;
+            const auto rm = (instr >> 6) & 7;
+
+            const bool isSub = instr & (1 << 9);
+
+            if (instr & (1 << 10)) {
+                loadImm(ECX, rm);
+            } else {
+                loadReg(ECX, rm);
+            }
+
+            loadReg(EAX, rn);
+
+            alu((isSub) ? X86ALU::SUB : X86ALU::ADD, EAX, ECX);
+
+            (isSub) ? setSubFlags() : setAddFlags();
+
+            storeReg(rd, EAX);
+
+            return true;
+        }
+
+        // Shift by immediate
+        const auto rd = (instr >> 0) & 7;
+        const auto rm = (instr >> 3) & 7;
+
+        const auto amt   = (instr >> 6) & 0x1F;
+        const auto stype = (instr >> 11) & 3;
+
+        if ((stype != 0) && !amt) return false; // LSR #32, ASR #32
+
+        loadReg(EAX, rm);
+
+        if (amt) {
+            shiftImm((stype == 0) ? X86Shift::SHL : (stype == 1) ? X86Shift::SHR : X86Shift::SAR, EAX, amt);
+
+            setFlag(X86Cond::C, off.c);
+        } else {
+            alu(X86ALU::TEST, EAX, EAX);
+        }
+
+        setNZ();
+
+        storeReg(rd, EAX);
+
+        return true;
+    }
+
+    if ((instr >> 13) == 1) {
+        // MOV/CMP/ADD/SUB imm8
+        const auto rd = (instr >> 8) & 7;
+
+        const u32 imm = instr & 0xFF;
+
+        switch ((instr >> 11) & 3) {
+            case 0: // MOV
+                storeImm32(getRegOffset(rd), imm);
+                storeImm8(off.n, 0);
+                storeImm8(off.z, !imm);
+                break;
+            case 1: // CMP
+                cmpImm32(getRegOffset(rd), imm);
+                setSubFlags();
+                break;
+            case 2: // ADD
+            case 3: // SUB
+                {
+                    const bool isSub = instr & (1 << 11);
+
+                    loadReg(EAX, rd);
+
+                    emit8((isSub) ? 0x2D : 0x05); emit32(imm); // ADD/SUB EAX, imm32
+
+                    (isSub) ? setSubFlags() : setAddFlags();
+
+                    storeReg(rd, EAX);
+                }
+                break;
+        }
+
+        return true;
+    }
+
+    if ((instr >> 10) == 0x10) {
+        // ALU operations
+        const auto rd = (instr >> 0) & 7;
+        const auto rm = (instr >> 3) & 7;
+
+        const auto opcode = (THUMBDPOpcode)((instr >> 6) & 0xF);
+
+        switch (opcode) {
+            case THUMBDPOpcode::LSL: case THUMBDPOpcode::LSR: case THUMBDPOpcode::ASR: case THUMBDPOpcode::ROR:
+            case THUMBDPOpcode::ADC: case THUMBDPOpcode::SBC: case THUMBDPOpcode::CMN:
+                return false;
+            default:
+                break;
+        }
+
+        bool isCompare = false;
+
+        loadReg(EAX, rd);
+        loadReg(ECX, rm);
+
+        switch (opcode) {
+            case THUMBDPOpcode::AND: alu(X86ALU::AND, EAX, ECX); setNZ(); break;
+            case THUMBDPOpcode::EOR: alu(X86ALU::XOR, EAX, ECX); setNZ(); break;
+            case THUMBDPOpcode::ORR: alu(X86ALU::OR , EAX, ECX); setNZ(); break;
+            case THUMBDPOpcode::TST:
+                alu(X86ALU::TEST, EAX, ECX);
+                setNZ();
+
+                isCompare = true;
+                break;
+            case THUMBDPOpcode::CMP:
+                alu(X86ALU::CMP, EAX, ECX);
+                setSubFlags();
+
+                isCompare = true;
+                break;
+            case THUMBDPOpcode::NEG:
+                emit8(0x89); emit8(0xC8); // MOV EAX, ECX
+                emit8(0xF7); emit8(0xD8); // NEG EAX
+
+                setSubFlags();
+                break;
+            case THUMBDPOpcode::MUL:
+                emit8(0x0F); emit8(0xAF); emit8(0xC1); // IMUL EAX, ECX
+
+                alu(X86ALU::TEST, EAX, EAX);
+                setNZ();
+                break;
+            case THUMBDPOpcode::BIC:
+                emit8(0xF7); emit8(0xD1); // NOT ECX
+
+                alu(X86ALU::AND, EAX, ECX);
+                setNZ();
+                break;
+            case THUMBDPOpcode::MVN:
+                emit8(0x89); emit8(0xC8); // MOV EAX, ECX
+                emit8(0xF7); emit8(0xD0); // NOT EAX
+
+                alu(X86ALU::TEST, EAX, EAX);
+                setNZ();
+                break;
+            default:
+                assert(false);
+        }
+
+        if (!isCompare) storeReg(rd, EAX);
+
+        return true;
+    }
+
+    if ((instr >> 10) == 0x11) {
+        // High register ADD/CMP/MOV
+        const auto rd = (instr & 7) | ((instr >> 4) & 8);
+        const auto rm = (instr >> 3) & 0xF;
+
+        const auto opcode = (instr >> 8) & 3;
+
+        if ((opcode == 3) || (rd == CPUReg::PC) || (rm == CPUReg::PC)) return false;
+
+        loadReg(ECX, rm);
+
+        switch (opcode) {
+            case 0: // ADD
+                loadReg(EAX, rd);
+
+                alu(X86ALU::ADD, EAX, ECX);
+
+                storeReg(rd, EAX);
+                break;
+            case 1: // CMP
+                loadReg(EAX, rd);
+
+                alu(X86ALU::CMP, EAX, ECX);
+
+                setSubFlags();
+                break;
+            case 2: // MOV
+                storeReg(rd, ECX);
+                break;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void resolveFlags(CPU *cpu) {
+    cpu->cpsr.resolveFlags();
+}
+
+/* Emits a call to an interpreter handler. Compiled code expects NZCV to be evaluated */
+void compileCall(const BlockInstr &i, bool isTHUMB) {
+    emit8(0x48); emit8(0x89); emit8(0xDF); // MOV RDI, RBX
+    emit8(0xBE); emit32(i.instr);          // MOV ESI, instr
+
+    loadPointer((isTHUMB) ? (void *)i.handlerTHUMB : (void *)i.handlerARM);
+
+    emit8(0xFF); emit8(0xD0); // CALL RAX
+
+    cmpImm8(off.flagOp, (u8)FlagOp::None);
+
+    const auto isResolved = jumpIf(X86Cond::Z);
+
+    emit8(0x48); emit8(0x89); emit8(0xDF); // MOV RDI, RBX
+
+    loadPointer((void *)&resolveFlags);
+
+    emit8(0xFF); emit8(0xD0); // CALL RAX
+
+    patchJump(isResolved, codePtr);
+}
+
+/* Emits the checks for leaving the block after an interpreted instruction */
+void compileExitChecks(bool isTHUMB, u32 nextPC) {
+    // Branches, exceptions
+    cmpImm32(getRegOffset(CPUReg::PC), nextPC);
+    exitJumps.push_back(jumpIf(X86Cond::NZ));
+
+    // State changes
+    cmpImm8(off.t, isTHUMB);
+    exitJumps.push_back(jumpIf(X86Cond::NZ));
+
+    // Halts
+    cmpImm8(off.isHalted, 0);
+    exitJumps.push_back(jumpIf(X86Cond::NZ));
+
+    // Code writes
+    loadPointer(&interpreter::isBlockInvalid);
+
+    emit8(0x80); emit8(0x38); emit8(0x00); // CMP BYTE [RAX], 0
+    exitJumps.push_back(jumpIf(X86Cond::NZ));
+}
+
+/* Compiles a decoded block into a host function, returns false if the block can't be compiled */
+bool compile(CPU *cpu, Block &block) {
+    if ((u64)(codeBuffer + CODE_BUFFER_SIZE - codePtr) < MAX_BLOCK_CODE) {
+        // Out of space, drop all compiled code
+        codePtr = codeBuffer;
+
+        codeGen++;
+    }
+
+    const auto base = (u8 *)cpu;
+
+    off.r   = (u8 *)&cpu->r[0] - base;
+    off.cpc = (u8 *)&cpu->cpc  - base;
+    off.n   = (u8 *)&cpu->cpsr.n - base;
+    off.z   = (u8 *)&cpu->cpsr.z - base;
+    off.c   = (u8 *)&cpu->cpsr.c - base;
+    off.v   = (u8 *)&cpu->cpsr.v - base;
+    off.t   = (u8 *)&cpu->cpsr.t - base;
+    off.flagOp   = (u8 *)&cpu->cpsr.flagOp - base;
+    off.isHalted = (u8 *)&cpu->isHalted - base;
+
+    const auto isTHUMB = cpu->cpsr.t;
+
+    const u32 instrSize = (isTHUMB) ? 2 : 4;
+
+    const auto entry = codePtr;
+
+    if (!protect(entry, MAX_BLOCK_CODE, true)) {
+        disable();
+
+        return false;
+    }
+
+    exitJumps.clear();
+
+    // Prologue
+    emit8(0x53);                           // PUSH RBX
+    emit8(0x41); emit8(0x54);              // PUSH R12
+    emit8(0x41); emit8(0x55);              // PUSH R13
+    emit8(0x48); emit8(0x89); emit8(0xFB); // MOV RBX, RDI
+    emit8(0x49); emit8(0x89); emit8(0xF4); // MOV R12, RSI
+    emit8(0x45); emit8(0x31); emit8(0xED); // XOR R13D, R13D
+
+    loadPointer(&interpreter::isBlockInvalid);
+
+    emit8(0xC6); emit8(0x00); emit8(0x00); // MOV BYTE [RAX], 0
+
+    auto pc = cpu->r[CPUReg::PC];
+
+    for (const auto &i : block.instrs) {
+        const auto cpc = pc;
+
+        pc += instrSize;
+
+        storeImm32(getRegOffset(CPUReg::PC), pc);
+
+        const auto condJump = (isTHUMB) ? NULL : emitCondition(i.cond);
+
+        const auto isNative = (isTHUMB) ? compileDataProcessingTHUMB(i.instr) : compileDataProcessingARM(i.instr);
+
+        if (!isNative) {
+            storeImm32(off.cpc, cpc);
+
+            compileCall(i, isTHUMB);
+        }
+
+        if (condJump != NULL) patchJump(condJump, codePtr);
+
+        emit8(0x49); emit8(0xFF); emit8(0xC5); // INC R13
+
+        if (!isNative) compileExitChecks(isTHUMB, pc);
+
+        // Out of cycles
+        emit8(0x4D); emit8(0x39); emit8(0xE5); // CMP R13, R12
+        exitJumps.push_back(jumpIf(X86Cond::Z));
+    }
+
+    // Epilogue
+    for (const auto jump : exitJumps) patchJump(jump, codePtr);
+
+    emit8(0x4C); emit8(0x89); emit8(0xE8); // MOV RAX, R13
+    emit8(0x41); emit8(0x5D);              // POP R13
+    emit8(0x41); emit8(0x5C);              // POP R12
+    emit8(0x5B);                           // POP RBX
+    emit8(0xC3);                           // RET
+
+    assert((u64)(codePtr - entry) <= MAX_BLOCK_CODE);
+
+    if (!protect(entry, MAX_BLOCK_CODE, false)) {
+        disable();
+
+        return false;
+    }
+
+    block.code    = (i64 (*)(CPU *, i64))entry;
+    block.codeGen = codeGen;
+
+    return true;
+}
+
+#else
+
+bool compile(CPU *cpu, Block &block) {
+    (void)cpu;
+    (void)block;
+
+    return false;
+}
+
+#endif
+
+void init() {
+#if defined(__x86_64__)
+    // Pages are flipped between RW and RX while compiling, the buffer is never writable and executable
+    codeBuffer = (u8 *)mmap(NULL, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (codeBuffer == MAP_FAILED) {
+        Log::warn("[JIT       ] Unable to allocate code buffer, falling back to the interpreter\n");
+
+        codeBuffer = NULL;
+
+        isAvailable = false;
+
+        return;
+    }
+
+    // Executable mappings may be denied (SELinux, PaX), find out before compiling anything
+    if (!protect(codeBuffer, CODE_BUFFER_SIZE, false)) {
+        Log::warn("[JIT       ] Unable to make code buffer executable, falling back to the interpreter\n");
+
+        munmap(codeBuffer, CODE_BUFFER_SIZE);
+
+        codeBuffer = NULL;
+
+        isAvailable = false;
+
+        return;
+    }
+
+    codePtr = codeBuffer;
+#endif
+}
+
+void run(CPU *cpu, i64 runCycles) {
+    if (!isAvailable) return interpreter::run(cpu, runCycles);
+
+    for (auto c = runCycles; c > 0;) {
+        if (cpu->isHalted) return;
+
+        const auto block = interpreter::getBlock(cpu);
+
+        if (block == NULL) {
+            interpreter::step(cpu);
+
+            c--;
+        } else {
+            const auto pc = cpu->r[CPUReg::PC];
+
+            if (((block->code == NULL) || (block->codeGen != codeGen)) && (++block->runCount >= COMPILE_THRESHOLD)) {
+                if (!compile(cpu, *block)) block->code = NULL;
+            }
+
+            if ((block->code != NULL) && (block->codeGen == codeGen)) {
+                cpu->cpsr.resolveFlags();
+
+                c -= block->code(cpu, c);
+            } else {
+                c -= interpreter::runBlock(cpu, *block, c);
+            }
+
+            // Skip to the end of the time slice
+            if (interpreter::isIdle(cpu, *block, pc)) c = 0;
+        }
+
+        assert(cpu->r[CPUReg::PC]);
+    }
+}
+
+}
@@ -0,0 +1,16 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#pragma once
+
+#include "cpu.hpp"
+
+namespace nds::cpu::jit {
+
+void init();
+
+void run(CPU *cpu, i64 runCycles);
+
+}
@@ -11,10 +11,12 @@
 #include "bus.hpp"
 #include "intc.hpp"
 #include "cartridge/cartridge.hpp"
+#include "../common/log.hpp"
 
 namespace nds::dma {
 
 using IntSource = intc::IntSource;
+using Log = logger::Logger<logger::Category::DMA>;
 
 constexpr const char *sync7Names[] = {
     "Immediately",
@@ -125,7 +127,7 @@ void checkCart9() {
         dstOffset *= 2;
         srcOffset *= 2;
 
-        std::printf("[0x%08X] = [0x%08X]\n", chn.dad[0], chn.sad[0]);
+        Log::debug("[0x%08X] = [0x%08X]\n", chn.dad[0], chn.sad[0]);
 
         bus::write32ARM7(chn.dad[0], bus::read32ARM7(chn.sad[0]));
 
@@ -134,7 +136,7 @@ void checkCart9() {
 
         if (!--chn.ctr[0]) {
             if (cnt.irqen) {
-                std::printf("[DMA:ARM9  ] Unhandled IRQ\n");
+                Log::error("[DMA:ARM9  ] Unhandled IRQ\n");
 
                 exit(0);
             }
@@ -161,7 +163,7 @@ void doDMA7(int chnID) {
     auto &chn = channels7[chnID];
     auto &cnt = chn.dmacnt;
 
-    std::printf("[DMA:ARM7  ] Channel %d DMA - %s\n", chnID, sync7Names[cnt.sync]);
+    Log::trace("[DMA:ARM7  ] Channel %d DMA - %s\n", chnID, sync7Names[cnt.sync]);
 
     // Reload internal registers
     chn.dad[0] = chn.dad[1] & ~1;
@@ -194,28 +196,15 @@ void doDMA7(int chnID) {
         if (cnt.isWord) {
             dstOffset *= 2;
             srcOffset *= 2;
+        }
 
-            for (auto i = chn.ctr[0]; i > 0; i--) {
-                std::printf("[0x%08X] = [0x%08X]\n", chn.dad[0], chn.sad[0]);
-
-                bus::write32ARM7(chn.dad[0], bus::read32ARM7(chn.sad[0]));
-
-                chn.dad[0] += dstOffset;
-                chn.sad[0] += srcOffset;
-            }
-        } else {
-            for (auto i = chn.ctr[0]; i > 0; i--) {
-                std::printf("[0x%08X] = [0x%08X]\n", chn.dad[0], chn.sad[0]);
-
-                bus::write16ARM7(chn.dad[0], bus::read16ARM7(chn.sad[0]));
+        bus::copyBlock(7, chn.dad[0], chn.sad[0], chn.ctr[0], (cnt.isWord) ? 4 : 2, dstOffset, srcOffset);
 
-                chn.dad[0] += dstOffset;
-                chn.sad[0] += srcOffset;
-            }
-        }
+        chn.dad[0] += chn.ctr[0] * dstOffset;
+        chn.sad[0] += chn.ctr[0] * srcOffset;
 
         if (cnt.irqen) {
-            std::printf("[DMA:ARM7  ] Unhandled IRQ\n");
+            Log::error("[DMA:ARM7  ] Unhandled IRQ\n");
 
             exit(0);
         }
@@ -228,7 +217,7 @@ void doDMA9(int chnID) {
     auto &chn = channels9[chnID];
     auto &cnt = chn.dmacnt;
 
-    std::printf("[DMA:ARM9  ] Channel %d DMA - %s\n", chnID, sync9Names[cnt.sync]);
+    Log::trace("[DMA:ARM9  ] Channel %d DMA - %s\n", chnID, sync9Names[cnt.sync]);
 
     // Reload internal registers
     chn.dad[0] = chn.dad[1] & ~1;
@@ -259,25 +248,12 @@ void doDMA9(int chnID) {
         if (cnt.isWord) {
             dstOffset *= 2;
             srcOffset *= 2;
+        }
 
-            for (auto i = chn.ctr[0]; i > 0; i--) {
-                std::printf("[0x%08X] = [0x%08X]\n", chn.dad[0], chn.sad[0]);
-
-                bus::write32ARM9(chn.dad[0], bus::read32ARM9(chn.sad[0]));
-
-                chn.dad[0] += dstOffset;
-                chn.sad[0] += srcOffset;
-            }
-        } else {
-            for (auto i = chn.ctr[0]; i > 0; i--) {
-                std::printf("[0x%08X] = [0x%08X]\n", chn.dad[0], chn.sad[0]);
-
-                bus::write16ARM9(chn.dad[0], bus::read16ARM9(chn.sad[0]));
+        bus::copyBlock(9, chn.dad[0], chn.sad[0], chn.ctr[0], (cnt.isWord) ? 4 : 2, dstOffset, srcOffset);
 
-                chn.dad[0] += dstOffset;
-                chn.sad[0] += srcOffset;
-            }
-        }
+        chn.dad[0] += chn.ctr[0] * dstOffset;
+        chn.sad[0] += chn.ctr[0] * srcOffset;
 
         if (cnt.irqen) intc::sendInterrupt9((IntSource)((int)IntSource::DMA0 + chnID));
 
@@ -285,6 +261,21 @@ void doDMA9(int chnID) {
     }
 }
 
+void init() {
+    bus::registerRead16(7, static_cast<u32>(DMAReg::DMASAD), 0x30, &read16ARM7);
+    bus::registerRead32(7, static_cast<u32>(DMAReg::DMASAD), 0x30, &read32ARM7);
+
+    bus::registerWrite16(7, static_cast<u32>(DMAReg::DMASAD), 0x30, &write16ARM7);
+    bus::registerWrite32(7, static_cast<u32>(DMAReg::DMASAD), 0x30, &write32ARM7);
+
+    // ARM9 reads and word writes include DMAFILL
+    bus::registerRead16(9, static_cast<u32>(DMAReg::DMASAD), 0x40, &read16ARM9);
+    bus::registerRead32(9, static_cast<u32>(DMAReg::DMASAD), 0x40, &read32ARM9);
+
+    bus::registerWrite16(9, static_cast<u32>(DMAReg::DMASAD), 0x30, &write16ARM9);
+    bus::registerWrite32(9, static_cast<u32>(DMAReg::DMASAD), 0x40, &write32ARM9);
+}
+
 u16 read16ARM7(u32 addr) {
     u16 data;
 
@@ -295,7 +286,7 @@ u16 read16ARM7(u32 addr) {
     switch (addr - 12 * chnID) {
         case static_cast<u32>(DMAReg::DMACNT_H):
             {
-                std::printf("[DMA:ARM7  ] Read16 @ DMA%dCNT_H\n", chnID);
+                Log::debug("[DMA:ARM7  ] Read16 @ DMA%dCNT_H\n", chnID);
 
                 const auto &cnt = chn.dmacnt;
 
@@ -309,7 +300,7 @@ u16 read16ARM7(u32 addr) {
             }
             break;
         default:
-            std::printf("[DMA:ARM7  ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[DMA:ARM7  ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -326,11 +317,11 @@ u32 read32ARM7(u32 addr) {
 
     switch (addr - 12 * chnID) {
         case static_cast<u32>(DMAReg::DMASAD):
-            std::printf("[DMA:ARM7  ] Read32 @ DMA%dSAD\n", chnID);
+            Log::debug("[DMA:ARM7  ] Read32 @ DMA%dSAD\n", chnID);
             return chn.sad[1];
         case static_cast<u32>(DMAReg::DMACNT):
             {
-                std::printf("[DMA:ARM7  ] Read32 @ DMA%dCNT\n", chnID);
+                Log::debug("[DMA:ARM7  ] Read32 @ DMA%dCNT\n", chnID);
 
                 auto &cnt = chn.dmacnt;
 
@@ -346,7 +337,7 @@ u32 read32ARM7(u32 addr) {
             }
             break;
         default:
-            std::printf("[DMA:ARM7  ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[DMA:ARM7  ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -362,14 +353,14 @@ u16 read16ARM9(u32 addr) {
     auto &chn = channels9[chnID];
 
     if (addr >= static_cast<u32>(DMAReg::DMAFILL)) {
-        std::printf("[DMA:ARM9  ] Unhandled read16 @ DMA%dFILL\n", chnID);
+        Log::error("[DMA:ARM9  ] Unhandled read16 @ DMA%dFILL\n", chnID);
 
         exit(0);
     } else {
         switch (addr - 12 * chnID) {
             case static_cast<u32>(DMAReg::DMACNT_H):
                 {
-                    std::printf("[DMA:ARM9  ] Read16 @ DMA%dCNT_H\n", chnID);
+                    Log::debug("[DMA:ARM9  ] Read16 @ DMA%dCNT_H\n", chnID);
 
                     auto &cnt = chn.dmacnt;
 
@@ -385,7 +376,7 @@ u16 read16ARM9(u32 addr) {
                 }
                 break;
             default:
-                std::printf("[DMA:ARM9  ] Unhandled read16 @ 0x%08X\n", addr);
+                Log::error("[DMA:ARM9  ] Unhandled read16 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -402,17 +393,17 @@ u32 read32ARM9(u32 addr) {
     auto &chn = channels9[chnID];
 
     if (addr >= static_cast<u32>(DMAReg::DMAFILL)) {
-        //std::printf("[DMA:ARM9  ] Read32 @ DMA%dFILL\n", chnID);
+        Log::debug("[DMA:ARM9  ] Read32 @ DMA%dFILL\n", chnID);
 
         return chn.fill;
     } else {
         switch (addr - 12 * chnID) {
             case static_cast<u32>(DMAReg::DMASAD):
-                std::printf("[DMA:ARM9  ] Read32 @ DMA%dSAD\n", chnID);
+                Log::debug("[DMA:ARM9  ] Read32 @ DMA%dSAD\n", chnID);
                 return chn.sad[1];
             case static_cast<u32>(DMAReg::DMACNT):
                 {
-                    std::printf("[DMA:ARM9  ] Read32 @ DMA%dCNT\n", chnID);
+                    Log::debug("[DMA:ARM9  ] Read32 @ DMA%dCNT\n", chnID);
 
                     auto &cnt = chn.dmacnt;
 
@@ -428,7 +419,7 @@ u32 read32ARM9(u32 addr) {
                 }
                 break;
             default:
-                std::printf("[DMA:ARM9  ] Unhandled read32 @ 0x%08X\n", addr);
+                Log::error("[DMA:ARM9  ] Unhandled read32 @ 0x%08X\n", addr);
 
                 exit(0);
         }
@@ -445,7 +436,7 @@ void write16ARM7(u32 addr, u16 data) {
     switch (addr - 12 * chnID) {
         case static_cast<u32>(DMAReg::DMACNT_H):
             {
-                std::printf("[DMA:ARM7  ] Write16 @ DMA%dCNT_H = 0x%08X\n", chnID, data);
+                Log::debug("[DMA:ARM7  ] Write16 @ DMA%dCNT_H = 0x%08X\n", chnID, data);
 
                 auto &cnt = chn.dmacnt;
 
@@ -463,7 +454,7 @@ void write16ARM7(u32 addr, u16 data) {
             }
             break;
         default:
-            std::printf("[DMA:ARM7  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[DMA:ARM7  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
@@ -476,18 +467,18 @@ void write32ARM7(u32 addr, u32 data) {
 
     switch (addr - 12 * chnID) {
         case static_cast<u32>(DMAReg::DMASAD):
-            std::printf("[DMA:ARM7  ] Write32 @ DMA%dSAD = 0x%08X\n", chnID, data);
+            Log::debug("[DMA:ARM7  ] Write32 @ DMA%dSAD = 0x%08X\n", chnID, data);
 
             chn.sad[1] = data;
             break;
         case static_cast<u32>(DMAReg::DMADAD):
-            std::printf("[DMA:ARM7  ] Write32 @ DMA%dDAD = 0x%08X\n", chnID, data);
+            Log::debug("[DMA:ARM7  ] Write32 @ DMA%dDAD = 0x%08X\n", chnID, data);
 
             chn.dad[1] = data;
             break;
         case static_cast<u32>(DMAReg::DMACNT):
             {
-                std::printf("[DMA:ARM7  ] Write32 @ DMA%dCNT = 0x%08X\n", chnID, data);
+                Log::debug("[DMA:ARM7  ] Write32 @ DMA%dCNT = 0x%08X\n", chnID, data);
 
                 auto &cnt = chn.dmacnt;
 
@@ -507,7 +498,7 @@ void write32ARM7(u32 addr, u32 data) {
             }
             break;
         default:
-            std::printf("[DMA:ARM7  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[DMA:ARM7  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
@@ -520,19 +511,19 @@ void write16ARM9(u32 addr, u16 data) {
     auto &chn = channels9[chnID];
 
     if (addr >= static_cast<u32>(DMAReg::DMAFILL)) {
-        std::printf("[DMA:ARM9  ] Unhandled write16 @ DMA%dFILL = 0x%04X\n", chnID, data);
+        Log::error("[DMA:ARM9  ] Unhandled write16 @ DMA%dFILL = 0x%04X\n", chnID, data);
 
         exit(0);
     } else {
         switch (addr - 12 * chnID) {
             case static_cast<u32>(DMAReg::DMACNT):
-                std::printf("[DMA:ARM9  ] Write16 @ DMA%dCNT_L = 0x%04X\n", chnID, data);
+                Log::debug("[DMA:ARM9  ] Write16 @ DMA%dCNT_L = 0x%04X\n", chnID, data);
                 
                 chn.ctr[1] = (chn.ctr[1] & 0xFFFF0000) | (u32)data;
                 break;
             case static_cast<u32>(DMAReg::DMACNT_H):
                 {
-                    std::printf("[DMA:ARM9  ] Write16 @ DMA%dCNT_H = 0x%04X\n", chnID, data);
+                    Log::debug("[DMA:ARM9  ] Write16 @ DMA%dCNT_H = 0x%04X\n", chnID, data);
 
                     auto &cnt = chn.dmacnt;
 
@@ -552,7 +543,7 @@ void write16ARM9(u32 addr, u16 data) {
                 }
                 break;
             default:
-                std::printf("[DMA:ARM9  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+                Log::error("[DMA:ARM9  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
                 exit(0);
         }
@@ -565,24 +556,24 @@ void write32ARM9(u32 addr, u32 data) {
     auto &chn = channels9[chnID];
 
     if (addr >= static_cast<u32>(DMAReg::DMAFILL)) {
-        std::printf("[DMA:ARM9  ] Write32 @ DMA%dFILL = 0x%08X\n", chnID, data);
+        Log::debug("[DMA:ARM9  ] Write32 @ DMA%dFILL = 0x%08X\n", chnID, data);
 
         chn.fill = data;
     } else {
         switch (addr - 12 * chnID) {
             case static_cast<u32>(DMAReg::DMASAD):
-                std::printf("[DMA:ARM9  ] Write32 @ DMA%dSAD = 0x%08X\n", chnID, data);
+                Log::debug("[DMA:ARM9  ] Write32 @ DMA%dSAD = 0x%08X\n", chnID, data);
 
                 chn.sad[1] = data;
                 break;
             case static_cast<u32>(DMAReg::DMADAD):
-                std::printf("[DMA:ARM9  ] Write32 @ DMA%dDAD = 0x%08X\n", chnID, data);
+                Log::debug("[DMA:ARM9  ] Write32 @ DMA%dDAD = 0x%08X\n", chnID, data);
 
                 chn.dad[1] = data;
                 break;
             case static_cast<u32>(DMAReg::DMACNT):
                 {
-                    std::printf("[DMA:ARM9  ] Write32 @ DMA%dCNT = 0x%08X\n", chnID, data);
+                    Log::debug("[DMA:ARM9  ] Write32 @ DMA%dCNT = 0x%08X\n", chnID, data);
 
                     auto &cnt = chn.dmacnt;
 
@@ -602,7 +593,7 @@ void write32ARM9(u32 addr, u32 data) {
                 }
                 break;
             default:
-                std::printf("[DMA:ARM9  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+                Log::error("[DMA:ARM9  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
                 exit(0);
         }
@@ -9,6 +9,8 @@
 
 namespace nds::dma {
 
+void init();
+
 void checkCart9();
 
 u16 read16ARM7(u32 addr);
@@ -0,0 +1,529 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#include "fastmem.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <csignal>
+#include <ucontext.h>
+#include <unistd.h>
+
+#define FASTMEM_SUPPORTED
+#endif
+
+#include "cpu/cpu.hpp"
+#include "../common/log.hpp"
+
+namespace nds::cpu {
+
+extern u32 itcmBase , dtcmBase;
+extern u32 itcmLimit, dtcmLimit;
+
+}
+
+namespace nds::fastmem {
+
+using Log = logger::Logger<logger::Category::Fastmem>;
+
+// Host VM fastmem (false = guest memory is only reachable through the page tables)
+constexpr auto useFastmem = false;
+
+// Fastmem constants
+
+constexpr u64 HOST_PAGE_SIZE = 0x1000;
+constexpr u64 HUGE_PAGE_SIZE = 0x200000;
+constexpr u64 ARENA_SIZE     = 1ull << 32;
+
+constexpr u64 MAX_TCM_MIRRORS = 1024; // Higher mirrors go through the fault handler
+
+constexpr auto NUM_REGIONS = static_cast<int>(Region::NumRegions);
+
+/* Guest memory layout */
+constexpr const char *REGION_NAME[] = {
+    "Main", "SWRAM", "WRAM", "BIOS7", "BIOS9", "ITCM", "DTCM",
+    "VRAM A", "VRAM B", "VRAM C", "VRAM D", "VRAM E", "VRAM F", "VRAM G", "VRAM H", "VRAM I",
+    "Palette", "WiFi", "FB",
+};
+
+constexpr u64 REGION_SIZE[] = {
+    0x400000, 0x8000, 0x10000, 0x4000, 0x1000, 0x8000, 0x4000,
+    0x20000, 0x20000, 0x20000, 0x20000, 0x10000, 0x4000, 0x4000, 0x8000, 0x4000,
+    0x800, 0x1000, 0x30000,
+};
+
+static_assert((std::size(REGION_NAME) == NUM_REGIONS) && (std::size(REGION_SIZE) == NUM_REGIONS));
+
+/* Returns the arena offset of a region, regions start on host pages */
+constexpr u64 getOffset(int idx) {
+    u64 offset = 0;
+
+    for (int i = 0; i < idx; i++) offset += (REGION_SIZE[i] + HOST_PAGE_SIZE - 1) & ~(HOST_PAGE_SIZE - 1);
+
+    return offset;
+}
+
+constexpr u64 MEMORY_SIZE = (getOffset(NUM_REGIONS) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+// Guest memory arena, backed by a memfd if fastmem is enabled
+std::vector<u8> memory; // Fallback for hosts without mmap
+
+u8 *memoryView = NULL;
+
+RegionInfo regions[NUM_REGIONS];
+
+// Dirty page tracking, every page holds the generation it was last written in
+std::vector<u32> pageGen;
+std::vector<u8 > pageRegion; // Region of every page, padding belongs to the region before it
+
+u32 regionGen[NUM_REGIONS]; // Last generation any page of a region was written in
+
+u32 generation;
+
+// Per-CPU arenas
+u8 *arena7 = NULL, *arena9 = NULL;
+
+cpu::CPU *cpus[2];
+
+#ifdef FASTMEM_SUPPORTED
+
+int memFD = -1;
+
+struct sigaction prevAction; // SIGSEGV handler before ours, gets faults outside of the arenas
+
+/* Host register IDs in x86 encoding order */
+constexpr int GREG[] = {
+    REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8 , REG_R9 , REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+};
+
+/* Reserves 4GB of inaccessible host address space, or clears an existing arena */
+u8 *reserve(u8 *arena) {
+    const auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | ((arena != NULL) ? MAP_FIXED : 0);
+
+    const auto mem = mmap(arena, ARENA_SIZE, PROT_NONE, flags, -1, 0);
+
+    return (mem != MAP_FAILED) ? (u8 *)mem : NULL;
+}
+
+/* Maps [addr;addr+size] of an arena to the mirrors of a guest memory region */
+void mapMirrors(u8 *arena, u64 addr, u64 size, const u8 *mem, u64 mask, int prot) {
+    assert(!(addr & (HOST_PAGE_SIZE - 1)) && !(size & (HOST_PAGE_SIZE - 1)) && (mask >= (HOST_PAGE_SIZE - 1)));
+
+    const auto end = std::min(addr + size, ARENA_SIZE);
+
+    while (addr < end) {
+        const auto offset = addr & mask;
+        const auto chunk  = std::min(mask + 1 - offset, end - addr);
+
+        if (mmap(arena + addr, chunk, prot, MAP_SHARED | MAP_FIXED, memFD, (mem - memoryView) + offset) == MAP_FAILED) {
+            Log::error("[Fastmem   ] Failed to map 0x%08llX\n", (unsigned long long)addr);
+
+            exit(0);
+        }
+
+        addr += chunk;
+    }
+}
+
+/* Maps TCM over the ARM9 arena. Partial pages and high mirrors go through the fault handler */
+void mapTCM(const u8 *mem, u64 base, u64 limit, u64 mask) {
+    const auto end = std::min(base + std::max(limit, HOST_PAGE_SIZE), ARENA_SIZE);
+
+    mprotect(arena9 + base, end - base, PROT_NONE);
+
+    if (limit < HOST_PAGE_SIZE) return;
+
+    mapMirrors(arena9, base, std::min(end - base, MAX_TCM_MIRRORS * (mask + 1)), mem, mask, PROT_READ | PROT_WRITE);
+}
+
+/* Returns the CPU an arena address belongs to, NULL if it's outside of both arenas */
+cpu::CPU *getFaultingCPU(const u8 *addr) {
+    if ((addr >= arena7) && (addr < (arena7 + ARENA_SIZE))) return cpus[0];
+    if ((addr >= arena9) && (addr < (arena9 + ARENA_SIZE))) return cpus[1];
+
+    return NULL;
+}
+
+/*
+ * Emulates a faulting host load or store through the bus. Returns false if the instruction isn't supported.
+ * Supported: MOV r/m, MOV r/m, imm, MOVZX and MOVSX, 8-32 bits
+ */
+bool emulateAccess(cpu::CPU *cpu, u32 addr, greg_t *gregs) {
+    const auto code = (const u8 *)gregs[REG_RIP];
+
+    int i = 0;
+
+    const auto is16 = code[i] == 0x66;
+
+    if (is16) i++;
+
+    const u8 rex = ((code[i] & 0xF0) == 0x40) ? code[i++] : 0;
+
+    if (rex & (1 << 3)) return false; // No 64-bit accesses
+
+    int size, regSize; // Memory and register operand size
+    bool isLoad, isExtend = false, isSignExtend = false, isImm = false;
+
+    switch (code[i++]) {
+        case 0x88: size = 1; isLoad = false; break;
+        case 0x89: size = (is16) ? 2 : 4; isLoad = false; break;
+        case 0x8A: size = 1; isLoad = true; break;
+        case 0x8B: size = (is16) ? 2 : 4; isLoad = true; break;
+        case 0xC6: size = 1; isLoad = false; isImm = true; break;
+        case 0xC7: size = (is16) ? 2 : 4; isLoad = false; isImm = true; break;
+        case 0x0F:
+            switch (code[i++]) {
+                case 0xB6: size = 1; break;
+                case 0xB7: size = 2; break;
+                case 0xBE: size = 1; isSignExtend = true; break;
+                case 0xBF: size = 2; isSignExtend = true; break;
+                default: return false;
+            }
+
+            isLoad = isExtend = true;
+            break;
+        default:
+            return false;
+    }
+
+    regSize = (isExtend) ? ((is16) ? 2 : 4) : size;
+
+    const auto modrm = code[i++];
+
+    const auto mod = modrm >> 6;
+    const auto reg = ((modrm >> 3) & 7) | ((rex & (1 << 2)) << 1);
+    const auto rm  = modrm & 7;
+
+    if ((mod == 3) || (isImm && (reg & 7))) return false; // C6/C7 /0 only
+
+    if ((rm == 4) && ((code[i++] & 7) == 5) && !mod) i += 4;
+    if (!mod && (rm == 5)) i += 4;
+
+    if (mod == 1) i += 1;
+    if (mod == 2) i += 4;
+
+    // Without REX, byte registers 4-7 are AH, CH, DH and BH
+    const auto isHighByte = (regSize == 1) && !rex && (reg >= 4);
+
+    auto &r = gregs[GREG[(isHighByte) ? reg - 4 : reg]];
+
+    const auto shift = (isHighByte) ? 8 : 0;
+
+    if (isLoad) {
+        u64 data;
+
+        switch (size) {
+            case 1 : data = cpu->busRead8 (addr); break;
+            case 2 : data = cpu->busRead16(addr); break;
+            default: data = cpu->busRead32(addr); break;
+        }
+
+        if (isSignExtend) data = (size == 1) ? (u32)(i8)data : (u32)(i16)data;
+
+        if (regSize == 4) { // 32-bit writes clear the upper half
+            r = (u32)data;
+        } else {
+            const u64 mask = ((1ull << (8 * regSize)) - 1) << shift;
+
+            r = (r & ~mask) | ((data << shift) & mask);
+        }
+    } else {
+        u64 data = (u64)r >> shift;
+
+        if (isImm) {
+            data = 0;
+
+            std::memcpy(&data, &code[i], size);
+
+            i += size;
+        }
+
+        switch (size) {
+            case 1 : cpu->busWrite8 (addr, data); break;
+            case 2 : cpu->busWrite16(addr, data); break;
+            default: cpu->busWrite32(addr, data); break;
+        }
+    }
+
+    gregs[REG_RIP] += i;
+
+    return true;
+}
+
+/* Falls back to the bus for arena accesses to MMIO and unmapped memory */
+void handleFault(int sig, siginfo_t *info, void *ctx) {
+    const auto addr = (const u8 *)info->si_addr;
+
+    if (const auto cpu = getFaultingCPU(addr); cpu != NULL) {
+        const auto arena = (cpu->cpuID == 7) ? arena7 : arena9;
+
+        if (emulateAccess(cpu, addr - arena, ((ucontext_t *)ctx)->uc_mcontext.gregs)) return;
+    }
+
+    // Not ours, pass it on. Returning with the default action refaults and crashes
+    if (prevAction.sa_flags & SA_SIGINFO) {
+        if (prevAction.sa_sigaction != NULL) return prevAction.sa_sigaction(sig, info, ctx);
+    } else if ((prevAction.sa_handler != SIG_DFL) && (prevAction.sa_handler != SIG_IGN)) {
+        return prevAction.sa_handler(sig);
+    }
+
+    std::signal(sig, SIG_DFL);
+}
+
+/* Sets up the memfd and both arenas, returns false if the host refuses */
+bool initArenas(u8 *view) {
+    if (sysconf(_SC_PAGESIZE) != HOST_PAGE_SIZE) return false;
+
+    memFD = memfd_create("MariDS", MFD_CLOEXEC);
+
+    if ((memFD < 0) || (ftruncate(memFD, MEMORY_SIZE) < 0)) return false;
+
+    if (mmap(view, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memFD, 0) == MAP_FAILED) return false;
+
+    memoryView = view;
+
+    arena7 = reserve(NULL);
+    arena9 = reserve(NULL);
+
+    if ((arena7 == NULL) || (arena9 == NULL)) return false;
+
+    struct sigaction sa = {};
+
+    sa.sa_sigaction = &handleFault;
+    sa.sa_flags = SA_SIGINFO;
+
+    sigemptyset(&sa.sa_mask);
+
+    return sigaction(SIGSEGV, &sa, &prevAction) == 0;
+}
+
+#endif
+
+#ifdef __linux__
+
+/* Reserves host address space for the guest memory arena on a huge page boundary */
+u8 *reserveView() {
+    const auto mem = mmap(NULL, MEMORY_SIZE + HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (mem == MAP_FAILED) return NULL;
+
+    const auto view = (u8 *)(((u64)mem + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+
+    // Give back the unaligned head and the tail
+    if (view != (u8 *)mem) munmap(mem, view - (u8 *)mem);
+
+    munmap(view + MEMORY_SIZE, ((u8 *)mem + HUGE_PAGE_SIZE) - view);
+
+    return view;
+}
+
+#endif
+
+/* Allocates the guest memory arena and fills in the region descriptors */
+void initMemory() {
+#ifdef __linux__
+    if (const auto view = reserveView(); view != NULL) {
+#ifdef FASTMEM_SUPPORTED
+        if (useFastmem && !initArenas(view)) {
+            Log::warn("[Fastmem   ] Failed to set up host memory, falling back to page tables\n");
+
+            memoryView = NULL;
+            arena7 = arena9 = NULL;
+        }
+#endif
+
+        if ((memoryView == NULL) && (mmap(view, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)) {
+            memoryView = view;
+        }
+
+        // Guest RAM is accessed randomly, huge pages save a lot of TLB misses
+        if (memoryView != NULL) madvise(memoryView, MEMORY_SIZE, MADV_HUGEPAGE);
+    }
+#endif
+
+    if (memoryView == NULL) {
+        memory.resize(MEMORY_SIZE);
+
+        memoryView = memory.data();
+    }
+
+    for (int i = 0; i < NUM_REGIONS; i++) {
+        regions[i] = {REGION_NAME[i], &memoryView[getOffset(i)], getOffset(i), REGION_SIZE[i]};
+    }
+
+    pageGen.resize(MEMORY_SIZE >> DIRTY_PAGE_SHIFT);
+    pageRegion.resize(MEMORY_SIZE >> DIRTY_PAGE_SHIFT);
+
+    for (int i = 0; i < NUM_REGIONS; i++) {
+        const auto end = (i == (NUM_REGIONS - 1)) ? MEMORY_SIZE : getOffset(i + 1);
+
+        std::fill(&pageRegion[getOffset(i) >> DIRTY_PAGE_SHIFT], &pageRegion[0] + (end >> DIRTY_PAGE_SHIFT), i);
+    }
+}
+
+void init() {
+    // The arena is only allocated once, later calls clear it
+    if (memoryView == NULL) {
+        initMemory();
+    } else {
+        std::memset(memoryView, 0, MEMORY_SIZE);
+    }
+
+    // Everything is dirty in generation 0
+    std::fill(pageGen.begin(), pageGen.end(), 0);
+    std::fill(std::begin(regionGen), std::end(regionGen), 0);
+
+    generation = 1;
+
+    Log::info("[Fastmem   ] OK! (%s, %llu KB arena)\n", (isEnabled()) ? "enabled" : "disabled", (unsigned long long)(MEMORY_SIZE >> 10));
+}
+
+bool isEnabled() {
+    return arena7 != NULL;
+}
+
+/* Returns the host backing of a guest memory region */
+u8 *getMemory(Region region) {
+    return regions[static_cast<int>(region)].mem;
+}
+
+/*
+ * Returns the 4GB arena of a CPU, NULL if fastmem is disabled. Stores through the arena don't invalidate blocks.
+ * Only MOV, MOV imm, MOVZX and MOVSX (8-32 bits) may touch the arena, other faulting instructions crash.
+ * Don't let the compiler dereference arena pointers, it may emit RMW or vector ops
+ */
+u8 *getBase(int cpuID) {
+    return (cpuID == 7) ? arena7 : arena9;
+}
+
+/* Returns the descriptor of a guest memory region, regions are laid out linearly in the arena */
+const RegionInfo &getRegionInfo(Region region) {
+    return regions[static_cast<int>(region)];
+}
+
+/* Returns the guest memory arena, all regions live in one contiguous block */
+u8 *getArena() {
+    return memoryView;
+}
+
+u64 getArenaSize() {
+    return MEMORY_SIZE;
+}
+
+/* Marks the page of a host pointer as written in the current generation, pointers outside of the arena are ignored */
+void markDirty(const u8 *mem) {
+    const auto offset = (uintptr_t)mem - (uintptr_t)memoryView;
+
+    if (offset >= MEMORY_SIZE) return;
+
+    const auto page = offset >> DIRTY_PAGE_SHIFT;
+
+    pageGen[page] = generation;
+
+    regionGen[pageRegion[page]] = generation;
+}
+
+void markDirtyRange(const u8 *mem, u64 size) {
+    if (!size) return;
+
+    const auto offset = (uintptr_t)mem - (uintptr_t)memoryView;
+
+    if (offset >= MEMORY_SIZE) return;
+
+    const auto first = offset >> DIRTY_PAGE_SHIFT;
+    const auto last  = std::min(offset + size - 1, MEMORY_SIZE - 1) >> DIRTY_PAGE_SHIFT;
+
+    std::fill(&pageGen[first], &pageGen[last] + 1, generation);
+
+    // Regions are laid out linearly, so the range touches all regions in between
+    std::fill(&regionGen[pageRegion[first]], &regionGen[pageRegion[last]] + 1, generation);
+}
+
+u32 getGeneration() {
+    return generation;
+}
+
+/* Starts a new generation and returns it. Pages written from now on are reported by getDirtyPages(region, gen) */
+u32 newGeneration() {
+    return ++generation;
+}
+
+/*
+ * Stores the region offsets of all pages written in generation gen or later to pages, returns how many there are.
+ * pages must hold getPageCount(region) entries
+ */
+u64 getDirtyPages(Region region, u32 gen, u64 *pages) {
+    if (!isDirty(region, gen)) return 0;
+
+    const auto &info = regions[static_cast<int>(region)];
+
+    u64 count = 0;
+
+    for (u64 offset = 0; offset < info.size; offset += DIRTY_PAGE_SIZE) {
+        if (pageGen[(info.offset + offset) >> DIRTY_PAGE_SHIFT] >= gen) pages[count++] = offset;
+    }
+
+    return count;
+}
+
+/* Returns the number of dirty tracking pages in a region */
+u64 getPageCount(Region region) {
+    return (regions[static_cast<int>(region)].size + DIRTY_PAGE_SIZE - 1) >> DIRTY_PAGE_SHIFT;
+}
+
+/* Returns true if any page of a region was written in generation gen or later */
+bool isDirty(Region region, u32 gen) {
+    return regionGen[static_cast<int>(region)] >= gen;
+}
+
+void registerCPU(cpu::CPU *cpu) {
+    cpus[cpu->cpuID == 9] = cpu;
+}
+
+/* Rebuilds the ARM7 arena, mirrors BIOS (read-only), main RAM, SWRAM and WRAM */
+void remapARM7(u8 *swram7, u32 swramLimit7) {
+    if (!isEnabled()) return;
+
+#ifdef FASTMEM_SUPPORTED
+    reserve(arena7);
+
+    mapMirrors(arena7, 0x00000000, 0x00004000, getMemory(Region::BIOS7), REGION_SIZE[static_cast<int>(Region::BIOS7)] - 1, PROT_READ);
+    mapMirrors(arena7, 0x02000000, 0x01000000, getMemory(Region::Main ), REGION_SIZE[static_cast<int>(Region::Main )] - 1, PROT_READ | PROT_WRITE);
+    mapMirrors(arena7, 0x03000000, 0x00800000, swram7, swramLimit7, PROT_READ | PROT_WRITE);
+    mapMirrors(arena7, 0x03800000, 0x00800000, getMemory(Region::WRAM ), REGION_SIZE[static_cast<int>(Region::WRAM )] - 1, PROT_READ | PROT_WRITE);
+#else
+    (void)swram7;
+    (void)swramLimit7;
+#endif
+}
+
+/* Rebuilds the ARM9 arena, mirrors main RAM, TCM and BIOS (read-only) */
+void remapARM9() {
+    if (!isEnabled()) return;
+
+#ifdef FASTMEM_SUPPORTED
+    reserve(arena9);
+
+    mapMirrors(arena9, 0x02000000, 0x01000000, getMemory(Region::Main ), REGION_SIZE[static_cast<int>(Region::Main )] - 1, PROT_READ | PROT_WRITE);
+    mapMirrors(arena9, 0xFFFF0000, 0x00010000, getMemory(Region::BIOS9), REGION_SIZE[static_cast<int>(Region::BIOS9)] - 1, PROT_READ);
+
+    // ITCM has priority over DTCM
+    mapTCM(getMemory(Region::DTCM), cpu::dtcmBase, cpu::dtcmLimit, REGION_SIZE[static_cast<int>(Region::DTCM)] - 1);
+    mapTCM(getMemory(Region::ITCM), cpu::itcmBase, cpu::itcmLimit, REGION_SIZE[static_cast<int>(Region::ITCM)] - 1);
+#endif
+}
+
+}
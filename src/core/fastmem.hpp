@@ -0,0 +1,67 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#pragma once
+
+#include "../common/types.hpp"
+
+namespace nds::cpu {
+    struct CPU;
+}
+
+namespace nds::fastmem {
+
+// Dirty page tracking constants
+
+constexpr u64 DIRTY_PAGE_SHIFT = 10; // 1KB, small enough for VRAM and palette RAM
+constexpr u64 DIRTY_PAGE_SIZE  = 1ull << DIRTY_PAGE_SHIFT;
+
+/* Guest memory regions, in arena order */
+enum class Region {
+    Main, SWRAM, WRAM, BIOS7, BIOS9, ITCM, DTCM,
+    VRAMA, VRAMB, VRAMC, VRAMD, VRAME, VRAMF, VRAMG, VRAMH, VRAMI,
+    Palette, WiFi, FB,
+    NumRegions,
+};
+
+/* Guest memory region descriptor */
+struct RegionInfo {
+    const char *name;
+
+    u8 *mem;
+
+    u64 offset; // Arena offset
+    u64 size;
+};
+
+void init();
+
+bool isEnabled();
+
+u8 *getMemory(Region region);
+u8 *getBase(int cpuID);
+
+const RegionInfo &getRegionInfo(Region region);
+
+u8 *getArena();
+u64 getArenaSize();
+
+void markDirty(const u8 *mem);
+void markDirtyRange(const u8 *mem, u64 size);
+
+u32 getGeneration();
+u32 newGeneration();
+
+u64 getDirtyPages(Region region, u32 gen, u64 *pages);
+u64 getPageCount(Region region);
+
+bool isDirty(Region region, u32 gen);
+
+void registerCPU(cpu::CPU *cpu);
+
+void remapARM7(u8 *swram7, u32 swramLimit7);
+void remapARM9();
+
+}
@@ -9,9 +9,12 @@
 #include <cstdio>
 
 #include "../common/file.hpp"
+#include "../common/log.hpp"
 
 namespace nds::firmware {
 
+using Log = logger::Logger<logger::Category::Firmware>;
+
 enum FirmCmd {
     READ = 0x03,
     RDSR = 0x05,
@@ -45,7 +48,7 @@ void init(const char *firmPath) {
 
     wip = wel = false;
 
-    std::printf("[Firmware  ] OK!\n");
+    Log::info("[Firmware  ] OK!\n");
 
     firmState = FirmState::Idle;
 }
@@ -73,7 +76,7 @@ u8 read() {
 }
 
 void write(u8 data) {
-    std::printf("[Firmware  ] Write = 0x%02X\n", data);
+    Log::debug("[Firmware  ] Write = 0x%02X\n", data);
 
     switch (firmState) {
         case FirmState::Idle:
@@ -81,7 +84,7 @@ void write(u8 data) {
 
             switch (firmCmd) {
                 case FirmCmd::READ:
-                    std::printf("[Firmware  ] READ\n");
+                    Log::debug("[Firmware  ] READ\n");
 
                     firmState = FirmState::GetAddress;
 
@@ -90,17 +93,17 @@ void write(u8 data) {
                     argLen = 3;
                     break;
                 case FirmCmd::RDSR:
-                    std::printf("[Firmware  ] RDSR\n");
+                    Log::debug("[Firmware  ] RDSR\n");
 
                     firmState = FirmState::ReadStatus;
                     break;
                 case FirmCmd::WREN:
-                    std::printf("[Firmware  ] WREN\n");
+                    Log::debug("[Firmware  ] WREN\n");
 
                     wel = true;
                     break;
                 default:
-                    std::printf("[Firmware  ] Unhandled command 0x%02X\n", firmCmd);
+                    Log::error("[Firmware  ] Unhandled command 0x%02X\n", firmCmd);
 
                     exit(0);
             }
@@ -110,7 +113,7 @@ void write(u8 data) {
             firmAddr  |= (u32)data;
 
             if (!--argLen) {
-                std::printf("[Firmware  ] Address = 0x%06X\n", firmAddr);
+                Log::debug("[Firmware  ] Address = 0x%06X\n", firmAddr);
 
                 switch (firmCmd) {
                     case FirmCmd::READ:
@@ -8,10 +8,14 @@
 #include <cassert>
 #include <cstdio>
 
+#include "bus.hpp"
 #include "MariDS.hpp"
+#include "../common/log.hpp"
 
 namespace nds::intc {
 
+using Log = logger::Logger<logger::Category::INTC>;
+
 constexpr const char *intNames[] = {
     "VBLANK", "HBLANK", "VCOUNT",
     "Timer 0", "Timer 1", "Timer 2", "Timer 3",
@@ -60,7 +64,7 @@ void checkInterrupt9() {
 }
 
 void sendInterrupt7(IntSource intSource) {
-    std::printf("[INTC:ARM7 ] %s interrupt request\n", intNames[intSource]);
+    Log::trace("[INTC:ARM7 ] %s interrupt request\n", intNames[intSource]);
 
     if7 |= 1 << intSource;
 
@@ -68,20 +72,37 @@ void sendInterrupt7(IntSource intSource) {
 }
 
 void sendInterrupt9(IntSource intSource) {
-    std::printf("[INTC:ARM9 ] %s interrupt request\n", intNames[intSource]);
+    Log::trace("[INTC:ARM9 ] %s interrupt request\n", intNames[intSource]);
 
     if9 |= 1 << intSource;
 
     checkInterrupt9();
 }
 
+void init() {
+    bus::registerRead16(7, INTCReg::IME, 0x10, &read16ARM7);
+    bus::registerRead32(7, INTCReg::IME, 0x10, &read32ARM7);
+
+    bus::registerWrite8 (7, INTCReg::IME, 0x10, &write8ARM7);
+    bus::registerWrite16(7, INTCReg::IME, 0x10, &write16ARM7);
+    bus::registerWrite32(7, INTCReg::IME, 0x10, &write32ARM7);
+
+    bus::registerRead8 (9, INTCReg::IME, 0x10, &read8ARM9);
+    bus::registerRead16(9, INTCReg::IME, 0x10, &read16ARM9);
+    bus::registerRead32(9, INTCReg::IME, 0x10, &read32ARM9);
+
+    bus::registerWrite8 (9, INTCReg::IME, 0x10, &write8ARM9);
+    bus::registerWrite16(9, INTCReg::IME, 0x10, &write16ARM9);
+    bus::registerWrite32(9, INTCReg::IME, 0x10, &write32ARM9);
+}
+
 u16 read16ARM7(u32 addr) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM7 ] Read16 @ IME\n");
+            Log::debug("[INTC:ARM7 ] Read16 @ IME\n");
             return ime7;
         default:
-            std::printf("[INTC:ARM7 ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[INTC:ARM7 ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -90,16 +111,16 @@ u16 read16ARM7(u32 addr) {
 u32 read32ARM7(u32 addr) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM7 ] Read32 @ IME\n");
+            Log::debug("[INTC:ARM7 ] Read32 @ IME\n");
             return ime7;
         case INTCReg::IE:
-            std::printf("[INTC:ARM7 ] Read32 @ IE\n");
+            Log::debug("[INTC:ARM7 ] Read32 @ IE\n");
             return ie7;
         case INTCReg::IF:
-            std::printf("[INTC:ARM7 ] Read32 @ IF\n");
+            Log::debug("[INTC:ARM7 ] Read32 @ IF\n");
             return if7;
         default:
-            std::printf("[INTC:ARM7 ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[INTC:ARM7 ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -108,10 +129,10 @@ u32 read32ARM7(u32 addr) {
 u8 read8ARM9(u32 addr) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM9 ] Read8 @ IME\n");
+            Log::debug("[INTC:ARM9 ] Read8 @ IME\n");
             return ime9;
         default:
-            std::printf("[INTC:ARM9 ] Unhandled read8 @ 0x%08X\n", addr);
+            Log::error("[INTC:ARM9 ] Unhandled read8 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -120,10 +141,10 @@ u8 read8ARM9(u32 addr) {
 u16 read16ARM9(u32 addr) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM9 ] Read16 @ IME\n");
+            Log::debug("[INTC:ARM9 ] Read16 @ IME\n");
             return ime9;
         default:
-            std::printf("[INTC:ARM9 ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[INTC:ARM9 ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -132,16 +153,16 @@ u16 read16ARM9(u32 addr) {
 u32 read32ARM9(u32 addr) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM9 ] Read32 @ IME\n");
+            Log::debug("[INTC:ARM9 ] Read32 @ IME\n");
             return ime9;
         case INTCReg::IE:
-            std::printf("[INTC:ARM9 ] Read32 @ IE\n");
+            Log::debug("[INTC:ARM9 ] Read32 @ IE\n");
             return ie9;
         case INTCReg::IF:
-            std::printf("[INTC:ARM9 ] Read32 @ IF\n");
+            Log::debug("[INTC:ARM9 ] Read32 @ IF\n");
             return if9;
         default:
-            std::printf("[INTC:ARM9 ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[INTC:ARM9 ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -150,14 +171,14 @@ u32 read32ARM9(u32 addr) {
 void write8ARM7(u32 addr, u8 data) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM7 ] Write8 @ IME = 0x%02X\n", data);
+            Log::debug("[INTC:ARM7 ] Write8 @ IME = 0x%02X\n", data);
             
             ime7 = data & 1;
 
             checkInterrupt7();
             break;
         default:
-            std::printf("[INTC:ARM7 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
+            Log::error("[INTC:ARM7 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
 
             exit(0);
     }
@@ -166,14 +187,14 @@ void write8ARM7(u32 addr, u8 data) {
 void write16ARM7(u32 addr, u16 data) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM7 ] Write16 @ IME = 0x%04X\n", data);
+            Log::debug("[INTC:ARM7 ] Write16 @ IME = 0x%04X\n", data);
             
             ime7 = data & 1;
 
             checkInterrupt7();
             break;
         default:
-            std::printf("[INTC:ARM7 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[INTC:ARM7 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
@@ -182,22 +203,22 @@ void write16ARM7(u32 addr, u16 data) {
 void write32ARM7(u32 addr, u32 data) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM7 ] Write32 @ IME = 0x%08X\n", data);
+            Log::debug("[INTC:ARM7 ] Write32 @ IME = 0x%08X\n", data);
             
             ime7 = data & 1;
             break;
         case INTCReg::IE:
-            std::printf("[INTC:ARM7 ] Write32 @ IE = 0x%08X\n", data);
+            Log::debug("[INTC:ARM7 ] Write32 @ IE = 0x%08X\n", data);
             
             ie7 = data;
             break;
         case INTCReg::IF:
-            std::printf("[INTC:ARM7 ] Write32 @ IF = 0x%08X\n", data);
+            Log::debug("[INTC:ARM7 ] Write32 @ IF = 0x%08X\n", data);
             
             if7 &= ~data;
             break;
         default:
-            std::printf("[INTC:ARM7 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[INTC:ARM7 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
@@ -208,14 +229,14 @@ void write32ARM7(u32 addr, u32 data) {
 void write8ARM9(u32 addr, u8 data) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM9 ] Write8 @ IME = 0x%02X\n", data);
+            Log::debug("[INTC:ARM9 ] Write8 @ IME = 0x%02X\n", data);
             
             ime9 = data & 1;
 
             checkInterrupt9();
             break;
         default:
-            std::printf("[INTC:ARM9 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
+            Log::error("[INTC:ARM9 ] Unhandled write8 @ 0x%08X = 0x%02X\n", addr, data);
 
             exit(0);
     }
@@ -224,14 +245,14 @@ void write8ARM9(u32 addr, u8 data) {
 void write16ARM9(u32 addr, u16 data) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM9 ] Write16 @ IME = 0x%04X\n", data);
+            Log::debug("[INTC:ARM9 ] Write16 @ IME = 0x%04X\n", data);
             
             ime9 = data & 1;
 
             checkInterrupt9();
             break;
         default:
-            std::printf("[INTC:ARM9 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[INTC:ARM9 ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
@@ -240,22 +261,22 @@ void write16ARM9(u32 addr, u16 data) {
 void write32ARM9(u32 addr, u32 data) {
     switch (addr) {
         case INTCReg::IME:
-            std::printf("[INTC:ARM9 ] Write32 @ IME = 0x%08X\n", data);
+            Log::debug("[INTC:ARM9 ] Write32 @ IME = 0x%08X\n", data);
             
             ime9 = data & 1;
             break;
         case INTCReg::IE:
-            std::printf("[INTC:ARM9 ] Write32 @ IE = 0x%08X\n", data);
+            Log::debug("[INTC:ARM9 ] Write32 @ IE = 0x%08X\n", data);
             
             ie9 = data;
             break;
         case INTCReg::IF:
-            std::printf("[INTC:ARM9 ] Write32 @ IF = 0x%08X\n", data);
+            Log::debug("[INTC:ARM9 ] Write32 @ IF = 0x%08X\n", data);
             
             if9 &= ~data;
             break;
         default:
-            std::printf("[INTC:ARM9 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[INTC:ARM9 ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
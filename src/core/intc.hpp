@@ -24,6 +24,8 @@ enum IntSource {
     WiFi,
 };
 
+void init();
+
 void sendInterrupt7(IntSource intSource);
 void sendInterrupt9(IntSource intSource);
 
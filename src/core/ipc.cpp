@@ -9,11 +9,15 @@
 #include <cstdio>
 #include <queue>
 
+#include "bus.hpp"
 #include "intc.hpp"
+#include "scheduler.hpp"
+#include "../common/log.hpp"
 
 namespace nds::ipc {
 
 using IntSource = intc::IntSource;
+using Log = logger::Logger<logger::Category::IPC>;
 
 // IPC constants
 
@@ -68,31 +72,56 @@ void clearSend(int idx) {
     otherCnt.rfull  = false;
 }
 
+/* Returns IPCSYNC as seen by one CPU */
+u16 readIPCSYNC(int idx) {
+    const auto &sync      = ipcsync[idx ^ 0];
+    const auto &otherSync = ipcsync[idx ^ 1];
+
+    u16 data = otherSync.out;
+
+    data |= (u16)sync.out   << 8;
+    data |= (u16)sync.irqen << 14;
+
+    return data;
+}
+
 void init() {
     clearSend(0);
     clearSend(1);
+
+    bus::registerRead16(7, static_cast<u32>(IPCReg::IPCSYNC), 0x10, &read16ARM7);
+    bus::registerRead16(9, static_cast<u32>(IPCReg::IPCSYNC), 0x10, &read16ARM9);
+
+    // IPCSYNC gets polled a lot, skip the register decoding
+    bus::registerRead16(7, static_cast<u32>(IPCReg::IPCSYNC), 2, [](u32) -> u16 {
+        scheduler::sync();
+        return readIPCSYNC(0);
+    });
+    bus::registerRead16(9, static_cast<u32>(IPCReg::IPCSYNC), 2, [](u32) -> u16 {
+        scheduler::sync();
+        return readIPCSYNC(1);
+    });
+
+    bus::registerWrite16(7, static_cast<u32>(IPCReg::IPCSYNC), 0x10, &write16ARM7);
+    bus::registerWrite32(7, static_cast<u32>(IPCReg::IPCSYNC), 0x10, &write32ARM7);
+    bus::registerWrite16(9, static_cast<u32>(IPCReg::IPCSYNC), 0x10, &write16ARM9);
+    bus::registerWrite32(9, static_cast<u32>(IPCReg::IPCSYNC), 0x10, &write32ARM9);
 }
 
 u16 read16ARM7(u32 addr) {
+    scheduler::sync();
+
     u16 data;
 
     switch (addr) {
         case static_cast<u32>(IPCReg::IPCSYNC):
-            {
-                //std::printf("[IPC:ARM7  ] Read16 @ IPCSYNC\n");
+            Log::debug("[IPC:ARM7  ] Read16 @ IPCSYNC\n");
 
-                auto &sync      = ipcsync[0];
-                auto &otherSync = ipcsync[1];
-
-                data = otherSync.out;
-
-                data |= (u16)sync.out   << 8;
-                data |= (u16)sync.irqen << 14;
-            }
+            data = readIPCSYNC(0);
             break;
         case static_cast<u32>(IPCReg::IPCFIFOCNT):
             {
-                std::printf("[IPC:ARM7  ] Read16 @ IPCFIFOCNT\n");
+                Log::debug("[IPC:ARM7  ] Read16 @ IPCFIFOCNT\n");
 
                 auto &cnt = ipcfifocnt[0];
 
@@ -107,7 +136,7 @@ u16 read16ARM7(u32 addr) {
             }
             break;
         default:
-            std::printf("[IPC:ARM7  ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[IPC:ARM7  ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -116,6 +145,8 @@ u16 read16ARM7(u32 addr) {
 }
 
 u32 readRECV7() {
+    scheduler::sync();
+
     auto &cnt = ipcfifocnt[0];
 
     auto &r = send[1];
@@ -149,25 +180,19 @@ u32 readRECV7() {
 }
 
 u16 read16ARM9(u32 addr) {
+    scheduler::sync();
+
     u16 data;
 
     switch (addr) {
         case static_cast<u32>(IPCReg::IPCSYNC):
-            {
-                //std::printf("[IPC:ARM9  ] Read16 @ IPCSYNC\n");
-
-                auto &sync      = ipcsync[1];
-                auto &otherSync = ipcsync[0];
-
-                data = otherSync.out;
+            Log::debug("[IPC:ARM9  ] Read16 @ IPCSYNC\n");
 
-                data |= (u16)sync.out   << 8;
-                data |= (u16)sync.irqen << 14;
-            }
+            data = readIPCSYNC(1);
             break;
         case static_cast<u32>(IPCReg::IPCFIFOCNT):
             {
-                std::printf("[IPC:ARM9  ] Read16 @ IPCFIFOCNT\n");
+                Log::debug("[IPC:ARM9  ] Read16 @ IPCFIFOCNT\n");
 
                 auto &cnt = ipcfifocnt[1];
 
@@ -182,7 +207,7 @@ u16 read16ARM9(u32 addr) {
             }
             break;
         default:
-            std::printf("[IPC:ARM9  ] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[IPC:ARM9  ] Unhandled read16 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -191,6 +216,8 @@ u16 read16ARM9(u32 addr) {
 }
 
 u32 readRECV9() {
+    scheduler::sync();
+
     auto &cnt = ipcfifocnt[1];
 
     auto &r = send[0];
@@ -224,10 +251,12 @@ u32 readRECV9() {
 }
 
 void write16ARM7(u32 addr, u16 data) {
+    scheduler::sync();
+
     switch (addr) {
         case static_cast<u32>(IPCReg::IPCSYNC):
             {
-                //std::printf("[IPC:ARM7  ] Write16 @ IPCSYNC = 0x%04X\n", data);
+                Log::debug("[IPC:ARM7  ] Write16 @ IPCSYNC = 0x%04X\n", data);
 
                 auto &sync      = ipcsync[0];
                 auto &otherSync = ipcsync[1];
@@ -240,7 +269,7 @@ void write16ARM7(u32 addr, u16 data) {
             break;
         case static_cast<u32>(IPCReg::IPCFIFOCNT):
             {
-                std::printf("[IPC:ARM7  ] Write16 @ IPCFIFOCNT = 0x%04X\n", data);
+                Log::debug("[IPC:ARM7  ] Write16 @ IPCFIFOCNT = 0x%04X\n", data);
 
                 auto &cnt = ipcfifocnt[0];
 
@@ -261,17 +290,19 @@ void write16ARM7(u32 addr, u16 data) {
             }
             break;
         default:
-            std::printf("[IPC:ARM7  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[IPC:ARM7  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
 }
 
 void write32ARM7(u32 addr, u32 data) {
+    scheduler::sync();
+
     switch (addr) {
         case static_cast<u32>(IPCReg::IPCFIFOSEND):
             {
-                std::printf("[IPC:ARM7  ] Write32 @ IPCFIFOSEND = 0x%08X\n", data);
+                Log::debug("[IPC:ARM7  ] Write32 @ IPCFIFOSEND = 0x%08X\n", data);
 
                 auto &cnt = ipcfifocnt[0];
 
@@ -300,17 +331,19 @@ void write32ARM7(u32 addr, u32 data) {
             }
             break;
         default:
-            std::printf("[IPC:ARM7  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[IPC:ARM7  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
 }
 
 void write16ARM9(u32 addr, u16 data) {
+    scheduler::sync();
+
     switch (addr) {
         case static_cast<u32>(IPCReg::IPCSYNC):
             {
-                //std::printf("[IPC:ARM9  ] Write16 @ IPCSYNC = 0x%04X\n", data);
+                Log::debug("[IPC:ARM9  ] Write16 @ IPCSYNC = 0x%04X\n", data);
 
                 auto &sync      = ipcsync[1];
                 auto &otherSync = ipcsync[0];
@@ -323,7 +356,7 @@ void write16ARM9(u32 addr, u16 data) {
             break;
         case static_cast<u32>(IPCReg::IPCFIFOCNT):
             {
-                std::printf("[IPC:ARM9  ] Write16 @ IPCFIFOCNT = 0x%04X\n", data);
+                Log::debug("[IPC:ARM9  ] Write16 @ IPCFIFOCNT = 0x%04X\n", data);
 
                 auto &cnt = ipcfifocnt[1];
 
@@ -344,17 +377,19 @@ void write16ARM9(u32 addr, u16 data) {
             }
             break;
         default:
-            std::printf("[IPC:ARM9  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[IPC:ARM9  ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
 
             exit(0);
     }
 }
 
 void write32ARM9(u32 addr, u32 data) {
+    scheduler::sync();
+
     switch (addr) {
         case static_cast<u32>(IPCReg::IPCFIFOSEND):
             {
-                std::printf("[IPC:ARM9  ] Write32 @ IPCFIFOSEND = 0x%08X\n", data);
+                Log::debug("[IPC:ARM9  ] Write32 @ IPCFIFOSEND = 0x%08X\n", data);
 
                 auto &cnt = ipcfifocnt[1];
 
@@ -383,7 +418,7 @@ void write32ARM9(u32 addr, u32 data) {
             }
             break;
         default:
-            std::printf("[IPC:ARM9  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[IPC:ARM9  ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
 
             exit(0);
     }
@@ -10,8 +10,13 @@
 #include <cstdio>
 #include <cstring>
 
+#include "bus.hpp"
+#include "../common/log.hpp"
+
 namespace nds::math {
 
+using Log = logger::Logger<logger::Category::Math>;
+
 // NDS Math registers
 enum class MathReg {
     DIVCNT     = 0x04000280,
@@ -163,25 +168,33 @@ void doSqrt() {
     }
 }
 
+void init() {
+    bus::registerRead16(9, static_cast<u32>(MathReg::DIVCNT), 0x40, &read16);
+    bus::registerRead32(9, static_cast<u32>(MathReg::DIVCNT), 0x40, &read32);
+
+    bus::registerWrite16(9, static_cast<u32>(MathReg::DIVCNT), 0x40, &write16);
+    bus::registerWrite32(9, static_cast<u32>(MathReg::DIVCNT), 0x40, &write32);
+}
+
 u16 read16(u32 addr) {
     u16 data;
 
     switch (addr) {
         case static_cast<u32>(MathReg::DIVCNT):
-            std::printf("[Math      ] Read16 @ DIVCNT\n");
+            Log::debug("[Math      ] Read16 @ DIVCNT\n");
 
             data  = (u16)divcnt.divmode;
             data |= (u16)divcnt.div0 << 14;
             data |= (u16)divcnt.busy << 15;
             break;
         case static_cast<u32>(MathReg::SQRTCNT):
-            std::printf("[Math      ] Read16 @ SQRTCNT\n");
+            Log::debug("[Math      ] Read16 @ SQRTCNT\n");
 
             data  = (u16)sqrtcnt.sqrtmode;
             data |= (u16)sqrtcnt.busy << 15;
             break;
         default:
-            std::printf("[Math      ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[Math      ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -194,47 +207,47 @@ u32 read32(u32 addr) {
 
     switch (addr) {
         case static_cast<u32>(MathReg::DIVCNT):
-            std::printf("[Math      ] Read32 @ DIVCNT\n");
+            Log::debug("[Math      ] Read32 @ DIVCNT\n");
 
             data  = (u32)divcnt.divmode;
             data |= (u32)divcnt.div0 << 14;
             data |= (u32)divcnt.busy << 15;
             break;
         case static_cast<u32>(MathReg::DIVNUMER):
-            std::printf("[Math      ] Read32 @ DIV_NUMER_L\n");
+            Log::debug("[Math      ] Read32 @ DIV_NUMER_L\n");
             return numer[0];
         case static_cast<u32>(MathReg::DIVNUMER) + 4:
-            std::printf("[Math      ] Read32 @ DIV_NUMER_H\n");
+            Log::debug("[Math      ] Read32 @ DIV_NUMER_H\n");
             return numer[1];
         case static_cast<u32>(MathReg::DIVDENOM):
-            std::printf("[Math      ] Read32 @ DIV_DENOM_L\n");
+            Log::debug("[Math      ] Read32 @ DIV_DENOM_L\n");
             return denom[0];
         case static_cast<u32>(MathReg::DIVDENOM) + 4:
-            std::printf("[Math      ] Read32 @ DIV_DENOM_H\n");
+            Log::debug("[Math      ] Read32 @ DIV_DENOM_H\n");
             return denom[1];
         case static_cast<u32>(MathReg::DIVRESULT):
-            std::printf("[Math      ] Read32 @ DIV_RESULT_L\n");
+            Log::debug("[Math      ] Read32 @ DIV_RESULT_L\n");
             return div[0];
         case static_cast<u32>(MathReg::DIVRESULT) + 4:
-            std::printf("[Math      ] Read32 @ DIV_RESULT_H\n");
+            Log::debug("[Math      ] Read32 @ DIV_RESULT_H\n");
             return div[1];
         case static_cast<u32>(MathReg::REMRESULT):
-            std::printf("[Math      ] Read32 @ REM_RESULT_L\n");
+            Log::debug("[Math      ] Read32 @ REM_RESULT_L\n");
             return rem[0];
         case static_cast<u32>(MathReg::REMRESULT) + 4:
-            std::printf("[Math      ] Read32 @ REM_RESULT_H\n");
+            Log::debug("[Math      ] Read32 @ REM_RESULT_H\n");
             return rem[1];
         case static_cast<u32>(MathReg::SQRTRESULT):
-            std::printf("[Math      ] Read32 @ SQRT_RESULT\n");
+            Log::debug("[Math      ] Read32 @ SQRT_RESULT\n");
             return result;
         case static_cast<u32>(MathReg::SQRTPARAM):
-            std::printf("[Math      ] Read32 @ SQRT_PARAM_L\n");
+            Log::debug("[Math      ] Read32 @ SQRT_PARAM_L\n");
             return param[0];
         case static_cast<u32>(MathReg::SQRTPARAM) + 4:
-            std::printf("[Math      ] Read32 @ SQRT_PARAM_H\n");
+            Log::debug("[Math      ] Read32 @ SQRT_PARAM_H\n");
             return param[1];
         default:
-            std::printf("[Math      ] Unhandled read32 @ 0x%08X\n", addr);
+            Log::error("[Math      ] Unhandled read32 @ 0x%08X\n", addr);
 
             exit(0);
     }
@@ -245,21 +258,21 @@ u32 read32(u32 addr) {
 void write16(u32 addr, u16 data) {
     switch (addr) {
         case static_cast<u32>(MathReg::DIVCNT):
-            std::printf("[Math      ] Write16 @ DIVCNT = 0x%04X\n", data);
+            Log::debug("[Math      ] Write16 @ DIVCNT = 0x%04X\n", data);
 
             divcnt.divmode = data & 3;
 
             doDiv();
             break;
         case static_cast<u32>(MathReg::SQRTCNT):
-            std::printf("[Math      ] Write16 @ SQRTCNT = 0x%04X\n", data);
+            Log::debug("[Math      ] Write16 @ SQRTCNT = 0x%04X\n", data);
 
             sqrtcnt.sqrtmode = data & 1;
 
             doSqrt();
             break;
         default:
-            std::printf("[Math      ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
+            Log::error("[Math      ] Unhandled write16 @ 0x%08X = 0x%04X\n", addr, data);
             
             exit(0);
     }
@@ -268,49 +281,49 @@ void write16(u32 addr, u16 data) {
 void write32(u32 addr, u32 data) {
     switch (addr) {
         case static_cast<u32>(MathReg::DIVNUMER):
-            std::printf("[Math      ] Write32 @ DIV_NUMER_L = 0x%08X\n", data);
+            Log::debug("[Math      ] Write32 @ DIV_NUMER_L = 0x%08X\n", data);
 
             numer[0] = data;
 
             doDiv();
             break;
         case static_cast<u32>(MathReg::DIVNUMER) + 4:
-            std::printf("[Math      ] Write32 @ DIV_NUMER_H = 0x%08X\n", data);
+            Log::debug("[Math      ] Write32 @ DIV_NUMER_H = 0x%08X\n", data);
 
             numer[1] = data;
 
             doDiv();
             break;
         case static_cast<u32>(MathReg::DIVDENOM):
-            std::printf("[Math      ] Write32 @ DIV_DENOM_L = 0x%08X\n", data);
+            Log::debug("[Math      ] Write32 @ DIV_DENOM_L = 0x%08X\n", data);
 
             denom[0] = data;
 
             doDiv();
             break;
         case static_cast<u32>(MathReg::DIVDENOM) + 4:
-            std::printf("[Math      ] Write32 @ DIV_DENOM_H = 0x%08X\n", data);
+            Log::debug("[Math      ] Write32 @ DIV_DENOM_H = 0x%08X\n", data);
 
             denom[1] = data;
 
             doDiv();
             break;
         case static_cast<u32>(MathReg::SQRTPARAM):
-            std::printf("[Math      ] Write32 @ SQRT_PARAM_L = 0x%08X\n", data);
+            Log::debug("[Math      ] Write32 @ SQRT_PARAM_L = 0x%08X\n", data);
 
             param[0] = data;
 
             doSqrt();
             break;
         case static_cast<u32>(MathReg::SQRTPARAM) + 4:
-            std::printf("[Math      ] Write32 @ SQRT_PARAM_H = 0x%08X\n", data);
+            Log::debug("[Math      ] Write32 @ SQRT_PARAM_H = 0x%08X\n", data);
 
             param[1] = data;
 
             doSqrt();
             break;
         default:
-            std::printf("[Math      ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
+            Log::error("[Math      ] Unhandled write32 @ 0x%08X = 0x%08X\n", addr, data);
             
             exit(0);
     }
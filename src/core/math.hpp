@@ -9,6 +9,8 @@
 
 namespace nds::math {
 
+void init();
+
 u16 read16(u32 addr);
 u32 read32(u32 addr);
 
@@ -5,16 +5,32 @@
 
 #include "ppu.hpp"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdio>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#include "bus.hpp"
+#include "fastmem.hpp"
 #include "intc.hpp"
 #include "MariDS.hpp"
 #include "scheduler.hpp"
+#include "tile.hpp"
+#include "../common/log.hpp"
 
 namespace nds::ppu {
 
 using IntSource = intc::IntSource;
+using Log = logger::Logger<logger::Category::PPU>;
+
+// Render thread (false = draw lines on the emulator thread). Opt-in, syncing on every VRAM write between lines costs more than it overlaps
+constexpr auto useRenderThread = false;
+
+// Tile cache (false = decode tile rows on every access)
+constexpr auto useTileCache = true;
 
 // PPU constants
 
@@ -23,12 +39,37 @@ constexpr i64 PIXELS_PER_HBLANK = 99;
 constexpr i64 LINES_PER_VDRAW   = 192;
 constexpr i64 LINES_PER_FRAME   = 263;
 
+constexpr u32 LINE_SIZE   = 2 * PIXELS_PER_HDRAW; // BGR555
+constexpr u32 SCREEN_SIZE = LINE_SIZE * LINES_PER_VDRAW;
+
+constexpr u64 LINE_BATCH = 16; // Lines queued before the render thread is woken up
+
 constexpr i64 CYCLES_PER_HDRAW    = 6 * PIXELS_PER_HDRAW;
 constexpr i64 CYCLES_PER_SCANLINE = 6 * (PIXELS_PER_HDRAW + PIXELS_PER_HBLANK);
 
 constexpr int OBJA_VRAM[] = { 0, 1, 4, 5, 6 };
 constexpr int  BGB_VRAM[] = { 2, 7, 8 };
 
+constexpr u32 LCDC_BASE[] = { 0x06800000, 0x06820000, 0x06840000, 0x06860000, 0x06880000, 0x06890000, 0x06894000, 0x06898000, 0x068A0000 };
+
+// VRAM mapping constants
+
+constexpr u32 VRAM_BASE = 0x06000000;
+constexpr u32 VRAM_SIZE = 0x00800000; // BG-A, BG-B, OBJ-A and OBJ-B, 2MB each
+constexpr u32 LCDC_SIZE = 0x000A4000;
+constexpr u32 WRAM_SIZE = 0x00040000; // ARM7, banks C and D
+
+constexpr u32 SLICE_SHIFT = 14;
+constexpr u32 SLICE_SIZE  = 1 << SLICE_SHIFT;
+
+constexpr int MAX_OVERLAP = 7; // Banks A-G can all be mapped to 0x06000000
+
+constexpr u32 BG_BASE[] = { 0x06000000, 0x06200000 };
+constexpr u32 BG_SIZE[] = { 0x00080000, 0x00020000 }; // Nothing is ever mapped past these
+
+constexpr u32 CACHE_PAGE_SHIFT = fastmem::DIRTY_PAGE_SHIFT;
+constexpr u32 CACHE_PAGE_SIZE  = 1 << CACHE_PAGE_SHIFT;
+
 
 // Display Engine registers
 
@@ -145,25 +186,70 @@ struct VRAMCNT {
 struct VRAMBank {
     VRAMCNT vramcnt;
 
-    std::vector<u8> data;
+    u8 *data;
+    u32 size;
 };
 
-// Tile stuff
-
-struct TileLine {
-    u16 tileBuf[8];
+/* Banks mapped to a 16KB slice of VRAM, more than one if banks overlap */
+struct VRAMSlice {
+    u8 *mem[MAX_OVERLAP];
 
-    u8 prios[8];
+    int count;
 };
 
 VRAMBank banks[9];
 
-u16 palette[2][2 * 256];
+// VRAM lookup tables, rebuilt on VRAMCNT writes
+VRAMSlice vramMap[VRAM_SIZE >> SLICE_SHIFT];
+VRAMSlice wramMap[WRAM_SIZE >> SLICE_SHIFT];
 
-std::vector<u8> fb;
+u8 *lcdcMap[LCDC_SIZE >> SLICE_SHIFT];
+
+u16 (*palette)[2 * 256];
+
+u8 *fb;
 
 DisplayEngine disp[2];
 
+// Scanline renderer state
+
+/* Registers latched at the start of a line */
+struct LineJob {
+    DisplayEngine disp[2];
+
+    int line;
+};
+
+// Renderer VRAM lookup tables and palette, point to the snapshot if the render thread is used
+VRAMSlice renderMap[VRAM_SIZE >> SLICE_SHIFT];
+
+u8 *renderLCDCMap[LCDC_SIZE >> SLICE_SHIFT];
+
+u16 (*renderPalette)[2 * 256];
+
+std::vector<u8> snapshot; // Copy of VRAM banks A-I and palette RAM
+
+u8 *liveBase, *renderBase;
+
+/* BG VRAM of a Display Engine as seen by the renderer, pages are decoded on first use */
+struct TileCache {
+    std::vector<u8>  raw;  // VRAM contents, used for screen entries and 8BPP tile rows
+    std::vector<u64> rows; // Expanded 4BPP tile rows, one per 4 bytes of VRAM
+
+    std::vector<u8> isValid; // Per page, cleared when a mapped bank is written or VRAMCNT changes
+};
+
+TileCache tileCache[2];
+
+std::vector<u64> dirtyPages; // Region offsets of written pages, sized for the largest region
+
+u32  snapshotGen;
+bool isMapDirty; // Set on VRAMCNT writes
+bool isThreaded;
+bool isCached;
+
+u8 linePrios[PIXELS_PER_HDRAW];
+
 DISPSTAT dispstat[2];
 
 u16 vcount;
@@ -173,7 +259,9 @@ u64 idHBLANK, idScanline;
 
 u16 readLCDC16(u32);
 
-void drawScreen();
+void initRenderer();
+void queueLine(int line);
+void finishFrame();
 
 void hblankEvent(i64 c) {
     (void)c;
@@ -209,15 +297,17 @@ void scanlineEvent(i64 c) {
             intc::sendInterrupt9(IntSource::VBLANK);
         }
 
-        drawScreen();
+        finishFrame();
 
-        update(fb.data());
+        update(fb);
     } else if (vcount == (LINES_PER_FRAME - 1)) {
         dispstat[0].vblank = dispstat[1].vblank = false; // Is turned off on the last scanline
     } else if (vcount == LINES_PER_FRAME) {
         vcount = 0;
     }
 
+    if (vcount < LINES_PER_VDRAW) queueLine(vcount);
+
     if (vcount == dispstat[0].lyc) {
         dispstat[0].vcounter = true;
 
@@ -237,1262 +327,943 @@ void scanlineEvent(i64 c) {
     scheduler::addEvent(idScanline, 0, CYCLES_PER_SCANLINE);
 }
 
-void init() {
-    vcount = 0;
+/* Returns DISPSTAT as seen by one CPU */
+u16 getDISPSTAT(int idx) {
+    u16 data;
 
-    idHBLANK   = scheduler::registerEvent([](int, i64 c) { hblankEvent  (c); });
-    idScanline = scheduler::registerEvent([](int, i64 c) { scanlineEvent(c); });
+    data  = (u16)dispstat[idx].vblank   << 0;
+    data |= (u16)dispstat[idx].hblank   << 1;
+    data |= (u16)dispstat[idx].vcounter << 2;
+    data |= (u16)dispstat[idx].virqen   << 3;
+    data |= (u16)dispstat[idx].hirqen   << 4;
+    data |= (u16)dispstat[idx].lycirqen << 5;
+    
+    return data | (dispstat[idx].lyc << 7);
+}
 
-    scheduler::addEvent(idHBLANK  , 0, CYCLES_PER_HDRAW);
-    scheduler::addEvent(idScanline, 0, CYCLES_PER_SCANLINE);
+/* Registers display and VRAM control MMIO handlers */
+void registerMMIO() {
+    constexpr u32 DISPA = 0x04000000, DISPB = 0x04001000;
 
-    // Initialize VRAM banks
+    // ARM7
+    bus::registerRead8(7, 0x04000240, 1, [](u32) -> u8 {
+        Log::debug("[Bus:ARM7  ] Read8 @ VRAMSTAT\n");
+        return readVRAMSTAT();
+    });
 
-    // Banks A-D are 128KB
-    banks[0].data.resize(0x20000);
-    banks[1].data.resize(0x20000);
-    banks[2].data.resize(0x20000);
-    banks[3].data.resize(0x20000);
+    bus::registerRead16(7, static_cast<u32>(PPUReg::DISPSTAT), 2, [](u32) -> u16 { return readDISPSTAT7(); });
+    bus::registerRead16(7, static_cast<u32>(PPUReg::VCOUNT  ), 2, [](u32) -> u16 { return readVCOUNT(); });
 
-    // Bank E is 64KB
-    banks[4].data.resize(0x10000);
+    bus::registerWrite16(7, static_cast<u32>(PPUReg::DISPSTAT), 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM7  ] Write16 @ DISPSTAT = 0x%04X\n", data);
+        writeDISPSTAT7(data);
+    });
 
-    // Bank H is 32KB
-    banks[7].data.resize(0x8000);
+    // ARM9
+    bus::registerRead16(9, DISPA, 0x70, [](u32 addr) -> u16 { return read16(0, addr); });
+    bus::registerRead16(9, DISPB, 0x70, [](u32 addr) -> u16 { return read16(1, addr); });
 
-    // Banks F-G, I are 16 KB
-    banks[5].data.resize(0x4000);
-    banks[6].data.resize(0x4000);
-    banks[8].data.resize(0x4000);
+    // DISPSTAT and VCOUNT get polled a lot, skip the register decoding
+    for (const auto base : {DISPA, DISPB}) {
+        bus::registerRead16(9, base + 4, 2, [](u32) -> u16 { return getDISPSTAT(1); });
+        bus::registerRead16(9, base + 6, 2, [](u32) -> u16 { return readVCOUNT(); });
+    }
 
-    fb.resize(0x30000);
-}
+    bus::registerRead32(9, DISPA, 0x70, [](u32 addr) -> u32 { return read32(0, addr); });
+    bus::registerRead32(9, DISPB, 0x70, [](u32 addr) -> u32 { return read32(1, addr); });
 
-u8 readVRAMCNT(int bank) {
-    const auto &cnt = banks[bank].vramcnt;
+    bus::registerRead32(9, 0x04000240, 4, [](u32) -> u32 {
+        Log::debug("[Bus:ARM9  ] Read32 @ VRAMCNT_A/B/C/D\n");
 
-    u8 data;
+        u32 data;
 
-    data  =     cnt.mst;
-    data |=     cnt.ofs    << 3;
-    data |= (u8)cnt.vramen << 7;
+        data  = (u32)readVRAMCNT(0);
+        data |= (u32)readVRAMCNT(1) <<  8;
+        data |= (u32)readVRAMCNT(2) << 16;
+        data |= (u32)readVRAMCNT(3) << 24;
 
-    return data;
-}
+        return data;
+    });
 
-u8 readVRAMSTAT() {
-    u8 data = 0;
+    bus::registerWrite8(9, DISPA, 0x70, [](u32 addr, u8 data) { write8(0, addr, data); });
+    bus::registerWrite8(9, DISPB, 0x70, [](u32 addr, u8 data) { write8(1, addr, data); });
 
-    const auto &cnt2 = banks[2].vramcnt;
-    const auto &cnt3 = banks[3].vramcnt;
+    bus::registerWrite8(9, 0x04000240, 7, [](u32 addr, u8 data) {
+        const auto idx = addr - 0x04000240;
 
-    if (cnt2.vramen && (cnt2.mst == 2)) data |= 1;
-    if (cnt3.vramen && (cnt3.mst == 2)) data |= 2;
+        Log::debug("[Bus:ARM9  ] Write8 @ VRAMCNT_%c = 0x%02X\n", 'A' + idx, data);
 
-    return data;
-}
+        writeVRAMCNT(idx, data);
+    });
+    bus::registerWrite8(9, 0x04000248, 2, [](u32 addr, u8 data) {
+        const auto idx = 7 + (addr - 0x04000248);
 
-void writeVRAMCNT(int bank, u8 data) {
-    auto &cnt = banks[bank].vramcnt;
+        Log::debug("[Bus:ARM9  ] Write8 @ VRAMCNT_%c = 0x%02X\n", 'A' + idx, data);
 
-    cnt.mst = (data >> 0) & 7;
-    cnt.ofs = (data >> 3) & 3;
+        writeVRAMCNT(idx, data);
+    });
 
-    cnt.vramen = data & (1 << 7);
-}
+    bus::registerWrite16(9, DISPA, 0x70, [](u32 addr, u16 data) { write16(0, addr, data); });
+    bus::registerWrite16(9, DISPB, 0x70, [](u32 addr, u16 data) { write16(1, addr, data); });
 
-u8 readVRAM8(u32 addr) {
-    u8 data = 0;
+    bus::registerWrite16(9, 0x04000248, 2, [](u32, u16 data) {
+        Log::debug("[Bus:ARM9  ] Write16 @ VRAMCNT_H/I = 0x%04X\n", data);
 
-    switch (addr & ~0x1FFFFF) {
-        case 0x06000000: // Display Engine A, BG-VRAM
-            {
-                for (int i = 0; i < 7; i++) { // Banks A-G
-                    auto &b = banks[i];
+        writeVRAMCNT(7, data);
+        writeVRAMCNT(8, data >> 8);
+    });
 
-                    auto &cnt = b.vramcnt;
+    bus::registerWrite32(9, DISPA, 0x70, [](u32 addr, u32 data) { write32(0, addr, data); });
+    bus::registerWrite32(9, DISPB, 0x70, [](u32 addr, u32 data) { write32(1, addr, data); });
 
-                    if (!cnt.vramen || (cnt.mst != 1)) continue;
+    bus::registerWrite32(9, 0x04000240, 4, [](u32, u32 data) {
+        Log::debug("[Bus:ARM9  ] Write32 @ VRAMCNT_A/B/C/D = 0x%08X\n", data);
 
-                    // Get bank address
-                    u32 bankAddr = 0x06000000;
+        writeVRAMCNT(0, data);
+        writeVRAMCNT(1, data >>  8);
+        writeVRAMCNT(2, data >> 16);
+        writeVRAMCNT(3, data >> 24);
+    });
+}
 
-                    switch (i) {
-                        case 0: case 1: case 2: case 3:
-                            bankAddr += 0x20000 * cnt.ofs;
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+/* Adds a bank to the slices starting at addr */
+void mapBank(VRAMSlice *map, u32 addr, VRAMBank &b) {
+    for (u32 i = 0; i < b.size; i += SLICE_SIZE) {
+        auto &s = map[(addr + i) >> SLICE_SHIFT];
 
-                    const auto limit = b.data.size() - 1;
+        assert(s.count < MAX_OVERLAP);
 
-                    if (bankAddr == (addr & ~limit)) data |= b.data[addr & limit];
-                }
-            }
-            break;
-        case 0x06200000: // Display Engine B, BG-VRAM
-            {
-                for (auto i : BGB_VRAM) {
-                    auto &b = banks[i];
+        s.mem[s.count++] = &b.data[i];
+    }
+}
 
-                    auto &cnt = b.vramcnt;
+/* Rebuilds the VRAM lookup tables, required if a VRAMCNT register changes */
+void remapVRAM() {
+    std::memset(vramMap, 0, sizeof(vramMap));
+    std::memset(wramMap, 0, sizeof(wramMap));
+    std::memset(lcdcMap, 0, sizeof(lcdcMap));
 
-                    if (!cnt.vramen) continue;
+    for (int i = 0; i < 9; i++) {
+        auto &b = banks[i];
 
-                    if (((i == 2) && (cnt.mst != 4)) || ((i > 7) && (cnt.mst != 1))) continue;
+        const auto &cnt = b.vramcnt;
 
-                    // Get bank address
-                    u32 bankAddr = 0x06200000;
+        if (!cnt.vramen) continue;
 
-                    if (i == 8) bankAddr += 0x8000;
+        for (u32 j = 0; j < b.size; j += SLICE_SIZE) lcdcMap[(LCDC_BASE[i] - LCDC_BASE[0] + j) >> SLICE_SHIFT] = &b.data[j];
 
-                    const auto limit = b.data.size() - 1;
+        // Display Engine A, BG-VRAM (banks A-G)
+        if ((i < 7) && (cnt.mst == 1)) {
+            u32 bankAddr = 0x06000000;
 
-                    if (bankAddr == (addr & ~limit)) data |= b.data[addr & limit];
-                }
+            switch (i) {
+                case 0: case 1: case 2: case 3:
+                    bankAddr += 0x20000 * cnt.ofs;
+                    break;
+                case 5: case 6:
+                    bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
+                    break;
+                case 4:
+                default:
+                    break;
             }
-            break;
-        case 0x06400000: // Display Engine A, OBJ-VRAM
-            {
-                for (auto i : OBJA_VRAM) { // Banks A-G
-                    auto &b = banks[i];
 
-                    auto &cnt = b.vramcnt;
+            mapBank(vramMap, bankAddr - VRAM_BASE, b);
+        }
 
-                    if (!cnt.vramen || (cnt.mst != 2)) continue;
+        // Display Engine B, BG-VRAM (banks C, H, I)
+        if (((i == 2) && (cnt.mst == 4)) || (i == 7) || ((i == 8) && (cnt.mst == 1))) {
+            u32 bankAddr = 0x06200000;
 
-                    // Get bank address
-                    u32 bankAddr = 0x06400000;
+            if (i == 8) bankAddr += 0x8000;
 
-                    switch (i) {
-                        case 0: case 1:
-                            bankAddr += 0x20000 * (cnt.ofs & 1);
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+            mapBank(vramMap, bankAddr - VRAM_BASE, b);
+        }
 
-                    const auto limit = b.data.size() - 1;
+        // Display Engine A, OBJ-VRAM (banks A, B, E-G)
+        if (((i < 2) || ((i >= 4) && (i < 7))) && (cnt.mst == 2)) {
+            u32 bankAddr = 0x06400000;
 
-                    if (bankAddr == (addr & ~limit)) data |= b.data[addr & limit];
-                }
+            switch (i) {
+                case 0: case 1:
+                    bankAddr += 0x20000 * (cnt.ofs & 1);
+                    break;
+                case 5: case 6:
+                    bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
+                    break;
+                case 4:
+                default:
+                    break;
             }
-            break;
-        case 0x06600000: // Display Engine B OBJ-VRAM
-            {
-                for (int i = 3; i < 9; i += 5) { // Banks D, I
-                    auto &b = banks[i];
-
-                    auto &cnt = b.vramcnt;
 
-                    if (!cnt.vramen) continue;
-
-                    if (((i == 3) && (cnt.mst != 4)) || ((i == 8) && (cnt.mst != 2))) continue;
-
-                    // Get bank address
-                    const u32 bankAddr = 0x06600000;
-
-                    const auto limit = b.data.size() - 1;
+            mapBank(vramMap, bankAddr - VRAM_BASE, b);
+        }
 
-                    if (bankAddr == (addr & ~limit)) data |= b.data[addr & limit];
-                }
-            }
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled VRAM read8 @ 0x%08X\n", addr);
+        // Display Engine B, OBJ-VRAM (banks D, I)
+        if (((i == 3) && (cnt.mst == 4)) || ((i == 8) && (cnt.mst == 2))) mapBank(vramMap, 0x06600000 - VRAM_BASE, b);
 
-            exit(0);
+        // ARM7 WRAM (banks C, D)
+        if (((i == 2) || (i == 3)) && (cnt.ofs < 2)) mapBank(wramMap, 0x20000 * cnt.ofs, b);
     }
 
-    return data;
+    isMapDirty = true;
 }
 
-u16 readVRAM16(u32 addr) {
-    u16 data = 0;
-
-    switch (addr & ~0x1FFFFF) {
-        case 0x06000000: // Display Engine A, BG-VRAM
-            {
-                for (int i = 0; i < 7; i++) { // Banks A-G
-                    auto &b = banks[i];
-
-                    auto &cnt = b.vramcnt;
-
-                    if (!cnt.vramen || (cnt.mst != 1)) continue;
-
-                    // Get bank address
-                    u32 bankAddr = 0x06000000;
-
-                    switch (i) {
-                        case 0: case 1: case 2: case 3:
-                            bankAddr += 0x20000 * cnt.ofs;
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
-
-                    const auto limit = b.data.size() - 1;
+void init() {
+    vcount = 0;
 
-                    if (bankAddr == (addr & ~limit)) {
-                        u16 tmp;
+    registerMMIO();
 
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u16));
+    idHBLANK   = scheduler::registerEvent([](void *, int, i64 c) { hblankEvent  (c); }, NULL);
+    idScanline = scheduler::registerEvent([](void *, int, i64 c) { scanlineEvent(c); }, NULL);
 
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        case 0x06200000: // Display Engine B, BG-VRAM
-            {
-                for (auto i : BGB_VRAM) {
-                    auto &b = banks[i];
+    scheduler::addEvent(idHBLANK  , 0, CYCLES_PER_HDRAW);
+    scheduler::addEvent(idScanline, 0, CYCLES_PER_SCANLINE);
 
-                    auto &cnt = b.vramcnt;
+    // Initialize VRAM banks, sizes come from the guest memory arena (A-D 128KB, E 64KB, F-G 16KB, H 32KB, I 16KB)
+    for (int i = 0; i < 9; i++) {
+        const auto &info = fastmem::getRegionInfo((fastmem::Region)(static_cast<int>(fastmem::Region::VRAMA) + i));
 
-                    if (!cnt.vramen) continue;
+        banks[i].data = info.mem;
+        banks[i].size = info.size;
+    }
 
-                    if (((i == 2) && (cnt.mst != 4)) || ((i > 7) && (cnt.mst != 1))) continue;
+    palette = (u16 (*)[2 * 256])fastmem::getMemory(fastmem::Region::Palette);
 
-                    // Get bank address
-                    u32 bankAddr = 0x06200000;
+    fb = fastmem::getMemory(fastmem::Region::FB);
 
-                    if (i == 8) bankAddr += 0x8000;
+    remapVRAM();
 
-                    const auto limit = b.data.size() - 1;
+    tile::init();
 
-                    if (bankAddr == (addr & ~limit)) {
-                        u16 tmp;
+    initRenderer();
+}
 
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u16));
+u8 readVRAMCNT(int bank) {
+    const auto &cnt = banks[bank].vramcnt;
 
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        case 0x06400000: // Display Engine A, OBJ-VRAM
-            {
-                for (auto i : OBJA_VRAM) { // Banks A-G
-                    auto &b = banks[i];
+    u8 data;
 
-                    auto &cnt = b.vramcnt;
+    data  =     cnt.mst;
+    data |=     cnt.ofs    << 3;
+    data |= (u8)cnt.vramen << 7;
 
-                    if (!cnt.vramen || (cnt.mst != 2)) continue;
+    return data;
+}
 
-                    // Get bank address
-                    u32 bankAddr = 0x06400000;
+u8 readVRAMSTAT() {
+    u8 data = 0;
 
-                    switch (i) {
-                        case 0: case 1:
-                            bankAddr += 0x20000 * (cnt.ofs & 1);
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+    const auto &cnt2 = banks[2].vramcnt;
+    const auto &cnt3 = banks[3].vramcnt;
 
-                    const auto limit = b.data.size() - 1;
+    if (cnt2.vramen && (cnt2.mst == 2)) data |= 1;
+    if (cnt3.vramen && (cnt3.mst == 2)) data |= 2;
 
-                    if (bankAddr == (addr & ~limit)) {
-                        u16 tmp;
+    return data;
+}
 
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u16));
+void writeVRAMCNT(int bank, u8 data) {
+    auto &cnt = banks[bank].vramcnt;
 
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        case 0x06600000: // Display Engine B OBJ-VRAM
-            {
-                for (int i = 3; i < 9; i += 5) { // Banks D, I
-                    auto &b = banks[i];
+    cnt.mst = (data >> 0) & 7;
+    cnt.ofs = (data >> 3) & 3;
 
-                    auto &cnt = b.vramcnt;
+    cnt.vramen = data & (1 << 7);
 
-                    if (!cnt.vramen) continue;
+    remapVRAM();
 
-                    if (((i == 3) && (cnt.mst != 4)) || ((i == 8) && (cnt.mst != 2))) continue;
+    bus::remapLCDC();
+}
 
-                    // Get bank address
-                    const u32 bankAddr = 0x06600000;
+/* Returns the slice an engine VRAM address is in */
+const VRAMSlice &getSlice(u32 addr) {
+    return vramMap[(addr & (VRAM_SIZE - 1)) >> SLICE_SHIFT];
+}
 
-                    const auto limit = b.data.size() - 1;
+/* Reads from all banks mapped to a slice, overlapping banks are ORed together */
+template<typename T>
+T readSlice(const VRAMSlice &s, u32 addr) {
+    const auto offset = addr & (SLICE_SIZE - 1);
 
-                    if (bankAddr == (addr & ~limit)) {
-                        u16 tmp;
+    T data = 0;
 
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u16));
+    for (int i = 0; i < s.count; i++) {
+        T tmp;
 
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled VRAM read32 @ 0x%08X\n", addr);
+        std::memcpy(&tmp, &s.mem[i][offset], sizeof(T));
 
-            exit(0);
+        data |= tmp;
     }
 
     return data;
 }
 
-u32 readVRAM32(u32 addr) {
-    u32 data = 0;
-
-    switch (addr & ~0x1FFFFF) {
-        case 0x06000000: // Display Engine A, BG-VRAM
-            {
-                for (int i = 0; i < 7; i++) { // Banks A-G
-                    auto &b = banks[i];
-
-                    auto &cnt = b.vramcnt;
-
-                    if (!cnt.vramen || (cnt.mst != 1)) continue;
+/* Writes to all banks mapped to a slice and marks the pages dirty */
+template<typename T>
+void writeSlice(const VRAMSlice &s, u32 addr, T data) {
+    const auto offset = addr & (SLICE_SIZE - 1);
 
-                    // Get bank address
-                    u32 bankAddr = 0x06000000;
+    for (int i = 0; i < s.count; i++) {
+        std::memcpy(&s.mem[i][offset], &data, sizeof(T));
 
-                    switch (i) {
-                        case 0: case 1: case 2: case 3:
-                            bankAddr += 0x20000 * cnt.ofs;
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
-
-                    const auto limit = b.data.size() - 1;
-
-                    if (bankAddr == (addr & ~limit)) {
-                        u32 tmp;
-
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u32));
-
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        case 0x06200000: // Display Engine B, BG-VRAM
-            {
-                for (auto i : BGB_VRAM) {
-                    auto &b = banks[i];
-
-                    auto &cnt = b.vramcnt;
-
-                    if (!cnt.vramen) continue;
-
-                    if (((i == 2) && (cnt.mst != 4)) || ((i > 7) && (cnt.mst != 1))) continue;
-
-                    // Get bank address
-                    u32 bankAddr = 0x06200000;
-
-                    if (i == 8) bankAddr += 0x8000;
-
-                    const auto limit = b.data.size() - 1;
-
-                    if (bankAddr == (addr & ~limit)) {
-                        u32 tmp;
-
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u32));
-
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        case 0x06400000: // Display Engine A, OBJ-VRAM
-            {
-                for (auto i : OBJA_VRAM) { // Banks A-G
-                    auto &b = banks[i];
-
-                    auto &cnt = b.vramcnt;
-
-                    if (!cnt.vramen || (cnt.mst != 2)) continue;
+        fastmem::markDirty(&s.mem[i][offset]);
+    }
+}
 
-                    // Get bank address
-                    u32 bankAddr = 0x06400000;
+/* Returns a host pointer to LCDC VRAM, NULL if the bank is disabled */
+u8 *getLCDCPointer(u32 addr) {
+    if ((addr < LCDC_BASE[0]) || (addr >= (LCDC_BASE[0] + LCDC_SIZE))) return NULL;
 
-                    switch (i) {
-                        case 0: case 1:
-                            bankAddr += 0x20000 * (cnt.ofs & 1);
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+    const auto mem = lcdcMap[(addr - LCDC_BASE[0]) >> SLICE_SHIFT];
 
-                    const auto limit = b.data.size() - 1;
+    return (mem != NULL) ? &mem[addr & (SLICE_SIZE - 1)] : NULL;
+}
 
-                    if (bankAddr == (addr & ~limit)) {
-                        u32 tmp;
+/* Returns a host pointer to engine VRAM, NULL if no bank or more than one bank is mapped to the slice */
+u8 *getVRAMPointer(u32 addr) {
+    if ((addr & ~(VRAM_SIZE - 1)) != VRAM_BASE) return NULL;
 
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u32));
+    const auto &s = getSlice(addr);
 
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        case 0x06600000: // Display Engine B OBJ-VRAM
-            {
-                for (int i = 3; i < 9; i += 5) { // Banks D, I
-                    auto &b = banks[i];
+    return (s.count == 1) ? &s.mem[0][addr & (SLICE_SIZE - 1)] : NULL;
+}
 
-                    auto &cnt = b.vramcnt;
+/* Returns a host pointer to palette RAM (2KB, engine A then engine B) */
+u8 *getPalettePointer(u32 addr) {
+    return &((u8 *)palette)[addr & 0x7FF];
+}
 
-                    if (!cnt.vramen) continue;
+u8 readVRAM8(u32 addr) {
+    if ((addr & ~(VRAM_SIZE - 1)) != VRAM_BASE) {
+        Log::error("[PPU       ] Unhandled VRAM read8 @ 0x%08X\n", addr);
 
-                    if (((i == 3) && (cnt.mst != 4)) || ((i == 8) && (cnt.mst != 2))) continue;
+        exit(0);
+    }
 
-                    // Get bank address
-                    const u32 bankAddr = 0x06600000;
+    return readSlice<u8>(getSlice(addr), addr);
+}
 
-                    const auto limit = b.data.size() - 1;
+u16 readVRAM16(u32 addr) {
+    if ((addr & ~(VRAM_SIZE - 1)) != VRAM_BASE) {
+        Log::error("[PPU       ] Unhandled VRAM read16 @ 0x%08X\n", addr);
 
-                    if (bankAddr == (addr & ~limit)) {
-                        u32 tmp;
+        exit(0);
+    }
 
-                        std::memcpy(&tmp, &b.data[addr & limit], sizeof(u32));
+    return readSlice<u16>(getSlice(addr), addr);
+}
 
-                        data |= tmp;
-                    }
-                }
-            }
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled VRAM read32 @ 0x%08X\n", addr);
+u32 readVRAM32(u32 addr) {
+    if ((addr & ~(VRAM_SIZE - 1)) != VRAM_BASE) {
+        Log::error("[PPU       ] Unhandled VRAM read32 @ 0x%08X\n", addr);
 
-            exit(0);
+        exit(0);
     }
 
-    return data;
+    return readSlice<u32>(getSlice(addr), addr);
 }
 
-
 u32 readWRAM32(u32 addr) { // For ARM7
-    u32 data = 0;
-
-    const auto bankAddr = addr & 0x20000;
-
-    addr &= 0x1FFFF;
-
-    for (int i = 2; i < 4; i++) {
-        const auto &b = banks[i];
-
-        assert(b.vramcnt.ofs < 2);
-
-        if (b.vramcnt.vramen && ((0x20000 * b.vramcnt.ofs) == bankAddr)) {
-            u32 tmp;
-
-            std::memcpy(&tmp, &b.data[addr], sizeof(u32));
-
-            data |= tmp;
-        }
-    }
-
-    return data;
+    return readSlice<u32>(wramMap[(addr & (WRAM_SIZE - 1)) >> SLICE_SHIFT], addr);
 }
 
 u8 readLCDC8(u32 addr) {
     u8 data = 0;
-    
-    VRAMBank *b;
 
-    // Select bank;
-    switch (addr & ~0x3FFF) {
-        case 0x06800000: case 0x06804000: case 0x06808000: case 0x0680C000:
-        case 0x06810000: case 0x06814000: case 0x06818000: case 0x0681C000:
-            b = &banks[0];
-            break;
-        case 0x06820000: case 0x06824000: case 0x06828000: case 0x0682C000:
-        case 0x06830000: case 0x06834000: case 0x06838000: case 0x0683C000:
-            b = &banks[1];
-            break;
-        case 0x06840000: case 0x06844000: case 0x06848000: case 0x0684C000:
-        case 0x06850000: case 0x06854000: case 0x06858000: case 0x0685C000:
-            b = &banks[2];
-            break;
-        case 0x06860000: case 0x06864000: case 0x06868000: case 0x0686C000:
-        case 0x06870000: case 0x06874000: case 0x06878000: case 0x0687C000:
-            b = &banks[3];
-            break;
-        case 0x06880000: case 0x06884000: case 0x06888000: case 0x0688C000:
-            b = &banks[4];
-            break;
-        case 0x06890000:
-            b = &banks[5];
-            break;
-        case 0x06894000:
-            b = &banks[6];
-            break;
-        case 0x06898000: case 0x0689C000:
-            b = &banks[7];
-            break;
-        case 0x068A0000:
-            b = &banks[8];
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled LCDC read8 @ 0x%08X\n", addr);
+    if ((addr < LCDC_BASE[0]) || (addr >= (LCDC_BASE[0] + LCDC_SIZE))) {
+        Log::error("[PPU       ] Unhandled LCDC read8 @ 0x%08X\n", addr);
 
-            exit(0);
+        exit(0);
     }
 
-    if (b->vramcnt.vramen) data = b->data[addr & (b->data.size() - 1)];
+    if (const auto mem = getLCDCPointer(addr); mem != NULL) data = *mem;
 
     return data;
 }
 
 u16 readLCDC16(u32 addr) {
     u16 data = 0;
-    
-    VRAMBank *b;
 
-    // Select bank;
-    switch (addr & ~0x3FFF) {
-        case 0x06800000: case 0x06804000: case 0x06808000: case 0x0680C000:
-        case 0x06810000: case 0x06814000: case 0x06818000: case 0x0681C000:
-            b = &banks[0];
-            break;
-        case 0x06820000: case 0x06824000: case 0x06828000: case 0x0682C000:
-        case 0x06830000: case 0x06834000: case 0x06838000: case 0x0683C000:
-            b = &banks[1];
-            break;
-        case 0x06840000: case 0x06844000: case 0x06848000: case 0x0684C000:
-        case 0x06850000: case 0x06854000: case 0x06858000: case 0x0685C000:
-            b = &banks[2];
-            break;
-        case 0x06860000: case 0x06864000: case 0x06868000: case 0x0686C000:
-        case 0x06870000: case 0x06874000: case 0x06878000: case 0x0687C000:
-            b = &banks[3];
-            break;
-        case 0x06880000: case 0x06884000: case 0x06888000: case 0x0688C000:
-            b = &banks[4];
-            break;
-        case 0x06890000:
-            b = &banks[5];
-            break;
-        case 0x06894000:
-            b = &banks[6];
-            break;
-        case 0x06898000: case 0x0689C000:
-            b = &banks[7];
-            break;
-        case 0x068A0000:
-            b = &banks[8];
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled LCDC read16 @ 0x%08X\n", addr);
+    if ((addr < LCDC_BASE[0]) || (addr >= (LCDC_BASE[0] + LCDC_SIZE))) {
+        Log::error("[PPU       ] Unhandled LCDC read16 @ 0x%08X\n", addr);
 
-            exit(0);
+        exit(0);
     }
 
-    if (b->vramcnt.vramen) std::memcpy(&data, &b->data[addr & (b->data.size() - 1)], sizeof(u16));
+    if (const auto mem = getLCDCPointer(addr); mem != NULL) std::memcpy(&data, mem, sizeof(u16));
 
     return data;
 }
 
 u32 readLCDC32(u32 addr) {
     u32 data = 0;
-    
-    VRAMBank *b;
 
-    // Select bank;
-    switch (addr & ~0x3FFF) {
-        case 0x06800000: case 0x06804000: case 0x06808000: case 0x0680C000:
-        case 0x06810000: case 0x06814000: case 0x06818000: case 0x0681C000:
-            b = &banks[0];
-            break;
-        case 0x06820000: case 0x06824000: case 0x06828000: case 0x0682C000:
-        case 0x06830000: case 0x06834000: case 0x06838000: case 0x0683C000:
-            b = &banks[1];
-            break;
-        case 0x06840000: case 0x06844000: case 0x06848000: case 0x0684C000:
-        case 0x06850000: case 0x06854000: case 0x06858000: case 0x0685C000:
-            b = &banks[2];
-            break;
-        case 0x06860000: case 0x06864000: case 0x06868000: case 0x0686C000:
-        case 0x06870000: case 0x06874000: case 0x06878000: case 0x0687C000:
-            b = &banks[3];
-            break;
-        case 0x06880000: case 0x06884000: case 0x06888000: case 0x0688C000:
-            b = &banks[4];
-            break;
-        case 0x06890000:
-            b = &banks[5];
-            break;
-        case 0x06894000:
-            b = &banks[6];
-            break;
-        case 0x06898000: case 0x0689C000:
-            b = &banks[7];
-            break;
-        case 0x068A0000:
-            b = &banks[8];
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled LCDC read32 @ 0x%08X\n", addr);
+    if ((addr < LCDC_BASE[0]) || (addr >= (LCDC_BASE[0] + LCDC_SIZE))) {
+        Log::error("[PPU       ] Unhandled LCDC read32 @ 0x%08X\n", addr);
 
-            exit(0);
+        exit(0);
     }
 
-    if (b->vramcnt.vramen) std::memcpy(&data, &b->data[addr & (b->data.size() - 1)], sizeof(u32));
+    if (const auto mem = getLCDCPointer(addr); mem != NULL) std::memcpy(&data, mem, sizeof(u32));
 
     return data;
 }
 
 void writeVRAM16(u32 addr, u16 data) {
-    switch (addr & ~0x1FFFFF) {
-        case 0x06000000: // Display Engine A, BG-VRAM
-            {
-                for (int i = 0; i < 7; i++) { // Banks A-G
-                    auto &b = banks[i];
+    if ((addr & ~(VRAM_SIZE - 1)) != VRAM_BASE) {
+        Log::error("[PPU       ] Unhandled VRAM write16 @ 0x%08X = 0x%04X\n", addr, data);
 
-                    auto &cnt = b.vramcnt;
+        exit(0);
+    }
 
-                    if (!cnt.vramen || (cnt.mst != 1)) continue;
+    writeSlice(getSlice(addr), addr, data);
+}
 
-                    // Get bank address
-                    u32 bankAddr = 0x06000000;
+void writeVRAM32(u32 addr, u32 data) {
+    if ((addr & ~(VRAM_SIZE - 1)) != VRAM_BASE) {
+        Log::error("[PPU       ] Unhandled VRAM write32 @ 0x%08X = 0x%08X\n", addr, data);
 
-                    switch (i) {
-                        case 0: case 1: case 2: case 3:
-                            bankAddr += 0x20000 * cnt.ofs;
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+        exit(0);
+    }
 
-                    const auto limit = b.data.size() - 1;
+    writeSlice(getSlice(addr), addr, data);
+}
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u16));
-                }
-            }
-            break;
-        case 0x06200000: // Display Engine B, BG-VRAM
-            {
-                for (auto i : BGB_VRAM) {
-                    auto &b = banks[i];
+void writeWRAM32(u32 addr, u32 data) { // For ARM7
+    writeSlice(wramMap[(addr & (WRAM_SIZE - 1)) >> SLICE_SHIFT], addr, data);
+}
 
-                    auto &cnt = b.vramcnt;
+void writeLCDC8(u32 addr, u8 data) {
+    Log::error("[PPU       ] Unhandled LCDC write8 @ 0x%08X = 0x%02X\n", addr, data);
 
-                    if (!cnt.vramen) continue;
+    exit(0);
+}
 
-                    if (((i == 2) && (cnt.mst != 4)) || ((i > 7) && (cnt.mst != 1))) continue;
+void writeLCDC16(u32 addr, u16 data) {
+    if ((addr < LCDC_BASE[0]) || (addr >= (LCDC_BASE[0] + LCDC_SIZE))) {
+        Log::error("[PPU       ] Unhandled LCDC write16 @ 0x%08X = 0x%04X\n", addr, data);
 
-                    // Get bank address
-                    u32 bankAddr = 0x06200000;
+        exit(0);
+    }
 
-                    if (i == 8) bankAddr += 0x8000;
+    if (const auto mem = getLCDCPointer(addr); mem != NULL) {
+        std::memcpy(mem, &data, sizeof(u16));
 
-                    const auto limit = b.data.size() - 1;
+        fastmem::markDirty(mem);
+    }
+}
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u16));
-                }
-            }
-            break;
-        case 0x06400000: // Display Engine A, OBJ-VRAM
-            {
-                for (auto i : OBJA_VRAM) { // Banks A-G
-                    auto &b = banks[i];
+void writeLCDC32(u32 addr, u32 data) {
+    if ((addr < LCDC_BASE[0]) || (addr >= (LCDC_BASE[0] + LCDC_SIZE))) {
+        Log::error("[PPU       ] Unhandled LCDC write32 @ 0x%08X = 0x%08X\n", addr, data);
 
-                    auto &cnt = b.vramcnt;
+        exit(0);
+    }
 
-                    if (!cnt.vramen || (cnt.mst != 2)) continue;
+    if (const auto mem = getLCDCPointer(addr); mem != NULL) {
+        std::memcpy(mem, &data, sizeof(u32));
 
-                    // Get bank address
-                    u32 bankAddr = 0x06400000;
+        fastmem::markDirty(mem);
+    }
+}
 
-                    switch (i) {
-                        case 0: case 1:
-                            bankAddr += 0x20000 * (cnt.ofs & 1);
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+void writePal16(u32 addr, u16 data) {
+    const bool pal = addr & (1 << 10);
 
-                    const auto limit = b.data.size() - 1;
+    std::memcpy(&palette[pal][(addr >> 1) & 0x1FF], &data, sizeof(u16));
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u16));
-                }
-            }
-            break;
-        case 0x06600000: // Display Engine B OBJ-VRAM
-            {
-                for (int i = 3; i < 9; i += 5) { // Banks D, I
-                    auto &b = banks[i];
+    fastmem::markDirty((u8 *)&palette[pal][(addr >> 1) & 0x1FF]);
+}
 
-                    auto &cnt = b.vramcnt;
+void writePal32(u32 addr, u32 data) {
+    const bool pal = addr & (1 << 10);
 
-                    if (!cnt.vramen) continue;
+    std::memcpy(&palette[pal][(addr >> 1) & 0x1FF], &data, sizeof(u32));
 
-                    if (((i == 3) && (cnt.mst != 4)) || ((i == 8) && (cnt.mst != 2))) continue;
+    fastmem::markDirty((u8 *)&palette[pal][(addr >> 1) & 0x1FF]);
+}
 
-                    // Get bank address
-                    const u32 bankAddr = 0x06600000;
+/* Reads VRAM as seen by the renderer */
+template<typename T>
+T readRender(u32 addr) {
+    return readSlice<T>(renderMap[(addr & (VRAM_SIZE - 1)) >> SLICE_SHIFT], addr);
+}
 
-                    const auto limit = b.data.size() - 1;
+/* Decodes a page of a Display Engine's BG VRAM */
+void fillTilePage(int idx, u32 page) {
+    auto &c = tileCache[idx];
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u16));
-                }
-            }
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled VRAM write16 @ 0x%08X = 0x%04X\n", addr, data);
+    const u32 start = page << CACHE_PAGE_SHIFT;
 
-            exit(0);
-    }
-}
+    for (u32 addr = start; addr < (start + CACHE_PAGE_SIZE); addr += 4) {
+        const auto data = readRender<u32>(BG_BASE[idx] + addr);
 
-void writeVRAM32(u32 addr, u32 data) {
-    switch (addr & ~0x1FFFFF) {
-        case 0x06000000: // Display Engine A, BG-VRAM
-            {
-                for (int i = 0; i < 7; i++) { // Banks A-G
-                    auto &b = banks[i];
+        std::memcpy(&c.raw[addr], &data, sizeof(u32));
 
-                    auto &cnt = b.vramcnt;
+        c.rows[addr >> 2] = tile::expand4BPP(data);
+    }
 
-                    if (!cnt.vramen || (cnt.mst != 1)) continue;
+    c.isValid[page] = true;
+}
 
-                    // Get bank address
-                    u32 bankAddr = 0x06000000;
+/* Returns true if addr is backed by the tile cache, decodes its page if needed */
+bool fetchTilePage(int idx, u32 addr) {
+    if (addr >= BG_SIZE[idx]) return false;
 
-                    switch (i) {
-                        case 0: case 1: case 2: case 3:
-                            bankAddr += 0x20000 * cnt.ofs;
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+    if (!tileCache[idx].isValid[addr >> CACHE_PAGE_SHIFT]) fillTilePage(idx, addr >> CACHE_PAGE_SHIFT);
 
-                    const auto limit = b.data.size() - 1;
+    return true;
+}
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u32));
-                }
-            }
-            break;
-        case 0x06200000: // Display Engine B, BG-VRAM
-            {
-                for (auto i : BGB_VRAM) {
-                    auto &b = banks[i];
+/* Reads BG VRAM as seen by the renderer, addr is relative to the Display Engine's BG VRAM */
+template<typename T>
+T readBG(int idx, u32 addr) {
+    if (!isCached) return readRender<T>(BG_BASE[idx] + addr);
 
-                    auto &cnt = b.vramcnt;
+    if (!fetchTilePage(idx, addr)) return 0;
 
-                    if (!cnt.vramen) continue;
+    T data;
 
-                    if (((i == 2) && (cnt.mst != 4)) || ((i > 7) && (cnt.mst != 1))) continue;
+    std::memcpy(&data, &tileCache[idx].raw[addr], sizeof(T));
 
-                    // Get bank address
-                    u32 bankAddr = 0x06200000;
+    return data;
+}
 
-                    if (i == 8) bankAddr += 0x8000;
+/* Returns a tile row with one palette index per byte */
+u64 getTileRow(int idx, u32 charBase, int num, int tileY, bool pal256, bool flipX) {
+    u64 pixels;
 
-                    const auto limit = b.data.size() - 1;
+    if (pal256) {
+        pixels = readBG<u64>(idx, charBase + 64 * num + 8 * tileY);
+    } else {
+        const u32 addr = charBase + 32 * num + 4 * tileY;
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u32));
-                }
-            }
-            break;
-        case 0x06400000: // Display Engine A, OBJ-VRAM
-            {
-                for (auto i : OBJA_VRAM) { // Banks A-G
-                    auto &b = banks[i];
+        if (!isCached) {
+            pixels = tile::expand4BPP(readRender<u32>(BG_BASE[idx] + addr));
+        } else {
+            pixels = (fetchTilePage(idx, addr)) ? tileCache[idx].rows[addr >> 2] : 0;
+        }
+    }
 
-                    auto &cnt = b.vramcnt;
+    return (flipX) ? tile::flipRow(pixels) : pixels;
+}
 
-                    if (!cnt.vramen || (cnt.mst != 2)) continue;
+/* Invalidates cached pages that renderer memory [mem;mem+size) is mapped to */
+void invalidateTiles(const u8 *mem, u32 size) {
+    for (int idx = 0; idx < 2; idx++) {
+        const auto map = &renderMap[(BG_BASE[idx] - VRAM_BASE) >> SLICE_SHIFT];
 
-                    // Get bank address
-                    u32 bankAddr = 0x06400000;
+        for (u32 i = 0; i < (BG_SIZE[idx] >> SLICE_SHIFT); i++) {
+            for (int j = 0; j < map[i].count; j++) {
+                const auto sliceMem = map[i].mem[j];
 
-                    switch (i) {
-                        case 0: case 1:
-                            bankAddr += 0x20000 * (cnt.ofs & 1);
-                            break;
-                        case 5: case 6:
-                            bankAddr += 0x10000 * (cnt.ofs >> 1) + 0x4000 * (cnt.ofs & 1);
-                            break;
-                        case 4:
-                        default:
-                            break;
-                    }
+                if ((mem >= (sliceMem + SLICE_SIZE)) || ((mem + size) <= sliceMem)) continue;
 
-                    const auto limit = b.data.size() - 1;
+                const u32 start = (SLICE_SIZE * i) + std::max<i64>(mem - sliceMem, 0);
+                const u32 end   = (SLICE_SIZE * i) + std::min<i64>(mem + size - sliceMem, SLICE_SIZE);
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u32));
+                for (auto page = start >> CACHE_PAGE_SHIFT; page <= ((end - 1) >> CACHE_PAGE_SHIFT); page++) {
+                    tileCache[idx].isValid[page] = false;
                 }
             }
-            break;
-        case 0x06600000: // Display Engine B OBJ-VRAM
-            {
-                for (int i = 3; i < 9; i += 5) { // Banks D, I
-                    auto &b = banks[i];
-
-                    auto &cnt = b.vramcnt;
+        }
+    }
+}
 
-                    if (!cnt.vramen) continue;
+/* Invalidates all cached pages */
+void flushTiles() {
+    for (auto &c : tileCache) std::fill(c.isValid.begin(), c.isValid.end(), 0);
+}
 
-                    if (((i == 3) && (cnt.mst != 4)) || ((i == 8) && (cnt.mst != 2))) continue;
+/* Returns a Display Engine's framebuffer row */
+u16 *getRow(int idx, int line) {
+    return (u16 *)&fb[SCREEN_SIZE * idx + LINE_SIZE * line];
+}
 
-                    // Get bank address
-                    const u32 bankAddr = 0x06600000;
+/* Draws one line of a Display Engine into its framebuffer row */
+void drawDE(const DisplayEngine &d, int idx, int line) {
+    const auto &cnt = d.dispcnt;
 
-                    const auto limit = b.data.size() - 1;
+    auto row = getRow(idx, line);
 
-                    if (bankAddr == (addr & ~limit)) std::memcpy(&b.data[addr & limit], &data, sizeof(u32));
-                }
-            }
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled VRAM write32 @ 0x%08X = 0x%08X\n", addr, data);
+    if (cnt.forcedblank) { // Draw white pixels
+        std::memset(row, 0xFF, LINE_SIZE);
 
-            exit(0);
+        return;
     }
-}
 
-void writeWRAM32(u32 addr, u32 data) { // For ARM7
-    const auto bankAddr = addr & 0x20000;
+    std::memset(row, 0, LINE_SIZE);
+    std::memset(linePrios, 5, sizeof(linePrios));
 
-    addr &= 0x1FFFF;
+    for (int i = 3; i >= 0; i--) {
+        if (!cnt.bgen[i]) continue;
 
-    for (int i = 2; i < 4; i++) {
-        auto &b = banks[i];
+        const auto &bgcnt = d.bgcnt[i];
 
-        assert(b.vramcnt.ofs < 2);
+        u32 charBase = 0x4000 * bgcnt.charbase;
+        u32 scrBase  = 0x800  * bgcnt.scrbase;
 
-        if (b.vramcnt.vramen && ((0x20000 * b.vramcnt.ofs) == bankAddr)) std::memcpy(&b.data[addr], &data, sizeof(u32));
-    }
-}
+        if (!idx) {
+            charBase += 0x10000 * cnt.charbase;
+            scrBase  += 0x10000 * cnt.scrbase;
+        }
 
-void writeLCDC8(u32 addr, u8 data) {
-    std::printf("[PPU       ] Unhandled LCDC write8 @ 0x%08X = 0x%02X\n", addr, data);
+        const auto hofs = d.bghofs[i];
+        const auto vofs = d.bgvofs[i];
 
-    exit(0);
-}
+        auto drawX = -(int)(hofs % 8);
+        auto gridX =  (int)(hofs / 8);
 
-void writeLCDC16(u32 addr, u16 data) {
-    VRAMBank *b;
+        const auto tileY = (line + vofs) % 8;
+        const auto gridY = (line + vofs) / 8;
 
-    // Select bank;
-    switch (addr & ~0x3FFF) {
-        case 0x06800000: case 0x06804000: case 0x06808000: case 0x0680C000:
-        case 0x06810000: case 0x06814000: case 0x06818000: case 0x0681C000:
-            b = &banks[0];
-            break;
-        case 0x06820000: case 0x06824000: case 0x06828000: case 0x0682C000:
-        case 0x06830000: case 0x06834000: case 0x06838000: case 0x0683C000:
-            b = &banks[1];
-            break;
-        case 0x06840000: case 0x06844000: case 0x06848000: case 0x0684C000:
-        case 0x06850000: case 0x06854000: case 0x06858000: case 0x0685C000:
-            b = &banks[2];
-            break;
-        case 0x06860000: case 0x06864000: case 0x06868000: case 0x0686C000:
-        case 0x06870000: case 0x06874000: case 0x06878000: case 0x0687C000:
-            b = &banks[3];
-            break;
-        case 0x06880000: case 0x06884000: case 0x06888000: case 0x0688C000:
-            b = &banks[4];
-            break;
-        case 0x06890000:
-            b = &banks[5];
-            break;
-        case 0x06894000:
-            b = &banks[6];
-            break;
-        case 0x06898000: case 0x0689C000:
-            b = &banks[7];
-            break;
-        case 0x068A0000:
-            b = &banks[8];
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled LCDC write16 @ 0x%08X = 0x%04X\n", addr, data);
+        const auto scrX = (gridX / 32) % 2;
+        const auto scrY = (gridY / 32) % 2;
 
-            exit(0);
-    }
+        u32 base = scrBase + 64 * (gridY % 32);
 
-    if (b->vramcnt.vramen) std::memcpy(&b->data[addr & (b->data.size() - 1)], &data, sizeof(u16));
-}
+        gridX %= 32;
 
-u16 getColor4BPP(int disp, int pal, int num) {
-    u16 data;
+        u32 baseAdjust;
 
-    std::memcpy(&data, &palette[disp][16 * pal + num], sizeof(u16));
+        switch (bgcnt.scrsize) {
+            case 0:
+                baseAdjust = 0;
+                break;
+            case 1:
+                baseAdjust = 2048;
 
-    return data;
-}
+                base += 2048 * scrX;
+                break;
+            case 2:
+                baseAdjust = 0;
 
-u16 getColor8BPP(int disp, int num) {
-    u16 data;
+                base += 2048 * scrY;
+                break;
+            case 3:
+                baseAdjust = 2048;
 
-    std::memcpy(&data, &palette[disp][num], sizeof(u16));
+                base += 2048 * scrX + 4096 * scrY;
+                break;
+        }
 
-    return data;
-}
+        if (scrX == 1) baseAdjust *= -1;
 
-void writePal16(u32 addr, u16 data) {
-    const bool pal = addr & (1 << 10);
+        do {
+            do {
+                const auto offset = base + 2 * gridX;
 
-    std::memcpy(&palette[pal][(addr >> 1) & 0x1FF], &data, sizeof(u16));
-}
+                ++gridX;
 
-void writePal32(u32 addr, u32 data) {
-    const bool pal = addr & (1 << 10);
+                const auto entry = readBG<u16>(idx, offset);
 
-    std::memcpy(&palette[pal][(addr >> 1) & 0x1FF], &data, sizeof(u32));
-}
+                const auto num = entry & 0x3FF;
+                const auto pal = entry >> 12;
 
-void decode4BPP(int d, TileLine &tileLine, u32 baseAddr, u32 charBase, int pal, int num, int tileY, bool flipX) {
-    const u32 base = baseAddr + charBase + 32 * num + 4 * tileY;
+                const bool flipX = entry & (1 << 10);
+                const bool flipY = entry & (1 << 11);
 
-    if (flipX) {
-        for (auto x = 0; x < 4; x++) {
-            const auto tile = readVRAM8(base + x);
+                const auto _tileY = (flipY) ? (tileY ^ 7) & 7 : tileY;
 
-            const auto p0 = tile & 0xF;
-            const auto p1 = tile >> 4;
+                const auto pixels = getTileRow(idx, charBase, num, _tileY, bgcnt.pal256, flipX);
 
-            const auto flip1 = ((2 * x + 0) ^ 7) & 0xF;
-            const auto flip2 = ((2 * x + 1) ^ 7) & 0xF;
+                const u8 palBase = (bgcnt.pal256) ? 0 : 16 * pal;
 
-            const auto col0 = getColor4BPP(d, pal, p0);
-            const auto col1 = getColor4BPP(d, pal, p1);
+                if ((drawX >= 0) && (drawX <= 248)) {
+                    tile::drawRow(&row[drawX], &linePrios[drawX], renderPalette[idx], pixels, palBase, bgcnt.prio);
+                } else {
+                    tile::drawRowClipped(row, linePrios, renderPalette[idx], pixels, palBase, bgcnt.prio, drawX);
+                }
 
-            if (!p0) tileLine.prios[flip1] = 5;
-            if (!p1) tileLine.prios[flip2] = 5;
+                drawX += 8;
+            } while ((gridX < 32) && (drawX < 256));
 
-            std::memcpy(&tileLine.tileBuf[flip1], &col0, sizeof(u16));
-            std::memcpy(&tileLine.tileBuf[flip2], &col1, sizeof(u16));
-        }
-    } else {
-        for (auto x = 0; x < 4; x++) {
-            const auto tile = readVRAM8(base + x);
+            base += baseAdjust;
 
-            const auto p0 = tile & 15;
-            const auto p1 = tile >> 4;
+            baseAdjust *= -1;
 
-            const auto flip1 = 2 * x + 0;
-            const auto flip2 = 2 * x + 1;
+            gridX = 0;
+        } while (drawX < 256);
+    }
+}
 
-            const auto col0 = getColor4BPP(d, pal, p0);
-            const auto col1 = getColor4BPP(d, pal, p1);
+/* Draws one line of an LCDC bank into Display Engine A's framebuffer row */
+void drawLCDC(int b, int line) {
+    auto row = getRow(0, line);
 
-            if (!p0) tileLine.prios[flip1] = 5;
-            if (!p1) tileLine.prios[flip2] = 5;
+    const auto offset = 0x20000 * b + LINE_SIZE * line;
 
-            std::memcpy(&tileLine.tileBuf[flip1], &col0, sizeof(u16));
-            std::memcpy(&tileLine.tileBuf[flip2], &col1, sizeof(u16));
-        }
+    // Lines never cross a 16KB slice
+    if (const auto mem = renderLCDCMap[offset >> SLICE_SHIFT]; mem != NULL) {
+        std::memcpy(row, &mem[offset & (SLICE_SIZE - 1)], LINE_SIZE);
+    } else {
+        std::memset(row, 0, LINE_SIZE);
     }
 }
 
-void decode8BPP(int d, TileLine &tileLine, u32 baseAddr, u32 charBase, int num, int tileY, bool flipX) {
-    const u32 base = baseAddr + charBase + 64 * num + 8 * tileY;
+/* Draws one visible line of both Display Engines, display modes are checked in queueLine */
+void drawLine(const LineJob &job) {
+    const auto line = job.line;
 
-    if (flipX) {
-        for (auto x = 7; x > 0; x--) {
-            const auto tile = readVRAM8(base + x);
+    const auto &cnta = job.disp[0].dispcnt;
+    const auto &cntb = job.disp[1].dispcnt;
 
-            const auto col = getColor8BPP(d, tile);
+    // Draw Display Engine A
+    switch (cnta.dispmode) {
+        case 0: // Display off
+            std::memset(getRow(0, line), 0xFF, LINE_SIZE);
+            break;
+        case 1: // Normal display
+            drawDE(job.disp[0], 0, line);
+            break;
+        case 2: // VRAM display
+            drawLCDC(cnta.bselect, line);
+            break;
+    }
 
-            if (!tile) tileLine.prios[x] = 5;
+    // Draw Display Engine B
+    switch (cntb.dispmode) {
+        case 0: // Display off
+            std::memset(getRow(1, line), 0xFF, LINE_SIZE);
+            break;
+        case 1: // Normal display
+            drawDE(job.disp[1], 1, line);
+            break;
+    }
+}
 
-            std::memcpy(&tileLine.tileBuf[x], &col, sizeof(u16));
-        }
-    } else {
-        for (auto x = 0; x < 7; x++) {
-            const auto tile = readVRAM8(base + x);
+/* Draws queued lines on a worker thread, in order */
+struct RenderThread {
+    ~RenderThread() {
+        if (thread.joinable()) {
+            {
+                std::lock_guard lock(mtx);
 
-            const auto col = getColor8BPP(d, tile);
+                isRunning = false;
+            }
 
-            if (!tile) tileLine.prios[x] = 5;
+            hasWork.notify_one();
 
-            std::memcpy(&tileLine.tileBuf[x], &col, sizeof(u16));
+            thread.join();
         }
     }
-}
 
-void drawDE(int idx) {
-    const u32 baseAddr = (idx) ? 0x06200000 : 0x06000000;
+    void start() {
+        if (!thread.joinable()) thread = std::thread([this] { run(); });
+    }
 
-    const u32 fbBaseAddr = (idx) ? 0x18000 : 0;
+    void push(const LineJob &job) {
+        bool isBatchFull;
 
-    const auto &d = disp[idx];
+        {
+            std::lock_guard lock(mtx);
 
-    const auto &cnt = d.dispcnt;
+            assert((queued - done) < LINES_PER_VDRAW);
 
-    if (cnt.forcedblank) { // Draw white pixels
-        std::memset(&fb[fbBaseAddr], 0xFF, 0x18000);
+            jobs[queued++ % LINES_PER_VDRAW] = job;
 
-        return;
+            isBatchFull = !(queued % LINE_BATCH);
+        }
+
+        // Waking the thread costs about as much as drawing a line
+        if (isBatchFull) hasWork.notify_one();
     }
 
-    u16 tmpFB[192][256];
+    /* Waits until all queued lines are drawn */
+    void wait() {
+        std::unique_lock lock(mtx);
 
-    u8 prios[192][256];
+        if (done == queued) return;
 
-    std::memset(tmpFB, 0, sizeof(tmpFB));
-    std::memset(prios, 5, sizeof(prios));
+        hasWork.notify_one();
 
-    for (int i = 3; i >= 0; i--) {
-        if (!cnt.bgen[i]) continue;
+        isIdle.wait(lock, [this] { return done == queued; });
+    }
 
-        const auto &bgcnt = d.bgcnt[i];
+private:
+    void run() {
+        while (true) {
+            LineJob job;
 
-        u32 charBase = 0x4000 * bgcnt.charbase;
-        u32 scrBase  = 0x800  * bgcnt.scrbase;
+            {
+                std::unique_lock lock(mtx);
 
-        if (!idx) {
-            charBase += 0x10000 * cnt.charbase;
-            scrBase  += 0x10000 * cnt.scrbase;
-        }
+                hasWork.wait(lock, [this] { return !isRunning || (done != queued); });
 
-        const auto hofs = d.bghofs[i];
-        const auto vofs = d.bgvofs[i];
+                if (done == queued) return;
 
-        for (int line = 0; line < 192; line++) {
-            auto drawX = -(int)(hofs % 8);
-            auto gridX =  (int)(hofs / 8);
+                job = jobs[done % LINES_PER_VDRAW];
+            }
 
-            const auto tileY = (line + vofs) % 8;
-            const auto gridY = (line + vofs) / 8;
+            drawLine(job);
 
-            const auto scrX = (gridX / 32) % 2;
-            const auto scrY = (gridY / 32) % 2;
+            {
+                std::lock_guard lock(mtx);
 
-            u32 base = scrBase + 64 * (gridY % 32);
+                done++;
+            }
 
-            gridX %= 32;
+            isIdle.notify_one();
+        }
+    }
 
-            u32 baseAdjust;
+    std::thread thread;
 
-            switch (bgcnt.scrsize) {
-                case 0:
-                    baseAdjust = 0;
-                    break;
-                case 1:
-                    baseAdjust = 2048;
+    std::mutex mtx;
+    std::condition_variable hasWork, isIdle;
 
-                    base += 2048 * scrX;
-                    break;
-                case 2:
-                    baseAdjust = 0;
+    LineJob jobs[LINES_PER_VDRAW];
 
-                    base += 2048 * scrY;
-                    break;
-                case 3:
-                    baseAdjust = 2048;
+    u64 queued = 0, done = 0;
 
-                    base += 2048 * scrX + 4096 * scrY;
-                    break;
-            }
+    bool isRunning = true;
+};
 
-            if (scrX == 1) baseAdjust *= -1;
+// Defined after the renderer state, so that it is destroyed (and joined) first
+RenderThread renderThread;
 
-            do {
-                do {
-                    const auto offset = base + 2 * gridX;
+/* Translates a host pointer to VRAM or palette RAM to renderer memory */
+u8 *toRender(u8 *mem) {
+    return (mem != NULL) ? renderBase + (mem - liveBase) : NULL;
+}
+
+/* Returns true if VRAM or palette RAM were written since the last snapshot */
+bool isSnapshotDirty() {
+    for (auto r = static_cast<int>(fastmem::Region::VRAMA); r <= static_cast<int>(fastmem::Region::Palette); r++) {
+        if (fastmem::isDirty((fastmem::Region)r, snapshotGen)) return true;
+    }
+
+    return false;
+}
+
+/* Copies all VRAM and palette pages written since the last snapshot, and drops their cached tiles */
+void updateSnapshot() {
+    for (auto r = static_cast<int>(fastmem::Region::VRAMA); r <= static_cast<int>(fastmem::Region::Palette); r++) {
+        const auto &info = fastmem::getRegionInfo((fastmem::Region)r);
 
-                    ++gridX;
+        const auto count = fastmem::getDirtyPages((fastmem::Region)r, snapshotGen, dirtyPages.data());
 
-                    const auto tile = readVRAM16(baseAddr + offset);
+        for (u64 i = 0; i < count; i++) {
+            const auto offset = dirtyPages[i];
 
-                    const auto num = tile & 0x3FF;
-                    const auto pal = tile >> 12;
+            const auto mem  = toRender(&info.mem[offset]);
+            const auto size = std::min(fastmem::DIRTY_PAGE_SIZE, info.size - offset);
 
-                    const bool flipX = tile & (1 << 10);
-                    const bool flipY = tile & (1 << 11);
+            if (isThreaded) std::memcpy(mem, &info.mem[offset], size);
+
+            if (isCached) invalidateTiles(mem, size);
+        }
+    }
 
-                    const auto _tileY = (flipY) ? (tileY ^ 7) & 7 : tileY;
+    snapshotGen = fastmem::newGeneration();
+}
 
-                    TileLine tileLine;
+/* Brings renderer memory and lookup tables up to date, waits for the render thread if they change */
+void syncRenderer() {
+    const auto isDirty = (isThreaded || isCached) && isSnapshotDirty();
 
-                    std::memset(tileLine.prios, bgcnt.prio, sizeof(tileLine.prios));
+    if (!isDirty && !isMapDirty) return;
 
-                    if (bgcnt.pal256) {
-                        decode8BPP(idx, tileLine, baseAddr, charBase, num, _tileY, flipX);
-                    } else {
-                        decode4BPP(idx, tileLine, baseAddr, charBase, pal, num, _tileY, flipX);
-                    }
+    if (isThreaded) renderThread.wait();
 
-                    if ((drawX >= 0) && (drawX <= 248)) {
-                        for (int x = 0; x < 8; x++) {
-                            if (tileLine.prios[x] <= prios[line][drawX + x]) {
-                                prios[line][drawX + x] = tileLine.prios[x];
+    if (isDirty) updateSnapshot();
 
-                                tmpFB[line][drawX + x] = tileLine.tileBuf[x];
-                            }
-                        }
+    if (isMapDirty) {
+        for (u32 i = 0; i < (VRAM_SIZE >> SLICE_SHIFT); i++) {
+            auto &s = renderMap[i];
 
-                        drawX += 8;
-                    } else {
-                        int x   = 0;
-                        int max = 8;
+            s = vramMap[i];
 
-                        if (drawX < 0) {
-                            x = -drawX;
+            for (int j = 0; j < s.count; j++) s.mem[j] = toRender(s.mem[j]);
+        }
 
-                            drawX = 0;
+        for (u32 i = 0; i < (LCDC_SIZE >> SLICE_SHIFT); i++) renderLCDCMap[i] = toRender(lcdcMap[i]);
 
-                            for (; x < max; x++) {
-                                if (tileLine.prios[x] <= prios[line][drawX]) {
-                                    prios[line][drawX] = tileLine.prios[x];
+        flushTiles();
 
-                                    tmpFB[line][drawX++] = tileLine.tileBuf[x];
-                                }
-                            }
-                        } else if (drawX > 248) {
-                            max -= drawX - 248;
+        isMapDirty = false;
+    }
+}
 
-                            for (; x < max; x++) {
-                                if (tileLine.prios[x] <= prios[line][drawX]) {
-                                    prios[line][drawX] = tileLine.prios[x];
+/* Latches the registers of a visible line and draws it, on the render thread if it is used */
+void queueLine(int line) {
+    LineJob job;
 
-                                    tmpFB[line][drawX++] = tileLine.tileBuf[x];
-                                }
-                            }
-                        }
-                    }
-                } while (gridX < 32);
+    job.disp[0] = disp[0];
+    job.disp[1] = disp[1];
 
-                base += baseAdjust;
+    job.line = line;
 
-                baseAdjust *= -1;
+    if (job.disp[0].dispcnt.dispmode > 2) {
+        Log::error("[DISPA     ] Unhandled display mode %u\n", job.disp[0].dispcnt.dispmode);
 
-                gridX = 0;
-            } while (drawX < 256);
-        }
+        exit(0);
     }
 
-    std::memcpy(&fb[fbBaseAddr], (u8 *)tmpFB, 0x18000);
-}
+    if (job.disp[1].dispcnt.dispmode > 1) {
+        Log::error("[DISPB     ] Unhandled display mode %u\n", job.disp[1].dispcnt.dispmode);
+
+        exit(0);
+    }
 
-void drawLCDC(int b) {
-    for (int i = 0; i < 0x18000; i += 4) {
-        const auto data = readLCDC32(0x06800000 + 0x20000 * b + i);
+    syncRenderer();
 
-        std::memcpy(&fb[i], &data, sizeof(4));
+    if (isThreaded) {
+        renderThread.push(job);
+    } else {
+        drawLine(job);
     }
 }
 
-void drawScreen() {
-    const auto &cnta = disp[0].dispcnt;
-    const auto &cntb = disp[1].dispcnt;
+/* Waits for the current frame to be drawn */
+void finishFrame() {
+    if (isThreaded) renderThread.wait();
+}
 
-    // Draw Display Engine A
-    switch (cnta.dispmode) {
-        case 0: // Display off
-            std::memset(&fb[0], 0xFF, 0x18000);
-            break;
-        case 1: // Normal display
-            drawDE(0);
-            break;
-        case 2: // VRAM display
-            drawLCDC(cnta.bselect);
-            break;
-        default:
-            std::printf("[DISPA     ] Unhandled display mode %u\n", cnta.dispmode);
+void initRenderer() {
+    finishFrame();
 
-            exit(0);
+    const auto &vramInfo = fastmem::getRegionInfo(fastmem::Region::VRAMA);
+    const auto &palInfo  = fastmem::getRegionInfo(fastmem::Region::Palette);
+
+    liveBase = vramInfo.mem;
+
+    // Stores through the fastmem arenas don't mark pages dirty, the snapshot and tile cache would go stale
+    isThreaded = useRenderThread && !fastmem::isEnabled();
+    isCached   = useTileCache    && !fastmem::isEnabled();
+
+    u64 maxPages = 0;
+
+    for (auto r = static_cast<int>(fastmem::Region::VRAMA); r <= static_cast<int>(fastmem::Region::Palette); r++) {
+        maxPages = std::max(maxPages, fastmem::getPageCount((fastmem::Region)r));
     }
 
-    // Draw Display Engine B
-    switch (cntb.dispmode) {
-        case 0: // Display off
-            std::memset(&fb[0x18000], 0xFF, 0x18000);
-            break;
-        case 1: // Normal display
-            drawDE(1);
-            break;
-        default:
-            std::printf("[DISPB     ] Unhandled display mode %u\n", cnta.dispmode);
+    dirtyPages.resize(maxPages);
 
-            exit(0);
+    snapshotGen = fastmem::newGeneration();
+
+    if (isThreaded) {
+        snapshot.assign(liveBase, palInfo.mem + palInfo.size);
+
+        renderBase = snapshot.data();
+
+        renderThread.start();
+    } else {
+        renderBase = liveBase;
     }
-}
 
-void writeLCDC32(u32 addr, u32 data) {
-    VRAMBank *b;
+    renderPalette = (u16 (*)[2 * 256])toRender((u8 *)palette);
 
-    // Select bank;
-    switch (addr & ~0x3FFF) {
-        case 0x06800000: case 0x06804000: case 0x06808000: case 0x0680C000:
-        case 0x06810000: case 0x06814000: case 0x06818000: case 0x0681C000:
-            b = &banks[0];
-            break;
-        case 0x06820000: case 0x06824000: case 0x06828000: case 0x0682C000:
-        case 0x06830000: case 0x06834000: case 0x06838000: case 0x0683C000:
-            b = &banks[1];
-            break;
-        case 0x06840000: case 0x06844000: case 0x06848000: case 0x0684C000:
-        case 0x06850000: case 0x06854000: case 0x06858000: case 0x0685C000:
-            b = &banks[2];
-            break;
-        case 0x06860000: case 0x06864000: case 0x06868000: case 0x0686C000:
-        case 0x06870000: case 0x06874000: case 0x06878000: case 0x0687C000:
-            b = &banks[3];
-            break;
-        case 0x06880000: case 0x06884000: case 0x06888000: case 0x0688C000:
-            b = &banks[4];
-            break;
-        case 0x06890000:
-            b = &banks[5];
-            break;
-        case 0x06894000:
-            b = &banks[6];
-            break;
-        case 0x06898000: case 0x0689C000:
-            b = &banks[7];
-            break;
-        case 0x068A0000:
-            b = &banks[8];
-            break;
-        default:
-            std::printf("[PPU       ] Unhandled LCDC write32 @ 0x%08X = 0x%08X\n", addr, data);
+    for (int idx = 0; idx < 2; idx++) {
+        auto &c = tileCache[idx];
 
-            exit(0);
+        c.raw.assign(BG_SIZE[idx], 0);
+        c.rows.assign(BG_SIZE[idx] >> 2, 0);
+        c.isValid.assign(BG_SIZE[idx] >> CACHE_PAGE_SHIFT, 0);
     }
 
-    if (b->vramcnt.vramen) std::memcpy(&b->data[addr & (b->data.size() - 1)], &data, sizeof(u32));
+    isMapDirty = true;
 }
 
 u16 read16(int idx, u32 addr) {
@@ -1502,19 +1273,12 @@ u16 read16(int idx, u32 addr) {
 
     switch (addr & ~0x1000) {
         case static_cast<u32>(PPUReg::DISPSTAT):
-            //std::printf("[DISPA+B   ] Read16 @ DISPSTAT\n");
-
-            data  = (u16)dispstat[1].vblank   << 0;
-            data |= (u16)dispstat[1].hblank   << 1;
-            data |= (u16)dispstat[1].vcounter << 2;
-            data |= (u16)dispstat[1].virqen   << 3;
-            data |= (u16)dispstat[1].hirqen   << 4;
-            data |= (u16)dispstat[1].lycirqen << 5;
-            
-            data |= (dispstat[1].lyc << 7);
+            Log::debug("[DISPA+B   ] Read16 @ DISPSTAT\n");
+
+            data = getDISPSTAT(1);
             break;
         case static_cast<u32>(PPUReg::VCOUNT):
-            //std::printf("[DISPA+B   ] Read16 @ VCOUNT\n");
+            Log::debug("[DISPA+B   ] Read16 @ VCOUNT\n");
 
             return vcount;
         case static_cast<u32>(PPUReg::BGCNT) + 0:
@@ -1524,7 +1288,7 @@ u16 read16(int idx, u32 addr) {
             {
                 const auto _idx = (addr >> 1) & 3;
 
-                std::printf("[DISP%c     ] Read16 @ BG%uCNT\n", (idx) ? 'B' : 'A', _idx);
+                Log::debug("[DISP%c     ] Read16 @ BG%uCNT\n", (idx) ? 'B' : 'A', _idx);
 
                 const auto &bgcnt = d.bgcnt[_idx];
 
@@ -1541,28 +1305,28 @@ u16 read16(int idx, u32 addr) {
             }
             break;
         case static_cast<u32>(PPUReg::WININ):
-            std::printf("[DISP%c     ] Read16 @ WININ\n", (idx) ? 'B' : 'A');
+            Log::debug("[DISP%c     ] Read16 @ WININ\n", (idx) ? 'B' : 'A');
             return 0;
         case static_cast<u32>(PPUReg::WINOUT):
-            std::printf("[DISP%c     ] Read16 @ WINOUT\n", (idx) ? 'B' : 'A');
+            Log::debug("[DISP%c     ] Read16 @ WINOUT\n", (idx) ? 'B' : 'A');
             return 0;
         case static_cast<u32>(PPUReg::BLDCNT):
-            std::printf("[DISP%c     ] Read16 @ BLDCNT\n", (idx) ? 'B' : 'A');
+            Log::debug("[DISP%c     ] Read16 @ BLDCNT\n", (idx) ? 'B' : 'A');
             return 0;
         case static_cast<u32>(PPUReg::BLDALPHA):
-            std::printf("[DISP%c     ] Read16 @ BLDALPHA\n", (idx) ? 'B' : 'A');
+            Log::debug("[DISP%c     ] Read16 @ BLDALPHA\n", (idx) ? 'B' : 'A');
             return 0;
         case static_cast<u32>(PPUReg::DISP3DCNT):
             if (idx) {
-                std::printf("[DISP%c     ] Unhandled read16 @ 0x%08X\n", (idx) ? 'B' : 'A', addr);
+                Log::warn("[DISP%c     ] Unhandled read16 @ 0x%08X\n", (idx) ? 'B' : 'A', addr);
 
                 return 0;
             }
 
-            std::printf("[DISPA     ] Read16 @ DISP3DCNT\n");
+            Log::debug("[DISPA     ] Read16 @ DISP3DCNT\n");
             return 0;
         default:
-            std::printf("[DISP%c     ] Unhandled read16 @ 0x%08X\n", (idx) ? 'B' : 'A', addr);
+            Log::error("[DISP%c     ] Unhandled read16 @ 0x%08X\n", (idx) ? 'B' : 'A', addr);
 
             exit(0);
     }
@@ -1578,7 +1342,7 @@ u32 read32(int idx, u32 addr) {
     switch (addr & ~0x1000) {
         case static_cast<u32>(PPUReg::DISPCNT):
             {
-                std::printf("[DISP%c     ] Read32 @ DISPCNT\n", (idx) ? 'B' : 'A');
+                Log::debug("[DISP%c     ] Read32 @ DISPCNT\n", (idx) ? 'B' : 'A');
 
                 const auto &cnt = d.dispcnt;
 
@@ -1609,7 +1373,7 @@ u32 read32(int idx, u32 addr) {
             }
             break;
         default:
-            std::printf("[DISP%c     ] Unhandled read32 @ 0x%08X\n", (idx) ? 'B' : 'A', addr);
+            Log::error("[DISP%c     ] Unhandled read32 @ 0x%08X\n", (idx) ? 'B' : 'A', addr);
             
             exit(0);
     }
@@ -1622,13 +1386,13 @@ void write8(int idx, u32 addr, u8 data) {
     
     switch (addr & ~0x1000) {
         case static_cast<u32>(PPUReg::MOSAIC):
-            std::printf("[DISP%c     ] Write8 @ MOSAIC_L = 0x%02X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write8 @ MOSAIC_L = 0x%02X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::MOSAIC) + 1:
-            std::printf("[DISP%c     ] Write8 @ MOSAIC_H = 0x%02X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write8 @ MOSAIC_H = 0x%02X\n", (idx) ? 'B' : 'A', data);
             break;
         default:
-            std::printf("[DISP%c     ] Unhandled write8 @ 0x%08X = 0x%02X\n", (idx) ? 'B' : 'A', addr, data);
+            Log::warn("[DISP%c     ] Unhandled write8 @ 0x%08X = 0x%02X\n", (idx) ? 'B' : 'A', addr, data);
             break;
     }
 }
@@ -1638,7 +1402,7 @@ void write16(int idx, u32 addr, u16 data) {
     
     switch (addr & ~0x1000) {
         case static_cast<u32>(PPUReg::DISPSTAT):
-            std::printf("[DISPA+B   ] Write16 @ DISPSTAT = 0x%04X\n", data);
+            Log::debug("[DISPA+B   ] Write16 @ DISPSTAT = 0x%04X\n", data);
 
             dispstat[1].virqen   = data & (1 << 3);
             dispstat[1].hirqen   = data & (1 << 4);
@@ -1653,7 +1417,7 @@ void write16(int idx, u32 addr, u16 data) {
             {
                 const auto _idx = (addr >> 1) & 3;
 
-                std::printf("[DISP%c     ] Write16 @ BG%uCNT = 0x%04X\n", (idx) ? 'B' : 'A', _idx, data);
+                Log::debug("[DISP%c     ] Write16 @ BG%uCNT = 0x%04X\n", (idx) ? 'B' : 'A', _idx, data);
 
                 auto &bgcnt = d.bgcnt[_idx];
 
@@ -1681,7 +1445,7 @@ void write16(int idx, u32 addr, u16 data) {
                 const auto bg = (addr >> 4) & 1;
                 const auto p  = (addr >> 1) & 3;
 
-                std::printf("[DISP%c     ] Write16 @ BG%uP%c = 0x%04X\n", (idx) ? 'B' : 'A', 2 + bg, 'A' + p, data);
+                Log::debug("[DISP%c     ] Write16 @ BG%uP%c = 0x%04X\n", (idx) ? 'B' : 'A', 2 + bg, 'A' + p, data);
 
                 d.bgp[bg][p + 0] = data;
                 d.bgp[bg][p + 1] = data >> 16;
@@ -1692,7 +1456,7 @@ void write16(int idx, u32 addr, u16 data) {
             {
                 const auto _idx = (addr >> 1) & 1;
 
-                std::printf("[DISP%c     ] Write32 @ WIN%uH = 0x%04X\n", (idx) ? 'B' : 'A', _idx, data);
+                Log::debug("[DISP%c     ] Write32 @ WIN%uH = 0x%04X\n", (idx) ? 'B' : 'A', _idx, data);
 
                 d.winh[_idx].x2 = data;
                 d.winh[_idx].x1 = data >>  8;
@@ -1703,43 +1467,43 @@ void write16(int idx, u32 addr, u16 data) {
             {
                 const auto _idx = (addr >> 1) & 1;
 
-                std::printf("[DISP%c     ] Write32 @ WIN%uV = 0x%04X\n", (idx) ? 'B' : 'A', _idx, data);
+                Log::debug("[DISP%c     ] Write32 @ WIN%uV = 0x%04X\n", (idx) ? 'B' : 'A', _idx, data);
 
                 d.winv[_idx].y2 = data;
                 d.winv[_idx].y1 = data >>  8;
             }
             break;
         case static_cast<u32>(PPUReg::WININ):
-            std::printf("[DISP%c     ] Write16 @ WININ = 0x%04X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write16 @ WININ = 0x%04X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::WINOUT):
-            std::printf("[DISP%c     ] Write16 @ WINOUT = 0x%04X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write16 @ WINOUT = 0x%04X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::BLDCNT):
-            std::printf("[DISP%c     ] Write16 @ BLDCNT = 0x%04X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write16 @ BLDCNT = 0x%04X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::BLDALPHA):
-            std::printf("[DISP%c     ] Write16 @ BLDALPHA = 0x%04X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write16 @ BLDALPHA = 0x%04X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::BLDY):
-            std::printf("[DISP%c     ] Write16 @ BLDY = 0x%04X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write16 @ BLDY = 0x%04X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::DISP3DCNT):
             if (idx) {
-                std::printf("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
+                Log::warn("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
 
                 return;
             }
 
-            std::printf("[DISPA     ] Write16 @ DISP3DCNT = 0x%04X\n", data);
+            Log::debug("[DISPA     ] Write16 @ DISP3DCNT = 0x%04X\n", data);
             break;
         case static_cast<u32>(PPUReg::MASTERBRIGHT):
-            std::printf("[DISP%c     ] Write16 @ MASTERBRIGHT = 0x%04X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write16 @ MASTERBRIGHT = 0x%04X\n", (idx) ? 'B' : 'A', data);
 
             d.masterbright = data & 0x1F;
             break;
         default:
-            std::printf("[DISP%c     ] Unhandled write16 @ 0x%08X = 0x%04X\n", (idx) ? 'B' : 'A', addr, data);
+            Log::error("[DISP%c     ] Unhandled write16 @ 0x%08X = 0x%04X\n", (idx) ? 'B' : 'A', addr, data);
 
             exit(0);
     }
@@ -1751,7 +1515,7 @@ void write32(int idx, u32 addr, u32 data) {
     switch (addr & ~0x1000) {
         case static_cast<u32>(PPUReg::DISPCNT):
             {
-                std::printf("[DISP%c     ] Write32 @ DISPCNT = 0x%08X\n", (idx) ? 'B' : 'A', data);
+                Log::debug("[DISP%c     ] Write32 @ DISPCNT = 0x%08X\n", (idx) ? 'B' : 'A', data);
 
                 auto &cnt = d.dispcnt;
 
@@ -1783,12 +1547,12 @@ void write32(int idx, u32 addr, u32 data) {
             break;
         case static_cast<u32>(PPUReg::DISPSTAT):
             if (idx) {
-                std::printf("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
+                Log::warn("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
 
                 return;
             }
 
-            std::printf("[DISPA+B   ] Write32 @ DISPSTAT = 0x%08X\n", data);
+            Log::debug("[DISPA+B   ] Write32 @ DISPSTAT = 0x%08X\n", data);
 
             dispstat[1].virqen   = data & (1 << 3);
             dispstat[1].hirqen   = data & (1 << 4);
@@ -1801,7 +1565,7 @@ void write32(int idx, u32 addr, u32 data) {
             {
                 const auto _idx = (addr >> 2) & 1;
 
-                std::printf("[DISP%c     ] Write32 @ BG%u/%uCNT = 0x%08X\n", (idx) ? 'B' : 'A', _idx, _idx + 1, data);
+                Log::debug("[DISP%c     ] Write32 @ BG%u/%uCNT = 0x%08X\n", (idx) ? 'B' : 'A', _idx, _idx + 1, data);
 
                 for (int i = 0; i < 2; i++) {
                     auto &bgcnt = d.bgcnt[2 * _idx + i];
@@ -1826,7 +1590,7 @@ void write32(int idx, u32 addr, u32 data) {
             {
                 const auto _idx = (addr >> 2) & 3;
 
-                std::printf("[DISP%c     ] Write32 @ BG%uHOFS/BG%uVOFS = 0x%08X\n", (idx) ? 'B' : 'A', _idx, _idx, data);
+                Log::debug("[DISP%c     ] Write32 @ BG%uHOFS/BG%uVOFS = 0x%08X\n", (idx) ? 'B' : 'A', _idx, _idx, data);
 
                 d.bghofs[_idx] = (data >>  0) & 0x1FF;
                 d.bgvofs[_idx] = (data >> 16) & 0x1FF;
@@ -1840,7 +1604,7 @@ void write32(int idx, u32 addr, u32 data) {
                 const auto bg = (addr >> 4) & 1;
                 const auto p  = (addr >> 1) & 2;
 
-                std::printf("[DISP%c     ] Write32 @ BG%uP%c/%c = 0x%08X\n", (idx) ? 'B' : 'A', 2 + bg, 'A' + p, 'B' + p, data);
+                Log::debug("[DISP%c     ] Write32 @ BG%uP%c/%c = 0x%08X\n", (idx) ? 'B' : 'A', 2 + bg, 'A' + p, 'B' + p, data);
 
                 d.bgp[bg][p + 0] = data;
                 d.bgp[bg][p + 1] = data >> 16;
@@ -1854,14 +1618,14 @@ void write32(int idx, u32 addr, u32 data) {
                 const auto bg = (addr >> 4) & 1;
                 const auto xy = (addr >> 2) & 1;
 
-                std::printf("[DISP%c     ] Write32 @ BG%u%c = 0x%08X\n", (idx) ? 'B' : 'A', 2 + bg, 'X' + xy, data);
+                Log::debug("[DISP%c     ] Write32 @ BG%u%c = 0x%08X\n", (idx) ? 'B' : 'A', 2 + bg, 'X' + xy, data);
 
                 d.bgp[bg][xy] = (i32)(data << 4) >> 4;
             }
             break;
         case static_cast<u32>(PPUReg::WIN0H):
             {
-                std::printf("[DISP%c     ] Write32 @ WIN0/1H = 0x%08X\n", (idx) ? 'B' : 'A', data);
+                Log::debug("[DISP%c     ] Write32 @ WIN0/1H = 0x%08X\n", (idx) ? 'B' : 'A', data);
 
                 d.winh[0].x2 = data;
                 d.winh[0].x1 = data >>  8;
@@ -1871,7 +1635,7 @@ void write32(int idx, u32 addr, u32 data) {
             break;
         case static_cast<u32>(PPUReg::WIN0V):
             {
-                std::printf("[DISP%c     ] Write32 @ WIN0/1V = 0x%08X\n", (idx) ? 'B' : 'A', data);
+                Log::debug("[DISP%c     ] Write32 @ WIN0/1V = 0x%08X\n", (idx) ? 'B' : 'A', data);
 
                 d.winv[0].y2 = data;
                 d.winv[0].y1 = data >>  8;
@@ -1880,66 +1644,57 @@ void write32(int idx, u32 addr, u32 data) {
             }
             break;
         case static_cast<u32>(PPUReg::WININ):
-            std::printf("[DISP%c     ] Write32 @ WININ/OUT = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ WININ/OUT = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::MOSAIC):
-            std::printf("[DISP%c     ] Write32 @ MOSAIC = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ MOSAIC = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::BLDCNT):
-            std::printf("[DISP%c     ] Write32 @ BLDCNT/BLDALPHA = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ BLDCNT/BLDALPHA = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::BLDY):
-            std::printf("[DISP%c     ] Write32 @ BLDY = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ BLDY = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::DISP3DCNT):
             if (idx) {
-                std::printf("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
+                Log::warn("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
 
                 return;
             }
 
-            std::printf("[DISP%c     ] Write32 @ DISP3DCNT = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ DISP3DCNT = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::DISPCAPCNT):
             if (idx) {
-                std::printf("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
+                Log::warn("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
 
                 return;
             }
 
-            std::printf("[DISP%c     ] Write32 @ DISPCAPCNT = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ DISPCAPCNT = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::DISPMMEMFIFO):
             if (idx) {
-                std::printf("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
+                Log::warn("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
 
                 return;
             }
 
-            std::printf("[DISP%c     ] Write32 @ DISPMMEMFIFO = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ DISPMMEMFIFO = 0x%08X\n", (idx) ? 'B' : 'A', data);
             break;
         case static_cast<u32>(PPUReg::MASTERBRIGHT):
-            std::printf("[DISP%c     ] Write32 @ MASTERBRIGHT = 0x%08X\n", (idx) ? 'B' : 'A', data);
+            Log::debug("[DISP%c     ] Write32 @ MASTERBRIGHT = 0x%08X\n", (idx) ? 'B' : 'A', data);
 
             d.masterbright = data & 0x1F;
             break;
         default:
-            std::printf("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
+            Log::warn("[DISP%c     ] Unhandled write32 @ 0x%08X = 0x%08X\n", (idx) ? 'B' : 'A', addr, data);
             break;
     }
 }
 
 u16 readDISPSTAT7() {
-    u16 data;
-
-    data  = (u16)dispstat[0].vblank   << 0;
-    data |= (u16)dispstat[0].hblank   << 1;
-    data |= (u16)dispstat[0].vcounter << 2;
-    data |= (u16)dispstat[0].virqen   << 3;
-    data |= (u16)dispstat[0].hirqen   << 4;
-    data |= (u16)dispstat[0].lycirqen << 5;
-    
-    return data | (dispstat[0].lyc << 7);
+    return getDISPSTAT(0);
 }
 
 u16 readVCOUNT() {
@@ -28,6 +28,10 @@ u8  readLCDC8 (u32 addr);
 u16 readLCDC16(u32 addr);
 u32 readLCDC32(u32 addr);
 
+u8 *getLCDCPointer(u32 addr);
+u8 *getVRAMPointer(u32 addr);
+u8 *getPalettePointer(u32 addr);
+
 void writeVRAM16(u32 addr, u16 data);
 void writeVRAM32(u32 addr, u32 data);
 
@@ -8,111 +8,215 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
-#include <deque>
-#include <queue>
 #include <vector>
 
 namespace nds::scheduler {
 
 /* --- Scheduler constants --- */
 
-constexpr i64 MAX_RUN_CYCLES = 16;
+constexpr i64 MIN_RUN_CYCLES = 16;
 
 /* Scheduler event */
 struct Event {
-    u64 id;
+    u64 timestamp; // Absolute ARM9 cycle the event fires on
+    u64 seq;       // Breaks ties between events on the same cycle
+    u64 handle;    // 0 if the slot is free
 
+    u64 id;
     int param;
-    i64 cyclesUntilEvent;
+
+    u32 heapIdx;
 };
 
-std::deque<Event> events;     // Event queue
-std::queue<Event> nextEvents;
+/* Registered event callback */
+struct Callback {
+    EventFunc func;
 
-std::vector<std::function<void(int, i64)>> registeredFuncs;
+    void *ctx;
+};
 
-i64 cycleCount, cyclesUntilNextEvent;
+// Event handles are (sequence number << 32) | slot
+std::vector<Event> events; // Event slots
+std::vector<u32> freeSlots;
+std::vector<u32> heap;     // Binary min-heap of event slots
 
-/* Finds the next event */
-void reschedule() {
-    auto nextEvent = INT64_MAX;
+std::vector<Callback> callbacks;
 
-    for (auto &event : events) {
-        if (event.cyclesUntilEvent < nextEvent) nextEvent = event.cyclesUntilEvent;
-    }
+u64 timestamp, seqCounter;
+
+i64 maxRunCycles, sliceCycles; // Longest and current run slice
+
+bool isSyncing; // Keeps run slices short while the CPUs interact
 
-    cyclesUntilNextEvent = nextEvent;
+/* Returns true if the event in slot a fires before the event in slot b */
+bool isEarlier(u32 a, u32 b) {
+    const auto &x = events[a];
+    const auto &y = events[b];
+
+    return (x.timestamp < y.timestamp) || ((x.timestamp == y.timestamp) && (x.seq < y.seq));
 }
 
-void init() {
-    cycleCount = 0;
+void swapHeap(u32 i, u32 j) {
+    std::swap(heap[i], heap[j]);
 
-    cyclesUntilNextEvent = INT64_MAX;
+    events[heap[i]].heapIdx = i;
+    events[heap[j]].heapIdx = j;
 }
 
-void flush() {
-    if (nextEvents.empty()) return reschedule();
+void siftUp(u32 i) {
+    while (i) {
+        const auto parent = (i - 1) / 2;
+
+        if (!isEarlier(heap[i], heap[parent])) break;
 
-    while (!nextEvents.empty()) { events.push_back(nextEvents.front()); nextEvents.pop(); }
+        swapHeap(i, parent);
 
-    reschedule();
+        i = parent;
+    }
 }
 
-/* Registers an event, returns event ID */
-u64 registerEvent(std::function<void(int, i64)> func) {
-    static u64 idPool;
+void siftDown(u32 i) {
+    while (true) {
+        const auto l = 2 * i + 1;
+        const auto r = 2 * i + 2;
+
+        auto first = i;
+
+        if ((l < heap.size()) && isEarlier(heap[l], heap[first])) first = l;
+        if ((r < heap.size()) && isEarlier(heap[r], heap[first])) first = r;
+
+        if (first == i) break;
+
+        swapHeap(i, first);
+
+        i = first;
+    }
+}
+
+/* Removes an event from the heap, frees its slot */
+void removeAt(u32 i) {
+    const auto slot = heap[i];
+
+    swapHeap(i, heap.size() - 1);
+
+    heap.pop_back();
+
+    if (i < heap.size()) {
+        siftUp(i);
+        siftDown(i);
+    }
+
+    events[slot].handle = 0;
+
+    freeSlots.push_back(slot);
+}
+
+void init(i64 maxRunCycles) {
+    assert(maxRunCycles > 0);
+
+    timestamp = seqCounter = 0;
 
-    registeredFuncs.push_back(func);
+    scheduler::maxRunCycles = maxRunCycles;
 
-    return idPool++;
+    sliceCycles = std::min(MIN_RUN_CYCLES, maxRunCycles);
 }
 
-/* Adds a scheduler event */
-void addEvent(u64 id, int param, i64 cyclesUntilEvent) {
+/* Registers an event callback, returns event ID */
+u64 registerEvent(EventFunc func, void *ctx) {
+    callbacks.push_back(Callback{func, ctx});
+
+    return callbacks.size() - 1;
+}
+
+/* Adds a scheduler event, returns a handle that can be used to cancel it */
+u64 addEvent(u64 id, int param, i64 cyclesUntilEvent) {
     assert(cyclesUntilEvent >= 0);
+    assert(id < callbacks.size());
 
     //std::printf("[Scheduler ] Adding event %llu, cycles until event: %lld\n", id, cyclesUntilEvent);
 
-    nextEvents.emplace(Event{id, param, cyclesUntilEvent});
-}
+    u32 slot;
 
-/* Removes all scheduler events of a certain ID */
-void removeEvent(u64 id) {
-    for (auto event = events.begin(); event != events.end();) {
-        if (event->id == id) {
-            event = events.erase(event);
-        } else {
-            event++;
-        }
+    if (freeSlots.empty()) {
+        slot = events.size();
+
+        events.emplace_back();
+    } else {
+        slot = freeSlots.back();
+
+        freeSlots.pop_back();
     }
+
+    const auto seq = ++seqCounter;
+
+    auto &event = events[slot];
+
+    event.timestamp = timestamp + cyclesUntilEvent;
+    event.seq       = seq;
+    event.handle    = (seq << 32) | slot;
+    event.id        = id;
+    event.param     = param;
+    event.heapIdx   = heap.size();
+
+    heap.push_back(slot);
+
+    siftUp(event.heapIdx);
+
+    // Don't overshoot events that are due before the end of the next slice
+    if (cyclesUntilEvent < sliceCycles) isSyncing = true;
+
+    return event.handle;
 }
 
-void processEvents(i64 elapsedCycles) {
-    assert(!events.empty());
+/* Cancels a pending event, does nothing if it already fired */
+void cancelEvent(u64 handle) {
+    const auto slot = (u32)handle;
 
-    cyclesUntilNextEvent -= elapsedCycles;
+    if ((slot >= events.size()) || !handle || (events[slot].handle != handle)) return;
 
-    for (auto event = events.begin(); event != events.end();) {
-        event->cyclesUntilEvent -= elapsedCycles;
+    removeAt(events[slot].heapIdx);
+}
+
+void processEvents(i64 elapsedCycles) {
+    assert(elapsedCycles >= 0);
+
+    timestamp += elapsedCycles;
 
-        assert(event->cyclesUntilEvent >= 0);
+    while (!heap.empty() && (events[heap[0]].timestamp <= timestamp)) {
+        const auto event = events[heap[0]];
 
-        if (!event->cyclesUntilEvent) {
-            const auto id = event->id;
-            const auto param = event->param;
-            //const auto cyclesUntilEvent = event->cyclesUntilEvent;
+        removeAt(0);
 
-            event = events.erase(event);
+        const auto &callback = callbacks[event.id];
 
-            registeredFuncs[id](param, 0);
-        } else {
-            event++;
-        }
+        callback.func(callback.ctx, event.param, timestamp - event.timestamp);
     }
 }
 
+/* Shortens the next run slices, called on cross-CPU accesses */
+void sync() {
+    isSyncing = true;
+}
+
+/* Returns the current ARM9 cycle */
+u64 getTimestamp() {
+    return timestamp;
+}
+
+/* Returns the length of the next run slice. Slices grow while the CPUs run independently */
 i64 getRunCycles() {
-    return std::min((i64)MAX_RUN_CYCLES, cyclesUntilNextEvent);
+    sliceCycles = (isSyncing) ? MIN_RUN_CYCLES : 2 * sliceCycles;
+    sliceCycles = std::min(sliceCycles, maxRunCycles);
+
+    isSyncing = false;
+
+    return std::min(sliceCycles, getCyclesUntilNextEvent());
+}
+
+i64 getCyclesUntilNextEvent() {
+    if (heap.empty()) return INT64_MAX;
+
+    return events[heap[0]].timestamp - timestamp;
 }
 
 }
@@ -5,22 +5,26 @@
 
 #pragma once
 
-#include <functional>
-
 #include "../common/types.hpp"
 
 namespace nds::scheduler {
 
-void init();
+/* Event callback, gets the event's context pointer, parameter and the number of cycles it fired late */
+using EventFunc = void (*)(void *ctx, int param, i64 cyclesLate);
 
-void flush();
+void init(i64 maxRunCycles);
 
-u64 registerEvent(std::function<void(int, i64)> func);
+u64 registerEvent(EventFunc func, void *ctx);
 
-void addEvent(u64 id, int param, i64 cyclesUntilEvent);
-void removeEvent(u64 id);
+u64  addEvent(u64 id, int param, i64 cyclesUntilEvent);
+void cancelEvent(u64 handle);
 void processEvents(i64 elapsedCycles);
 
+void sync();
+
+u64 getTimestamp();
+
 i64 getRunCycles();
+i64 getCyclesUntilNextEvent();
 
 }
@@ -8,14 +8,23 @@
 #include <cassert>
 #include <cstdio>
 
+#include "bus.hpp"
 #include "firmware.hpp"
+#include "../common/log.hpp"
 
 namespace nds::spi {
 
+using Log = logger::Logger<logger::Category::SPI>;
+
 constexpr const char *devNames[] = {
     "Power Management", "Firmware", "TSC", "Reserved",
 };
 
+enum class SPIReg {
+    SPICNT  = 0x040001C0,
+    SPIDATA = 0x040001C2,
+};
+
 enum SPIDev {
     PowerManagement, Firmware, TSC, Reserved,
 };
@@ -34,6 +43,41 @@ struct SPICNT {
 
 SPICNT spicnt;
 
+void init() {
+    bus::registerRead8(7, static_cast<u32>(SPIReg::SPIDATA), 1, [](u32) -> u8 {
+        Log::debug("[SPI       ] Read8 @ SPIDATA\n");
+        return readSPIDATA();
+    });
+
+    bus::registerRead16(7, static_cast<u32>(SPIReg::SPICNT), 2, [](u32) -> u16 {
+        Log::debug("[SPI       ] Read16 @ SPICNT\n");
+        return readSPICNT();
+    });
+    bus::registerRead16(7, static_cast<u32>(SPIReg::SPIDATA), 2, [](u32) -> u16 {
+        Log::debug("[SPI       ] Read16 @ SPIDATA\n");
+        return readSPIDATA();
+    });
+
+    bus::registerRead32(7, static_cast<u32>(SPIReg::SPICNT), 4, [](u32) -> u32 {
+        Log::debug("[SPI       ] Read32 @ SPICNT\n"); // And SPIDATA??
+        return readSPICNT();
+    });
+
+    bus::registerWrite8(7, static_cast<u32>(SPIReg::SPIDATA), 1, [](u32, u8 data) {
+        Log::debug("[SPI       ] Write8 @ SPIDATA = 0x%02X\n", data);
+        writeSPIDATA(data);
+    });
+
+    bus::registerWrite16(7, static_cast<u32>(SPIReg::SPICNT), 2, [](u32, u16 data) {
+        Log::debug("[SPI       ] Write16 @ SPICNT = 0x%04X\n", data);
+        writeSPICNT(data);
+    });
+    bus::registerWrite16(7, static_cast<u32>(SPIReg::SPIDATA), 2, [](u32, u16 data) {
+        Log::debug("[SPI       ] Write16 @ SPIDATA = 0x%04X\n", data);
+        writeSPIDATA(data);
+    });
+}
+
 u16 readSPICNT() {
     u16 data;
 
@@ -59,7 +103,7 @@ u8 readSPIDATA() {
         case SPIDev::TSC:
             return 0xFF;
         default:
-            std::printf("[SPI       ] Unhandled SPI device %s\n", devNames[spicnt.dev]);
+            Log::error("[SPI       ] Unhandled SPI device %s\n", devNames[spicnt.dev]);
 
             exit(0);
     }
@@ -85,16 +129,16 @@ void writeSPIDATA(u8 data) {
     if (spicnt.spien && spicnt.chipselect) {
         switch (spicnt.dev) {
             case SPIDev::PowerManagement:
-                std::printf("[SPI       ] Unhandled Power Management write = 0x%02X\n", data);
+                Log::warn("[SPI       ] Unhandled Power Management write = 0x%02X\n", data);
                 break;
             case SPIDev::Firmware:
                 firmware::write(data);
                 break;
             case SPIDev::TSC:
-                std::printf("[SPI       ] Unhandled TSC write = 0x%02X\n", data);
+                Log::warn("[SPI       ] Unhandled TSC write = 0x%02X\n", data);
                 break;
             default:
-                std::printf("[SPI       ] Unhandled SPI device %s\n", devNames[spicnt.dev]);
+                Log::error("[SPI       ] Unhandled SPI device %s\n", devNames[spicnt.dev]);
 
                 exit(0);
         }
@@ -9,6 +9,8 @@
 
 namespace nds::spi {
 
+void init();
+
 u16 readSPICNT();
 u8  readSPIDATA();
 
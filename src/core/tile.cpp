@@ -0,0 +1,126 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#include "tile.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "../common/log.hpp"
+
+namespace nds::ppu::tile {
+
+using Log = logger::Logger<logger::Category::PPU>;
+
+// SIMD kernels (false = always use the scalar kernels)
+constexpr auto useSIMD = true;
+
+// Tile constants
+
+constexpr int LINE_WIDTH = 256;
+
+constexpr u8 PRIO_TRANSPARENT = 5;
+
+constexpr u64 BYTE_LANES = 0x0101010101010101ull; // Broadcasts a byte to all pixels of a row
+
+using RowKernel = void (*)(u16 *, u8 *, const u16 *, u64, u8, u8);
+
+/* Draws a single pixel */
+inline void drawPixel(u16 *line, u8 *prios, const u16 *pal, u8 pixel, u8 palBase, u8 prio, int x) {
+    const u8 pixPrio = (pixel) ? prio : PRIO_TRANSPARENT;
+
+    if (pixPrio <= prios[x]) {
+        prios[x] = pixPrio;
+
+        line[x] = pal[(u8)(palBase + pixel)];
+    }
+}
+
+void drawRowScalar(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio) {
+    for (int x = 0; x < 8; x++) drawPixel(line, prios, pal, pixels >> (8 * x), palBase, prio, x);
+}
+
+#if defined(__x86_64__)
+
+/* Merges 8 colors into the line, pixels are drawn where their priority is less than or equal to the line's */
+__attribute__((target("sse4.1"))) inline void mergeRow(u16 *line, u8 *prios, __m128i colors, u64 pixels, u8 prio) {
+    const auto isTransparent = _mm_cmpeq_epi8(_mm_cvtsi64_si128(pixels), _mm_setzero_si128());
+
+    const auto pixPrios  = _mm_blendv_epi8(_mm_set1_epi8(prio), _mm_set1_epi8(PRIO_TRANSPARENT), isTransparent);
+    const auto linePrios = _mm_loadl_epi64((const __m128i *)prios);
+
+    // Unsigned pixPrio <= linePrio
+    const auto mask = _mm_cmpeq_epi8(_mm_max_epu8(pixPrios, linePrios), linePrios);
+
+    _mm_storel_epi64((__m128i *)prios, _mm_blendv_epi8(linePrios, pixPrios, mask));
+
+    const auto lineColors = _mm_loadu_si128((const __m128i *)line);
+
+    _mm_storeu_si128((__m128i *)line, _mm_blendv_epi8(lineColors, colors, _mm_cvtepi8_epi16(mask)));
+}
+
+__attribute__((target("sse4.1"))) void drawRowSSE41(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio) {
+    const auto index = pixels + palBase * BYTE_LANES;
+
+    // No gather instruction, build the color vector from scalar loads
+    const auto colors = _mm_setr_epi16(
+        pal[(u8)(index >>  0)], pal[(u8)(index >>  8)], pal[(u8)(index >> 16)], pal[(u8)(index >> 24)],
+        pal[(u8)(index >> 32)], pal[(u8)(index >> 40)], pal[(u8)(index >> 48)], pal[(u8)(index >> 56)]
+    );
+
+    mergeRow(line, prios, colors, pixels, prio);
+}
+
+/* Gathers 32 bits per color, pal[index + 1] must be readable (palettes have 512 entries) */
+__attribute__((target("avx2"))) void drawRowAVX2(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio) {
+    const auto index = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(pixels + palBase * BYTE_LANES));
+
+    const auto gathered = _mm256_and_si256(_mm256_i32gather_epi32((const int *)pal, index, 2), _mm256_set1_epi32(0xFFFF));
+
+    const auto colors = _mm_packus_epi32(_mm256_castsi256_si128(gathered), _mm256_extracti128_si256(gathered, 1));
+
+    mergeRow(line, prios, colors, pixels, prio);
+}
+
+#endif
+
+RowKernel rowKernel = drawRowScalar;
+
+void init() {
+    const char *name = "scalar";
+
+    rowKernel = drawRowScalar;
+
+#if defined(__x86_64__)
+    if (useSIMD) {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2")) {
+            name = "AVX2";
+
+            rowKernel = drawRowAVX2;
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            name = "SSE4.1";
+
+            rowKernel = drawRowSSE41;
+        }
+    }
+#endif
+
+    Log::info("[PPU       ] Using %s tile kernels\n", name);
+}
+
+void drawRow(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio) {
+    rowKernel(line, prios, pal, pixels, palBase, prio);
+}
+
+void drawRowClipped(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio, int x) {
+    for (int i = 0; i < 8; i++) {
+        if (((x + i) >= 0) && ((x + i) < LINE_WIDTH)) drawPixel(line, prios, pal, pixels >> (8 * i), palBase, prio, x + i);
+    }
+}
+
+}
@@ -0,0 +1,44 @@
+/*
+ * MariDS is a Nintendo DS emulator.
+ * Copyright (C) 2023  Lady Starbreeze (Michelle-Marie Schiller)
+ */
+
+#pragma once
+
+#include "../common/types.hpp"
+
+namespace nds::ppu::tile {
+
+/* Picks the fastest tile kernels the host supports */
+void init();
+
+/* Unpacks a 4BPP tile row (8 nibbles) to one palette index per byte, leftmost pixel in the lowest byte */
+constexpr u64 expand4BPP(u32 data) {
+    u64 pixels = data;
+
+    pixels = (pixels | (pixels << 16)) & 0x0000FFFF0000FFFFull;
+    pixels = (pixels | (pixels <<  8)) & 0x00FF00FF00FF00FFull;
+    pixels = (pixels | (pixels <<  4)) & 0x0F0F0F0F0F0F0F0Full;
+
+    return pixels;
+}
+
+/* Mirrors a tile row */
+constexpr u64 flipRow(u64 pixels) {
+    pixels = ((pixels & 0x00FF00FF00FF00FFull) <<  8) | ((pixels >>  8) & 0x00FF00FF00FF00FFull);
+    pixels = ((pixels & 0x0000FFFF0000FFFFull) << 16) | ((pixels >> 16) & 0x0000FFFF0000FFFFull);
+
+    return (pixels << 32) | (pixels >> 32);
+}
+
+/*
+ * Draws a tile row (one palette index per byte) to line[0;8].
+ * Colors come from pal[palBase + index], index 0 is transparent (priority 5).
+ * A pixel is drawn if its priority is less than or equal to the one in prios, which gets updated.
+ */
+void drawRow(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio);
+
+/* Same as drawRow, but draws to line[x;x+8] and clips pixels outside of the 256 pixel line */
+void drawRowClipped(u16 *line, u8 *prios, const u16 *pal, u64 pixels, u8 palBase, u8 prio, int x);
+
+}
@@ -5,14 +5,19 @@
 
 #include "timer.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 
+#include "bus.hpp"
 #include "intc.hpp"
+#include "scheduler.hpp"
+#include "../common/log.hpp"
 
 namespace nds::timer {
 
 using IntSource = intc::IntSource;
+using Log = logger::Logger<logger::Category::Timer>;
 
 enum class TimerReg {
     TMCNT   = 0x04000100,
@@ -31,124 +36,172 @@ struct Timer {
 
     u16 reload; // TMCNT_L
 
-    u32 ctr, subctr, prescaler;
+    u32 ctr, prescaler;
+
+    int cpuID, tmID;
+
+    u64 startTime; // Timestamp ctr was last valid at
+
+    u64 idOverflow, overflowEvent; // Scheduler event ID, handle of the pending overflow
 };
 
 Timer timers7[4], timers9[4];
 
-void checkCascade7(int tmID) {
-    auto &tm = timers7[tmID];
+/* Returns true if a timer counts cycles. Cascading timers only count overflows of the previous timer */
+bool isCounting(const Timer &tm) {
+    return tm.tmcnt.tmen && (!tm.tmcnt.cascade || !tm.tmID);
+}
 
-    auto &cnt = tm.tmcnt;
+/* Returns true if overflows have side effects (IRQs, cascades). Other timers get no overflow events */
+bool hasOverflowEffects(const Timer &tm) {
+    if (tm.tmcnt.irqen) return true;
+
+    if (tm.tmID == 3) return false;
 
-    if (cnt.tmen && cnt.cascade) {
-        ++tm.ctr;
+    const auto &next = ((tm.cpuID == 7) ? timers7 : timers9)[tm.tmID + 1];
 
-        if (tm.ctr & (1 << 16)) {
-            // Reload counter, trigger interrupt
-            tm.ctr = tm.reload;
+    return next.tmcnt.tmen && next.tmcnt.cascade;
+}
 
-            if (cnt.irqen) intc::sendInterrupt7((IntSource)(tmID + 3));
+/* Returns the current counter value, overflows without an event are reloaded here */
+u32 getCounter(const Timer &tm) {
+    if (!isCounting(tm)) return tm.ctr;
 
-            // Check previous timer for cascade
-            if ((tmID != 0)) checkCascade7(tmID - 1);
-        }
+    const u64 ctr = tm.ctr + (scheduler::getTimestamp() - tm.startTime) / tm.prescaler;
+
+    if (ctr < (1 << 16)) return ctr;
+
+    return tm.reload + (ctr - (1 << 16)) % ((1 << 16) - tm.reload);
+}
+
+/* Stores the current counter value, keeps the prescaler remainder */
+void latch(Timer &tm) {
+    const auto now = scheduler::getTimestamp();
+
+    if (isCounting(tm)) {
+        tm.ctr = getCounter(tm);
+
+        tm.startTime = now - (now - tm.startTime) % tm.prescaler;
+    } else {
+        tm.startTime = now;
     }
 }
 
-void checkCascade9(int tmID) {
-    auto &tm = timers9[tmID];
+/* Schedules the next overflow of a counting timer */
+void schedule(Timer &tm) {
+    scheduler::cancelEvent(tm.overflowEvent);
 
-    auto &cnt = tm.tmcnt;
+    tm.overflowEvent = 0;
 
-    if (cnt.tmen && cnt.cascade) {
-        ++tm.ctr;
+    if (!isCounting(tm) || !hasOverflowEffects(tm)) return;
 
-        if (tm.ctr & (1 << 16)) {
-            // Reload counter, trigger interrupt
-            tm.ctr = tm.reload;
+    const auto cyclesUntilOverflow = (i64)((1 << 16) - tm.ctr) * tm.prescaler - (i64)(scheduler::getTimestamp() - tm.startTime);
 
-            if (cnt.irqen) intc::sendInterrupt9((IntSource)(tmID + 3));
+    tm.overflowEvent = scheduler::addEvent(tm.idOverflow, 0, std::max(cyclesUntilOverflow, (i64)0));
+}
 
-            // Check previous timer for cascade
-            if ((tmID != 0)) checkCascade9(tmID - 1);
-        }
+/* Reloads the counter, triggers interrupt and cascades into the next timer */
+void overflow(Timer &tm) {
+    tm.ctr = tm.reload;
+
+    if (tm.tmcnt.irqen) {
+        const auto intSource = (IntSource)((int)IntSource::Timer0 + tm.tmID);
+
+        (tm.cpuID == 7) ? intc::sendInterrupt7(intSource) : intc::sendInterrupt9(intSource);
     }
+
+    if (tm.tmID == 3) return;
+
+    auto &next = ((tm.cpuID == 7) ? timers7 : timers9)[tm.tmID + 1];
+
+    if (next.tmcnt.tmen && next.tmcnt.cascade && (++next.ctr & (1 << 16))) overflow(next);
 }
 
-void init() {
-    for (auto &i : timers7) {
-        i.prescaler = 1;
+void overflowEvent(void *ctx, int, i64 cyclesLate) {
+    auto &tm = *(Timer *)ctx;
 
-        i.ctr = i.subctr = 0;
-    }
+    tm.overflowEvent = 0;
+
+    const auto now = scheduler::getTimestamp();
+
+    tm.startTime = now - cyclesLate;
+
+    overflow(tm);
 
-    for (auto &i : timers9) {
-        i.prescaler = 1;
+    // Short periods can overflow more than once per slice, catch up before scheduling the next overflow
+    for (u64 period; (now - tm.startTime) >= (period = (u64)((1 << 16) - tm.ctr) * tm.prescaler);) {
+        tm.startTime += period;
 
-        i.ctr = i.subctr = 0;
+        overflow(tm);
     }
+
+    schedule(tm);
 }
 
-void run7(i64 runCycles) {
-    for (int i = 0; i < 4; i++) {
-        auto &tm = timers7[i];
+/* Writes TMCNT_H, starts or stops the timer */
+void writeTMCNT_H(Timer &tm, u16 data) {
+    auto &cnt = tm.tmcnt;
 
-        auto &cnt = tm.tmcnt;
+    const auto tmen = cnt.tmen;
 
-        if (!cnt.tmen || cnt.cascade) continue;
+    latch(tm);
 
-        tm.subctr += runCycles;
+    cnt.prescaler = data & 3;
+    cnt.cascade   = data & (1 << 2);
 
-        while (tm.subctr > tm.prescaler) {
-            ++tm.ctr;
+    cnt.irqen = data & (1 << 6);
+    cnt.tmen  = data & (1 << 7);
 
-            if (tm.ctr & (1 << 16)) {
-                // Reload counter, trigger interrupt
-                tm.ctr = tm.reload;
+    if (!tmen && cnt.tmen) { // Set up timer
+        tm.ctr = tm.reload;
 
-                if (cnt.irqen) intc::sendInterrupt7((IntSource)((int)IntSource::Timer0 + i));
+        tm.startTime = scheduler::getTimestamp();
 
-                // Check previous timer for cascade
-                if (i != 0) checkCascade7(i - 1);
-            }
-
-            tm.subctr -= tm.prescaler;
+        switch (cnt.prescaler) {
+            case 0: tm.prescaler =    1; break;
+            case 1: tm.prescaler =   64; break;
+            case 2: tm.prescaler =  256; break;
+            case 3: tm.prescaler = 1024; break;
         }
     }
-}
 
-void run9(i64 runCycles) {
-    for (int i = 0; i < 4; i++) {
-        auto &tm = timers9[i];
+    schedule(tm);
 
-        auto &cnt = tm.tmcnt;
+    // Cascading into this timer may have changed whether the previous timer needs overflow events
+    if (tm.tmID) {
+        auto &prev = ((tm.cpuID == 7) ? timers7 : timers9)[tm.tmID - 1];
 
-        if (!cnt.tmen || cnt.cascade) continue;
+        latch(prev);
 
-        tm.subctr += runCycles;
+        schedule(prev);
+    }
+}
 
-        while (tm.subctr > tm.prescaler) {
-            ++tm.ctr;
+void init() {
+    for (int i = 0; i < 4; i++) {
+        for (auto timers : {timers7, timers9}) {
+            auto &tm = timers[i];
 
-            if (tm.ctr & (1 << 16)) {
-                // Reload counter, trigger interrupt
-                tm.ctr = tm.reload;
+            tm.prescaler = 1;
 
-                if (cnt.irqen) intc::sendInterrupt9((IntSource)((int)IntSource::Timer0 + i));
+            tm.ctr = 0;
 
-                // Check previous timer for cascade
-                if (i != 0) checkCascade9(i - 1);
-            }
+            tm.cpuID = (timers == timers7) ? 7 : 9;
+            tm.tmID  = i;
 
-            tm.subctr -= tm.prescaler;
+            tm.startTime = 0;
+
+            tm.idOverflow    = scheduler::registerEvent(&overflowEvent, &tm);
+            tm.overflowEvent = 0;
         }
     }
-}
 
-void run(i64 runCycles) {
-    run7(runCycles);
-    run9(runCycles);
+    bus::registerRead16 (7, static_cast<u32>(TimerReg::TMCNT), 0x10, &read16ARM7);
+    bus::registerWrite16(7, static_cast<u32>(TimerReg::TMCNT), 0x10, &write16ARM7);
+    bus::registerWrite32(7, static_cast<u32>(TimerReg::TMCNT), 0x10, &write32ARM7);
+
+    bus::registerRead16 (9, static_cast<u32>(TimerReg::TMCNT), 0x10, &read16ARM9);
+    bus::registerWrite16(9, static_cast<u32>(TimerReg::TMCNT), 0x10, &write16ARM9);
 }
 
 u16 read16ARM7(u32 addr) {
@@ -160,11 +213,11 @@ u16 read16ARM7(u32 addr) {
 
     switch (addr & ~(3 << 2)) {
         case static_cast<u32>(TimerReg::TMCNT):
-            std::printf("[Timer:ARM7] Read16 @ TM%uCNT_L\n", tmID);
-            return tm.ctr;
+            Log::debug("[Timer:ARM7] Read16 @ TM%uCNT_L\n", tmID);
+            return getCounter(tm);
         case static_cast<u32>(TimerReg::TMCNT_H):
             {
-                std::printf("[Timer:ARM7] Read16 @ TM%uCNT_H\n", tmID);
+                Log::debug("[Timer:ARM7] Read16 @ TM%uCNT_H\n", tmID);
 
                 auto &cnt = tm.tmcnt;
 
@@ -175,7 +228,7 @@ u16 read16ARM7(u32 addr) {
             }
             break;
         default:
-            std::printf("[Timer:ARM7] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[Timer:ARM7] Unhandled read16 @ 0x%08X\n", addr);
             
             exit(0);
     }
@@ -192,11 +245,11 @@ u16 read16ARM9(u32 addr) {
 
     switch (addr & ~(3 << 2)) {
         case static_cast<u32>(TimerReg::TMCNT):
-            std::printf("[Timer:ARM9] Read16 @ TM%uCNT_L\n", tmID);
-            return tm.ctr;
+            Log::debug("[Timer:ARM9] Read16 @ TM%uCNT_L\n", tmID);
+            return getCounter(tm);
         case static_cast<u32>(TimerReg::TMCNT_H):
             {
-                std::printf("[Timer:ARM9] Read16 @ TM%uCNT_H\n", tmID);
+                Log::debug("[Timer:ARM9] Read16 @ TM%uCNT_H\n", tmID);
 
                 auto &cnt = tm.tmcnt;
 
@@ -207,7 +260,7 @@ u16 read16ARM9(u32 addr) {
             }
             break;
         default:
-            std::printf("[Timer:ARM9] Unhandled read16 @ 0x%08X\n", addr);
+            Log::error("[Timer:ARM9] Unhandled read16 @ 0x%08X\n", addr);
             
             exit(0);
     }
@@ -222,36 +275,15 @@ void write16ARM7(u32 addr, u16 data) {
 
     switch (addr & ~(3 << 2)) {
         case static_cast<u32>(TimerReg::TMCNT):
-            std::printf("[Timer:ARM7] Write16 @ TM%uCNT_L = 0x%04X\n", tmID, data);
+            Log::debug("[Timer:ARM7] Write16 @ TM%uCNT_L = 0x%04X\n", tmID, data);
 
             tm.reload = data;
             break;
         case static_cast<u32>(TimerReg::TMCNT_H):
             {
-                std::printf("[Timer:ARM7] Write16 @ TM%uCNT_H = 0x%04X\n", tmID, data);
-
-                auto &cnt = tm.tmcnt;
-
-                const auto tmen = cnt.tmen;
-
-                cnt.prescaler = data & 3;
-                cnt.cascade   = data & (1 << 2);
-
-                cnt.irqen = data & (1 << 6);
-                cnt.tmen  = data & (1 << 7);
+                Log::debug("[Timer:ARM7] Write16 @ TM%uCNT_H = 0x%04X\n", tmID, data);
 
-                if (!tmen && cnt.tmen) { // Set up timer
-                    tm.ctr = tm.reload;
-
-                    tm.subctr = 0;
-
-                    switch (cnt.prescaler) {
-                        case 0: tm.prescaler =    1; break;
-                        case 1: tm.prescaler =   64; break;
-                        case 2: tm.prescaler =  256; break;
-                        case 3: tm.prescaler = 1024; break;
-                    }
-                }
+                writeTMCNT_H(tm, data);
             }
             break;
         default:
@@ -267,32 +299,11 @@ void write32ARM7(u32 addr, u32 data) {
     switch (addr & ~(3 << 2)) {
         case static_cast<u32>(TimerReg::TMCNT):
             {
-                std::printf("[Timer:ARM7] Write32 @ TM%uCNT = 0x%08X\n", tmID, data);
-
-                auto &cnt = tm.tmcnt;
-
-                const auto tmen = cnt.tmen;
+                Log::debug("[Timer:ARM7] Write32 @ TM%uCNT = 0x%08X\n", tmID, data);
 
                 tm.reload = data;
 
-                cnt.prescaler = (data >> 16) & 3;
-                cnt.cascade   = data & (1 << 18);
-
-                cnt.irqen = data & (1 << 22);
-                cnt.tmen  = data & (1 << 23);
-
-                if (!tmen && cnt.tmen) { // Set up timer
-                    tm.ctr = tm.reload;
-
-                    tm.subctr = 0;
-
-                    switch (cnt.prescaler) {
-                        case 0: tm.prescaler =    1; break;
-                        case 1: tm.prescaler =   64; break;
-                        case 2: tm.prescaler =  256; break;
-                        case 3: tm.prescaler = 1024; break;
-                    }
-                }
+                writeTMCNT_H(tm, data >> 16);
             }
             break;
         default:
@@ -307,36 +318,15 @@ void write16ARM9(u32 addr, u16 data) {
 
     switch (addr & ~(3 << 2)) {
         case static_cast<u32>(TimerReg::TMCNT):
-            std::printf("[Timer:ARM9] Write16 @ TM%uCNT_L = 0x%04X\n", tmID, data);
+            Log::debug("[Timer:ARM9] Write16 @ TM%uCNT_L = 0x%04X\n", tmID, data);
 
             tm.reload = data;
             break;
         case static_cast<u32>(TimerReg::TMCNT_H):
             {
-                std::printf("[Timer:ARM9] Write16 @ TM%uCNT_H = 0x%04X\n", tmID, data);
-
-                auto &cnt = tm.tmcnt;
-
-                const auto tmen = cnt.tmen;
-
-                cnt.prescaler = data & 3;
-                cnt.cascade   = data & (1 << 2);
-
-                cnt.irqen = data & (1 << 6);
-                cnt.tmen  = data & (1 << 7);
-
-                if (!tmen && cnt.tmen) { // Set up timer
-                    tm.ctr = tm.reload;
-
-                    tm.subctr = 0;
+                Log::debug("[Timer:ARM9] Write16 @ TM%uCNT_H = 0x%04X\n", tmID, data);
 
-                    switch (cnt.prescaler) {
-                        case 0: tm.prescaler =    1; break;
-                        case 1: tm.prescaler =   64; break;
-                        case 2: tm.prescaler =  256; break;
-                        case 3: tm.prescaler = 1024; break;
-                    }
-                }
+                writeTMCNT_H(tm, data);
             }
             break;
         default:
@@ -10,7 +10,6 @@
 namespace nds::timer {
 
 void init();
-void run(i64 runCycles);
 
 u16 read16ARM7(u32 addr);
 